@@ -2,6 +2,7 @@
 #define AI_TOOLBOX_IMPL_SEEDER_HEADER_FILE
 
 #include <random>
+#include <mutex>
 
 namespace AIToolbox {
     namespace Impl {
@@ -11,14 +12,44 @@ namespace AIToolbox {
          * To avoid seeding all generators with a single seed equal to the current time, only
          * this class is setup with the time seed, while all others are seeded with numbers
          * generated from this class to obtain maximum randomness.
+         *
+         * The root seed can be set explicitly to make runs reproducible.
+         * This class is thread-safe.
          */
         class Seeder {
             public:
+                /**
+                 * @brief This function returns a new seed for a random engine.
+                 *
+                 * @return A seed drawn from the root generator.
+                 */
                 static unsigned getSeed();
+
+                /**
+                 * @brief This function resets the root generator with the given seed.
+                 *
+                 * All seeds returned afterwards by getSeed() are a deterministic
+                 * function of this seed and of the order of the calls.
+                 *
+                 * @param seed The new root seed.
+                 */
+                static void setRootSeed(unsigned seed);
+
+                /**
+                 * @brief This function returns the seed the root generator was last reset with.
+                 *
+                 * @return The root seed.
+                 */
+                static unsigned getRootSeed();
+
             private:
                 Seeder();
 
+                static Seeder & instance();
+
+                unsigned rootSeed_;
                 std::default_random_engine generator_;
+                std::mutex mutex_;
         };
     }
 }
@@ -0,0 +1,162 @@
+#ifndef AI_TOOLBOX_IMPL_THREAD_POOL_HEADER_FILE
+#define AI_TOOLBOX_IMPL_THREAD_POOL_HEADER_FILE
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace AIToolbox {
+    namespace Impl {
+
+        /**
+         * @brief This class implements a minimal fixed-size pool of worker threads.
+         *
+         * Work is submitted in batches through run(), which blocks until
+         * every task of the batch has completed. The calling thread takes
+         * part in the batch as well, so a pool of size n keeps n threads
+         * busy while only owning n - 1 of them, and a pool of size 1 simply
+         * runs the tasks sequentially in the caller.
+         *
+         * Multiple threads may submit batches to the same pool concurrently.
+         */
+        class ThreadPool {
+            public:
+                using Task = std::function<void()>;
+
+                /**
+                 * @brief Basic constructor.
+                 *
+                 * @param nThreads The total number of threads working on a batch, caller included.
+                 */
+                ThreadPool(size_t nThreads);
+
+                /**
+                 * @brief Destructor. Waits for the worker threads to terminate.
+                 */
+                ~ThreadPool();
+
+                ThreadPool(const ThreadPool &) = delete;
+                ThreadPool & operator=(const ThreadPool &) = delete;
+
+                /**
+                 * @brief This function runs all given tasks and returns when they are all completed.
+                 *
+                 * @param tasks The tasks to execute, in no particular order.
+                 */
+                void run(const std::vector<Task> & tasks);
+
+                /**
+                 * @brief This function returns the number of threads working on a batch, caller included.
+                 *
+                 * @return The size of the pool.
+                 */
+                size_t size() const;
+
+            private:
+                struct Batch {
+                    std::atomic<size_t> remaining;
+                    std::mutex mutex;
+                    std::condition_variable done;
+                };
+                using Job = std::pair<const Task *, std::shared_ptr<Batch>>;
+
+                /**
+                 * @brief This function pops and executes one job if available.
+                 *
+                 * @param lock A lock on the queue mutex, released while executing the job.
+                 *
+                 * @return True if a job was executed.
+                 */
+                bool runOne(std::unique_lock<std::mutex> & lock);
+
+                /**
+                 * @brief Main loop of each worker thread.
+                 */
+                void workerLoop();
+
+                std::vector<std::thread> workers_;
+                std::deque<Job> queue_;
+                std::mutex mutex_;
+                std::condition_variable available_;
+                bool stop_;
+        };
+
+        inline ThreadPool::ThreadPool(size_t nThreads) : stop_(false) {
+            for (size_t i = 1; i < nThreads; ++i)
+                workers_.emplace_back(&ThreadPool::workerLoop, this);
+        }
+
+        inline ThreadPool::~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            available_.notify_all();
+            for (auto & t : workers_)
+                t.join();
+        }
+
+        inline size_t ThreadPool::size() const {
+            return workers_.size() + 1;
+        }
+
+        inline void ThreadPool::run(const std::vector<Task> & tasks) {
+            if (tasks.empty()) return;
+            // Nothing to share, avoid the synchronization altogether.
+            if (workers_.empty() || tasks.size() == 1) {
+                for (auto & t : tasks) t();
+                return;
+            }
+
+            auto batch = std::make_shared<Batch>();
+            batch->remaining = tasks.size();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (auto & t : tasks)
+                    queue_.emplace_back(&t, batch);
+            }
+            available_.notify_all();
+
+            // Help with the queue until it is empty, then wait for the
+            // tasks still running on the workers.
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (batch->remaining && runOne(lock));
+            lock.unlock();
+
+            std::unique_lock<std::mutex> doneLock(batch->mutex);
+            batch->done.wait(doneLock, [&batch]{ return batch->remaining == 0; });
+        }
+
+        inline bool ThreadPool::runOne(std::unique_lock<std::mutex> & lock) {
+            if (queue_.empty()) return false;
+            Job job = std::move(queue_.front());
+            queue_.pop_front();
+            lock.unlock();
+
+            (*job.first)();
+            if (--job.second->remaining == 0) {
+                std::lock_guard<std::mutex> doneLock(job.second->mutex);
+                job.second->done.notify_all();
+            }
+
+            lock.lock();
+            return true;
+        }
+
+        inline void ThreadPool::workerLoop() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (true) {
+                available_.wait(lock, [this]{ return stop_ || !queue_.empty(); });
+                if (stop_ && queue_.empty()) return;
+                runOne(lock);
+            }
+        }
+    }
+}
+
+#endif
@@ -9,6 +9,7 @@
 #include <AIToolbox/POMDP/Algorithms/Utils/Projecter.hpp>
 
 #include <AIToolbox/ProbabilityUtils.hpp>
+#include <AIToolbox/Impl/ThreadPool.hpp>
 
 #include <limits>
 
@@ -43,6 +44,11 @@ namespace AIToolbox {
          * of code and managing memory by ourselves, we use its API. It would
          * be nice if one day we could port directly into the code a fast lp
          * implementation; for now we do what we can.
+         *
+         * Since the cross-sums of different actions are independent, as are
+         * the merges at the same level of each action's merge tree, this
+         * class can spread its work over multiple threads. Each thread then
+         * uses its own lp, as an lp cannot be shared.
          */
         class IncrementalPruning {
             public:
@@ -86,6 +92,17 @@ namespace AIToolbox {
                  */
                 void setHorizon(unsigned h);
 
+                /**
+                 * @brief This function sets the number of threads used to solve.
+                 *
+                 * The number includes the calling thread, so a value of 1
+                 * (the default) solves sequentially. A value of 0 is
+                 * treated as 1.
+                 *
+                 * @param threads The new number of threads.
+                 */
+                void setThreads(size_t threads);
+
                 /**
                  * @brief This function will return the currently set epsilon parameter.
                  *
@@ -100,6 +117,13 @@ namespace AIToolbox {
                  */
                 unsigned getHorizon() const;
 
+                /**
+                 * @brief This function returns the currently set number of threads.
+                 *
+                 * @return The current number of threads.
+                 */
+                size_t getThreads() const;
+
                 /**
                  * @brief This function solves a POMDP::Model completely.
                  *
@@ -125,7 +149,7 @@ namespace AIToolbox {
 
             private:
                 /**
-                 * @brief This function computes a VList composed of all possible combinations of sums of the VLists provided.
+                 * @brief This function computes an AlphaVectorPool composed of all possible combinations of sums of the pools provided.
                  *
                  * This function performs the job of accumulating the
                  * information required to obtain the final policy. It assumes
@@ -136,18 +160,19 @@ namespace AIToolbox {
                  * new parent. This function assumes that the new parent
                  * arrives from the rhs.
                  *
-                 * @param l1 The "main" parent list.
-                 * @param l2 The list being cross-summed to l1.
+                 * @param l1 The "main" parent pool.
+                 * @param l2 The pool being cross-summed to l1.
                  * @param a The action that this cross-sum is about.
                  * @param o The observation that generated the l2 list.
                  *
                  * @return The cross-sum between l1 and l2.
                  */
-                VList crossSum(const VList & l1, const VList & l2, size_t a, bool order);
+                AlphaVectorPool crossSum(const AlphaVectorPool & l1, const AlphaVectorPool & l2, size_t a, bool order);
 
                 size_t S, A, O;
                 unsigned horizon_;
                 double epsilon_;
+                size_t threads_;
         };
 
         template <typename M, typename>
@@ -161,9 +186,20 @@ namespace AIToolbox {
 
             unsigned timestep = 0;
 
-            Pruner<WitnessLP_lpsolve> prune(S);
+            Impl::ThreadPool pool(threads_);
             Projecter<M> projecter(model);
 
+            // Each running task needs its own lp, so we keep a Pruner for
+            // each task of the largest batch, and the i-th task of a batch
+            // always uses the i-th Pruner. This way which Pruner prunes what
+            // does not depend on how the tasks get scheduled.
+            std::vector<Pruner<WitnessLP_lpsolve>> pruners;
+            pruners.reserve(A * O);
+            for ( size_t i = 0; i < A * O; ++i )
+                pruners.emplace_back(S);
+
+            std::vector<Impl::ThreadPool::Task> tasks;
+
             bool useEpsilon = checkDifferentSmall(epsilon_, 0.0);
             double variation = epsilon_ * 2; // Make it bigger
             while ( timestep < horizon_ && ( !useEpsilon || variation > epsilon_ ) ) {
@@ -175,60 +211,83 @@ namespace AIToolbox {
                 // of entries in our initial vector w.
                 auto projs = projecter(v[timestep-1]);
 
-                size_t finalWSize = 0;
                 // In this method we split the work by action, which will then
-                // be joined again at the end of the loop.
-                for ( size_t a = 0; a < A; ++a ) {
-                    // We prune each outcome separately to be sure
-                    // we do not replicate work later.
-                    for ( size_t o = 0; o < O; ++o )
-                        prune( &projs[a][o] );
-
-                    // Here we reduce at the minimum the cross-summing, by alternating
-                    // merges. We pick matches like a reverse binary tree, so that
-                    // we always pick lists that have been merged the least.
-                    //
-                    // Example for O==6:
-                    //
-                    //  0 <- 1    2 <- 3    4 <- 5    6
-                    //  0 ------> 2         4 ------> 6
-                    //            2 <---------------- 6
-
-                    bool oddOld = O % 2;
-                    int i, front = 0, back = O - oddOld, stepsize = 2, diff = 1, elements = O;
-                    while ( elements > 1 ) {
-                        for ( i = front; i != back; i += stepsize ) {
-                            projs[a][i] = crossSum(projs[a][i], projs[a][i + diff], a, stepsize > 0);
-                            prune(&projs[a][i]);
-                            --elements;
-                        }
+                // be joined again at the end of the loop. All actions are
+                // processed together, one level of their merge trees at a time.
 
-                        bool oddNew = elements % 2;
+                // We prune each outcome separately to be sure
+                // we do not replicate work later.
+                tasks.clear();
+                for ( size_t a = 0; a < A; ++a )
+                    for ( size_t o = 0; o < O; ++o ) {
+                        auto & prune = pruners[a * O + o];
+                        tasks.emplace_back([&prune, &projs, a, o]{ prune( &projs[a][o] ); });
+                    }
+                pool.run(tasks);
 
-                        int tmp   = back;
-                        back      = front - ( oddNew ? 0 : stepsize );
-                        front     = tmp   - ( oddOld ? 0 : stepsize );
-                        stepsize *= -2;
-                        diff     *= -2;
+                // Here we reduce at the minimum the cross-summing, by alternating
+                // merges. We pick matches like a reverse binary tree, so that
+                // we always pick lists that have been merged the least.
+                //
+                // Example for O==6:
+                //
+                //  0 <- 1    2 <- 3    4 <- 5    6
+                //  0 ------> 2         4 ------> 6
+                //            2 <---------------- 6
+                //
+                // The tree is the same for all actions, so all merges of a
+                // level can run concurrently.
 
-                        oddOld = oddNew;
+                bool oddOld = O % 2;
+                int i, front = 0, back = O - oddOld, stepsize = 2, diff = 1, elements = O;
+                while ( elements > 1 ) {
+                    tasks.clear();
+                    for ( i = front; i != back; i += stepsize ) {
+                        for ( size_t a = 0; a < A; ++a ) {
+                            auto & prune = pruners[tasks.size()];
+                            tasks.emplace_back([this, &prune, &projs, a, i, diff, stepsize]{
+                                projs[a][i] = crossSum(projs[a][i], projs[a][i + diff], a, stepsize > 0);
+                                prune(&projs[a][i]);
+                            });
+                        }
+                        --elements;
                     }
-                    // Put the result where we can find it
-                    std::swap(projs[a][0], projs[a][front]);
-                    finalWSize += projs[a][0].size();
-                }
-                VList w;
-                w.reserve(finalWSize);
+                    pool.run(tasks);
 
-                // Here we don't have to do fancy merging since no cross-summing is involved
-                for ( size_t a = 0; a < A; ++a )
-                    std::move(std::begin(projs[a][0]), std::end(projs[a][0]), std::back_inserter(w));
+                    bool oddNew = elements % 2;
 
-                // We have them all, and we prune one final time to be sure we have
-                // computed the parsimonious set of value functions.
-                prune( &w );
+                    int tmp   = back;
+                    back      = front - ( oddNew ? 0 : stepsize );
+                    front     = tmp   - ( oddOld ? 0 : stepsize );
+                    stepsize *= -2;
+                    diff     *= -2;
 
-                v.emplace_back(std::move(w));
+                    oddOld = oddNew;
+                }
+                // Put the results where we can find them
+                for ( size_t a = 0; a < A; ++a )
+                    std::swap(projs[a][0], projs[a][front]);
+
+                // Here we don't have to do fancy merging since no cross-summing
+                // is involved. Still, a vector that is not useful within a
+                // subset of the actions can't be useful within all of them,
+                // so we join and prune the actions pairwise, which lets
+                // the first levels run concurrently. The last join computes
+                // the parsimonious set of value functions; with a single
+                // action, the last merge above already did.
+                for ( size_t step = 1; step < A; step *= 2 ) {
+                    tasks.clear();
+                    for ( size_t a = 0; a + step < A; a += 2 * step ) {
+                        auto & prune = pruners[tasks.size()];
+                        tasks.emplace_back([&prune, &projs, a, step]{
+                            auto & w = projs[a][0];
+                            w.append(projs[a + step][0]);
+                            prune( &w );
+                        });
+                    }
+                    pool.run(tasks);
+                }
+                v.emplace_back(projs[0][0].toVList());
 
                 // Check convergence
                 if ( useEpsilon ) {
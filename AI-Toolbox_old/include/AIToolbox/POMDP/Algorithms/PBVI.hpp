@@ -111,7 +111,7 @@ namespace AIToolbox {
 
             private:
                 /**
-                 * @brief This function computes a VList composed the maximized cross-sums with respect to the provided beliefs.
+                 * @brief This function computes an AlphaVectorPool composed the maximized cross-sums with respect to the provided beliefs.
                  *
                  * This function performs the job of accumulating the
                  * information required to obtain the final policy. It
@@ -120,17 +120,17 @@ namespace AIToolbox {
                  * For each belief contained in the argument BeliefList, it
                  * will create the optimal VEntry by cherry picking the best
                  * projections for each observation. Finally it prunes the
-                 * resulting VList by removing duplicates.
+                 * resulting pool by removing duplicates.
                  *
                  * @param ProjectionsRow The type containing the projections to process.
-                 * @param projs A 1d container containing O elements: each a VList of projections for the respective observation.
+                 * @param projs A 1d container containing O elements: each a pool of projections for the respective observation.
                  * @param a The action that this cross-sum is about.
                  * @param bl The beliefs for which we are trying to find VEntries.
                  *
                  * @return The optimal cross-sum list for the given projections and BeliefList.
                  */
                 template <typename ProjectionsRow>
-                VList crossSum(const ProjectionsRow & projs, size_t a, const std::vector<Belief> & bl);
+                AlphaVectorPool crossSum(const ProjectionsRow & projs, size_t a, const std::vector<Belief> & bl);
 
                 size_t S, A, O, beliefSize_;
                 unsigned horizon_;
@@ -173,33 +173,18 @@ namespace AIToolbox {
                 // of entries in our initial vector w.
                 auto projs = projecter(v[timestep-1]);
 
-                size_t finalWSize = 0;
                 // In this method we split the work by action, which will then
                 // be joined again at the end of the loop. This is not required,
                 // but there does not seem to be a speed boost by not doing
                 // so (not that I found one, if there is one I'd like to know!)
-                for ( size_t a = 0; a < A; ++a ) {
-                    projs[a][0] = crossSum( projs[a], a, beliefs );
-                    finalWSize += projs[a][0].size();
-                }
-                VList w;
-                w.reserve(finalWSize);
-
+                AlphaVectorPool w(S, O);
+                w.reserve(A * beliefs.size());
                 for ( size_t a = 0; a < A; ++a )
-                    std::move(std::begin(projs[a][0]), std::end(projs[a][0]), std::back_inserter(w));
-
-                auto begin = std::begin(w), bound = begin, end = std::end(w);
-                for ( auto & belief : beliefs )
-                    bound = extractWorstAtBelief(belief, begin, bound, end);
+                    w.append(crossSum( projs[a], a, beliefs ));
 
-                w.erase(bound, end);
+                w.erase(extractWorstAtBeliefs(beliefs, w, 0, 0, w.size()), w.size());
 
-                // If you want to save as much memory as possible, do this.
-                // It make take some time more though since it needs to reallocate
-                // and copy stuff around.
-                // w.shrink_to_fit();
-
-                v.emplace_back(std::move(w));
+                v.emplace_back(w.toVList());
 
                 // Check convergence
                 if ( useEpsilon ) {
@@ -211,27 +196,31 @@ namespace AIToolbox {
         }
 
         template <typename ProjectionsRow>
-        VList PBVI::crossSum(const ProjectionsRow & projs, size_t a, const std::vector<Belief> & bl) {
-            VList result;
+        AlphaVectorPool PBVI::crossSum(const ProjectionsRow & projs, size_t a, const std::vector<Belief> & bl) {
+            AlphaVectorPool result(S, O);
             result.reserve(bl.size());
 
-            for ( auto & b : bl ) {
-                MDP::Values v(S); v.fill(0.0);
-                VObs obs(O);
+            for ( size_t i = 0; i < bl.size(); ++i )
+                result.push_back(a);
+
+            // We compute the crossSum between each best vector for the belief.
+            // The projections of each observation are already packed, and
+            // are evaluated at all beliefs together.
+            for ( size_t o = 0; o < O; ++o ) {
+                const AlphaVectorPool & projsO = projs[o];
+                auto bestMatches = findBestAtBeliefs(bl, projsO.alphas());
 
-                // We compute the crossSum between each best vector for the belief.
-                for ( size_t o = 0; o < O; ++o ) {
-                    const VList & projsO = projs[o];
-                    auto bestMatch = findBestAtBelief(b, std::begin(projsO), std::end(projsO));
+                for ( size_t i = 0; i < bl.size(); ++i ) {
+                    auto bestMatch = projsO.values(bestMatches[i]);
+                    auto v = result.values(i);
 
                     for ( size_t s = 0; s < S; ++s )
-                        v[s] += std::get<VALUES>(*bestMatch)[s];
+                        v[s] += bestMatch[s];
 
-                    obs[o] = std::get<OBS>(*bestMatch)[0];
+                    result.obs(i)[o] = projsO.obs(bestMatches[i])[0];
                 }
-                result.emplace_back(std::move(v), a, std::move(obs));
             }
-            result.erase(extractDominated(S, std::begin(result), std::end(result)), std::end(result));
+            result.erase(extractDominated(result, 0, result.size()), result.size());
 
             return result;
         }
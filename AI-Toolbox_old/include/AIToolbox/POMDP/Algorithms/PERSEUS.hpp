@@ -102,7 +102,7 @@ namespace AIToolbox {
             private:
 
                 /**
-                 * @brief This function computes a VList composed the maximized cross-sums with respect to the provided beliefs.
+                 * @brief This function computes an AlphaVectorPool composed the maximized cross-sums with respect to the provided beliefs.
                  *
                  * This function performs the job of accumulating the
                  * information required to obtain the final policy. It
@@ -112,17 +112,17 @@ namespace AIToolbox {
                  * improves it from the previous timestep has already been
                  * found. If not, will create the optimal VEntry by cherry
                  * picking the best projections for each observation. Finally
-                 * it prunes the resulting VList by removing duplicates.
+                 * it prunes the resulting pool by removing duplicates.
                  *
                  * @param ProjectionsRow The type containing the projections to process.
-                 * @param projs A 2d container containing AxO elements: each a VList of projections for the respective action-observation pair.
+                 * @param projs A 2d container containing AxO elements: each a pool of projections for the respective action-observation pair.
                  * @param bl The beliefs for which we are trying to find VEntries.
                  * @param oldV The previous timestep VList.
                  *
                  * @return The optimal cross-sum list for the given projections and BeliefList.
                  */
                 template <typename ProjectionsTable>
-                VList crossSum(const ProjectionsTable & projs, const std::vector<Belief> & bl, const VList & oldV);
+                AlphaVectorPool crossSum(const ProjectionsTable & projs, const std::vector<Belief> & bl, const VList & oldV);
 
                 size_t S, A, O, beliefSize_;
                 unsigned horizon_;
@@ -149,7 +149,7 @@ namespace AIToolbox {
             auto beliefs = bGen(beliefSize_);
 
             // We initialize the ValueFunction to the "worst" case scenario.
-            ValueFunction v(1, VList(1, std::make_tuple(MDP::Values(S, minReward / (1.0 - model.getDiscount())), 0, VObs(0))));
+            ValueFunction v(1, VList(1, std::make_tuple(MDP::Values::Constant(S, minReward / (1.0 - model.getDiscount())), 0, VObs(0))));
 
             unsigned timestep = 0;
 
@@ -167,7 +167,7 @@ namespace AIToolbox {
                 auto projs = projecter(v[timestep-1]);
                 // Here we find the minimum number of VEntries that we need to improve
                 // v on all beliefs from v[timestep-1].
-                v.emplace_back( crossSum( projs, beliefs, v[timestep-1] ) );
+                v.emplace_back( crossSum( projs, beliefs, v[timestep-1] ).toVList() );
 
                 // Check convergence
                 if ( useEpsilon ) {
@@ -179,41 +179,45 @@ namespace AIToolbox {
         }
 
         template <typename ProjectionsTable>
-        VList PERSEUS::crossSum(const ProjectionsTable & projs, const std::vector<Belief> & bl, const VList & oldV) {
-            VList result, helper;
+        AlphaVectorPool PERSEUS::crossSum(const ProjectionsTable & projs, const std::vector<Belief> & bl, const VList & oldV) {
+            AlphaVectorPool result(S, O), helper(S, O);
             result.reserve(bl.size());
             helper.reserve(A);
             bool start = true;
-            double currentValue, oldValue;
+            double currentValue;
 
-            for ( auto & b : bl ) {
+            // The old values do not change, so we evaluate them at all
+            // beliefs together.
+            std::vector<double> oldValues;
+            findBestAtBeliefs(bl, makeAlphaMatrix(S, std::begin(oldV), std::end(oldV)), &oldValues);
+
+            for ( size_t i = 0; i < bl.size(); ++i ) {
+                auto & b = bl[i];
                 if ( !start ) {
                     // If we have already improved this belief, skip it
-                    findBestAtBelief( b, std::begin(result), std::end(result), &currentValue );
-                    findBestAtBelief( b, std::begin(oldV),   std::end(oldV),   &oldValue     );
-                    if ( currentValue >= oldValue ) continue;
+                    findBestAtBelief( b, result, 0, result.size(), &currentValue );
+                    if ( currentValue >= oldValues[i] ) continue;
                 }
                 helper.clear();
                 for ( size_t a = 0; a < A; ++a ) {
-                    MDP::Values v(S); v.fill(0.0);
-                    VObs obs(O);
+                    size_t k = helper.push_back(a);
+                    auto v = helper.values(k);
 
                     // We compute the crossSum between each best vector for the belief.
                     for ( size_t o = 0; o < O; ++o ) {
-                        const VList & projsO = projs[a][o];
-                        auto bestMatch = findBestAtBelief(b, std::begin(projsO), std::end(projsO));
+                        const AlphaVectorPool & projsAO = projs[a][o];
+                        auto bestMatch = findBestAtBelief(b, projsAO.alphas());
 
-                        v += std::get<VALUES>(*bestMatch);
+                        v += projsAO.values(bestMatch);
 
-                        obs[o] = std::get<OBS>(*bestMatch)[0];
+                        helper.obs(k)[o] = projsAO.obs(bestMatch)[0];
                     }
-                    helper.emplace_back(std::move(v), a, std::move(obs));
                 }
-                extractWorstAtBelief(b, std::begin(helper), std::begin(helper), std::end(helper));
-                result.emplace_back(std::move(helper[0]));
+                extractWorstAtBelief(b, helper, 0, 0, helper.size());
+                result.push_back(helper, 0);
                 start = false;
             }
-            result.erase(extractDominated(S, std::begin(result), std::end(result)), std::end(result));
+            result.erase(extractDominated(result, 0, result.size()), result.size());
 
             return result;
         }
@@ -167,6 +167,13 @@ namespace AIToolbox {
                  */
                 void setExploration(double exp);
 
+                /**
+                 * @brief This function reseeds the internal random engine.
+                 *
+                 * @param seed The new seed.
+                 */
+                void setSeed(unsigned seed);
+
                 /**
                  * @brief This function returns the POMDP generative model being used.
                  *
@@ -498,6 +505,11 @@ namespace AIToolbox {
             exploration_ = exp;
         }
 
+        template <typename M>
+        void POMCP<M>::setSeed(unsigned seed) {
+            rand_.seed(seed);
+        }
+
         template <typename M>
         const M& POMCP<M>::getModel() const {
             return model_;
@@ -3,6 +3,7 @@
 
 #include <AIToolbox/ProbabilityUtils.hpp>
 #include <AIToolbox/POMDP/Types.hpp>
+#include <AIToolbox/POMDP/AlphaVectorPool.hpp>
 
 namespace AIToolbox {
     namespace POMDP {
@@ -14,12 +15,15 @@ namespace AIToolbox {
 #endif
         /**
          * @brief This class offers projecting facilities for Models.
+         *
+         * The projections for each action-observation pair are returned in
+         * an AlphaVectorPool, so that each list is a single allocation.
          */
         template <typename M>
         class Projecter<M> {
             public:
-                using ProjectionsTable          = boost::multi_array<VList, 2>;
-                using ProjectionsRow            = boost::multi_array<VList, 1>;
+                using ProjectionsTable          = boost::multi_array<AlphaVectorPool, 2>;
+                using ProjectionsRow            = boost::multi_array<AlphaVectorPool, 1>;
 
                 /**
                  * @brief Basic constructor.
@@ -37,7 +41,7 @@ namespace AIToolbox {
                  *
                  * @param w The list that needs to be projected.
                  *
-                 * @return A 2d array of projection lists.
+                 * @return A 2d array of projection pools.
                  */
                 ProjectionsTable operator()(const VList & w);
 
@@ -47,7 +51,7 @@ namespace AIToolbox {
                  * @param w The list that needs to be projected.
                  * @param a The action used for projecting the list.
                  *
-                 * @return A 1d array of projection lists.
+                 * @return A 1d array of projection pools.
                  */
                 ProjectionsRow operator()(const VList & w, size_t a);
 
@@ -94,7 +98,10 @@ namespace AIToolbox {
         typename Projecter<M>::ProjectionsRow Projecter<M>::operator()(const VList & w, size_t a) {
             ProjectionsRow projections( boost::extents[O] );
 
+            Matrix2D transitionObservation(S, S);
             for ( size_t o = 0; o < O; ++o ) {
+                auto & projsO = projections[o];
+                projsO = AlphaVectorPool(S, 1);
                 // Here we put in just the immediate rewards so that the cross-summing step in the main
                 // function works correctly. However we communicate via the boolean that pruning should
                 // not be done at this step (since adding constants shouldn't do anything anyway).
@@ -103,23 +110,30 @@ namespace AIToolbox {
                     // note that this fake ID of 0 should never be used, so it should be safe to avoid
                     // setting it to a special value like -1. If one really wants to check, he/she can
                     // just look at the observation table and the belief and see if it makes sense.
-                    projections[o].emplace_back(immediateRewards_.row(a), a, VObs(1,0));
+                    projsO.values(projsO.push_back(a)) = immediateRewards_.row(a).transpose();
                     continue;
                 }
 
+                // The model is only queried once per observation, rather than once per projected vector.
+                for ( size_t s = 0; s < S; ++s )
+                    for ( size_t s1 = 0; s1 < S; ++s1 )
+                        transitionObservation(s, s1) = model_.getTransitionProbability(s,a,s1) * model_.getObservationProbability(s1,a,o);
+
                 // Otherwise we compute a projection for each ValueFunction supplied to us.
+                projsO.reserve(w.size());
                 for ( size_t i = 0; i < w.size(); ++i ) {
                     auto & v = std::get<VALUES>(w[i]);
-                    MDP::Values vproj(S); vproj.fill(0.0);
+                    size_t p = projsO.push_back(a);
+                    auto vproj = projsO.values(p);
                     // For each value function in the previous timestep, we compute the new value
                     // if we performed action a and obtained observation o.
                     for ( size_t s = 0; s < S; ++s )
                         // vproj_{a,o}[s] = R(s,a) / |O| + discount * sum_{s'} ( T(s,a,s') * O(s',a,o) * v_{t-1}(s') )
                         for ( size_t s1 = 0; s1 < S; ++s1 )
-                            vproj[s] += model_.getTransitionProbability(s,a,s1) * model_.getObservationProbability(s1,a,o) * v[s1];
+                            vproj[s] += transitionObservation(s, s1) * v[s1];
                     // Set new projection with found value and previous V id.
-                    // projections[o].emplace_back(vproj, a, VObs(1,i));
-                    projections[o].emplace_back(vproj * discount_ + immediateRewards_.row(a).transpose(), a, VObs(1,i));
+                    vproj = vproj * discount_ + immediateRewards_.row(a).transpose();
+                    projsO.obs(p)[0] = i;
                 }
             }
 
@@ -1,6 +1,9 @@
 #ifndef AI_TOOLBOX_POMDP_PRUNER_HEADER_FILE
 #define AI_TOOLBOX_POMDP_PRUNER_HEADER_FILE
 
+#include <algorithm>
+#include <limits>
+#include <random>
 #include <utility>
 
 #include <AIToolbox/POMDP/Types.hpp>
@@ -17,37 +20,112 @@ namespace AIToolbox {
 #endif
         /**
          * @brief This class offers pruning facilities for non-parsimonious ValueFunction sets.
+         *
+         * Before solving any lp, the Pruner looks for the best vectors at a
+         * fixed set of beliefs: the simplex corners, the uniform belief and
+         * a number of random beliefs. A vector which is the best at one of
+         * them by a clear margin is certainly useful, and does not need its
+         * own lp to be discovered. Since these lookups are done as a single
+         * matrix product, they are way cheaper than even a single lp.
+         *
+         * The random beliefs only depend on S and on their number, so the
+         * result of a pruning only depends on its input. Optionally, the
+         * Pruner can also look at the most recent witness points found by
+         * its lp in previous prunings; its results then also depend on
+         * what it pruned before.
          */
         template <typename WitnessLP>
         class Pruner<WitnessLP> {
             public:
-                Pruner(size_t S);
+                /**
+                 * @brief Basic constructor.
+                 *
+                 * @param S The number of states of the vectors to prune.
+                 * @param nBeliefs The number of random beliefs, and of recent witness points, to look at before solving lps.
+                 * @param keepWitnesses Whether to look at the witness points found in previous prunings.
+                 */
+                Pruner(size_t S, size_t nBeliefs = 16, bool keepWitnesses = false);
+
+                /**
+                 * @brief This function prunes all non useful ValueFunctions from the provided AlphaVectorPool.
+                 *
+                 * @param w The pool that needs to be pruned.
+                 */
+                void operator()(AlphaVectorPool * w);
+
+                /**
+                 * @brief This function returns the number of lps solved during the last pruning.
+                 *
+                 * @return The number of calls to the lp's findWitness().
+                 */
+                size_t getLastLPCalls() const;
 
                 /**
-                 * @brief This function prunes all non useful ValueFunctions from the provided VList.
+                 * @brief This function returns the number of lps saved by the belief lookups during the last pruning.
+                 *
+                 * This is the number of vectors found at the uniform, random
+                 * and kept witness beliefs, but not at the simplex corners. Each
+                 * of them would have otherwise required a successful lp to
+                 * be found.
                  *
-                 * @param w The list that needs to be pruned.
+                 * @return The number of saved calls to the lp's findWitness().
                  */
-                void operator()(VList * w);
+                size_t getLastSavedLPCalls() const;
 
             private:
-                size_t S;
+                /**
+                 * @brief This function moves the clearly best vectors at the stored beliefs at the beginning of the specified range.
+                 *
+                 * Vectors which are only better than the others by less than
+                 * the rounding errors, or than the tolerance of the lp, are
+                 * not extracted, as the lp would not consider them useful.
+                 *
+                 * @param w The pool to search in.
+                 * @param begin The begin of the search range.
+                 * @param bound The begin of the 'useful' range.
+                 * @param end The end of the search range. It is NOT included in the search.
+                 *
+                 * @return The new bound.
+                 */
+                size_t extractBestAtBeliefs(AlphaVectorPool & w, size_t begin, size_t bound, size_t end);
+
+                size_t S, nBeliefs_;
+                bool keepWitnesses_;
+                // One belief per row: the uniform and random beliefs first,
+                // then the kept witness points.
+                Matrix2D beliefs_;
+                size_t storedBeliefs_, nextWitness_;
+                size_t lpCalls_, savedLPCalls_;
 
                 WitnessLP lp;
         };
 
         template <typename WitnessLP>
-        Pruner<WitnessLP>::Pruner(size_t s) : S(s), lp(s) {}
+        Pruner<WitnessLP>::Pruner(size_t s, size_t nBeliefs, bool keepWitnesses) :
+                S(s), nBeliefs_(nBeliefs), keepWitnesses_(keepWitnesses), beliefs_(1 + (keepWitnesses ? 2 : 1) * nBeliefs, s),
+                storedBeliefs_(1 + nBeliefs), nextWitness_(0), lpCalls_(0), savedLPCalls_(0), lp(s)
+        {
+            // Seeded from the parameters only, so that all Pruners with the
+            // same parameters look at the same beliefs.
+            std::seed_seq seq{static_cast<unsigned>(S), static_cast<unsigned>(nBeliefs_)};
+            std::default_random_engine rand(seq);
+
+            beliefs_.row(0).fill(1.0/S);
+            for ( size_t i = 1; i <= nBeliefs_; ++i )
+                beliefs_.row(i) = makeRandomBelief(S, rand).transpose();
+        }
 
         // The idea is that the input thing already has all the best vectors,
         // thus we only need to find them and discard the others.
         template <typename WitnessLP>
-        void Pruner<WitnessLP>::operator()(VList * pw) {
+        void Pruner<WitnessLP>::operator()(AlphaVectorPool * pw) {
             if ( !pw ) return;
             auto & w = *pw;
 
+            lpCalls_ = savedLPCalls_ = 0;
+
             // Remove easy ValueFunctions to avoid doing more work later.
-            w.erase(extractDominated(S, std::begin(w), std::end(w)), std::end(w));
+            w.erase(extractDominated(w, 0, w.size()), w.size());
 
             size_t size = w.size();
             if ( size < 2 ) return;
@@ -58,16 +136,18 @@ namespace AIToolbox {
 
             // Initialize the new best list with some easy finds, and remove them from
             // the old list.
-            VList::iterator begin = std::begin(w), end = std::end(w), bound = begin;
+            size_t begin = 0, end = size, bound = begin;
 
-            bound = extractWorstAtSimplexCorners(S, begin, bound, end);
+            bound = extractWorstAtSimplexCorners(w, begin, bound, end);
+            const size_t corners = bound;
 
-            // Here we could do some random belief lookups..
+            bound = extractBestAtBeliefs(w, begin, bound, end);
+            savedLPCalls_ = bound - corners;
 
             // Setup initial LP rows. Note that best can't be empty, since we have
             // at least one best for the simplex corners.
-            for ( auto it = begin; it != bound; ++it )
-                lp.addOptimalRow(std::get<VALUES>(*it));
+            for ( size_t i = begin; i != bound; ++i )
+                lp.addOptimalRow(w.values(i));
 
             // For each of the remaining points now we try to find a witness
             // point with respect to the best ones. If there is, there is
@@ -79,13 +159,22 @@ namespace AIToolbox {
             //
             // That we do in the findWitnessPoint function.
             while ( bound < end ) {
-                auto result = lp.findWitness( std::get<VALUES>(*(end-1)) );
+                auto result = lp.findWitness( w.values(end-1) );
+                ++lpCalls_;
                 // If we get a belief point, we search for the actual vector that provides
                 // the best value on the belief point, we move it into the best vector.
                 if ( std::get<0>(result) ) {
                     auto & witness = std::get<1>(result);
-                    bound = extractWorstAtBelief(witness, bound, bound, end);   // Advance bound with the next best
-                    lp.addOptimalRow(std::get<VALUES>(*(bound-1)));             // Add the newly found vector to our lp.
+                    bound = extractWorstAtBelief(witness, w, bound, bound, end);    // Advance bound with the next best
+                    lp.addOptimalRow(w.values(bound-1));                            // Add the newly found vector to our lp.
+
+                    // We remember the witness for the next prunings, which
+                    // likely have vectors changing around the same beliefs.
+                    if ( keepWitnesses_ && nBeliefs_ ) {
+                        beliefs_.row(1 + nBeliefs_ + nextWitness_) = witness.transpose();
+                        storedBeliefs_ = std::max(storedBeliefs_, 2 + nBeliefs_ + nextWitness_);
+                        nextWitness_ = (nextWitness_ + 1) % nBeliefs_;
+                    }
                 }
                 // We only advance if we did not find anything. Otherwise, we may have found a
                 // witness point for the current value, but since we are not guaranteed to have
@@ -95,7 +184,46 @@ namespace AIToolbox {
             }
 
             // Finally, we discard all bad vectors and we return just the best list.
-            w.erase(bound, std::end(w));
+            w.erase(bound, w.size());
+        }
+
+        template <typename WitnessLP>
+        size_t Pruner<WitnessLP>::extractBestAtBeliefs(AlphaVectorPool & w, size_t begin, size_t bound, size_t end) {
+            const auto alphas = w.alphas(begin, end);
+            const size_t N = alphas.cols();
+
+            const Matrix2D scores = beliefs_.topRows(storedBeliefs_) * alphas;
+            const double margin = 1e-9 * std::max(1.0, alphas.cwiseAbs().maxCoeff());
+
+            std::vector<size_t> best;
+            for ( size_t i = 0; i < storedBeliefs_; ++i ) {
+                size_t first = 0;
+                double firstValue = scores(i, 0), secondValue = -std::numeric_limits<double>::infinity();
+                for ( size_t j = 1; j < N; ++j ) {
+                    const double v = scores(i, j);
+                    if ( v > firstValue ) {
+                        secondValue = firstValue;
+                        firstValue = v;
+                        first = j;
+                    } else if ( v > secondValue )
+                        secondValue = v;
+                }
+                if ( firstValue - secondValue > margin )
+                    best.push_back(first);
+            }
+
+            return begin + partitionWorstAtBeliefs(alphas, best, bound - begin,
+                                                   [&w, begin](size_t i, size_t j) { w.swap(begin + i, begin + j); });
+        }
+
+        template <typename WitnessLP>
+        size_t Pruner<WitnessLP>::getLastLPCalls() const {
+            return lpCalls_;
+        }
+
+        template <typename WitnessLP>
+        size_t Pruner<WitnessLP>::getLastSavedLPCalls() const {
+            return savedLPCalls_;
         }
     }
 }
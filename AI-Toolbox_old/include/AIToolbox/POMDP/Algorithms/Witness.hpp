@@ -128,11 +128,10 @@ namespace AIToolbox {
                  * @param projs The projections to use.
                  * @param a The action for the cross-sum.
                  * @param b The belief to use.
-                 *
-                 * @return The best possible cross-sum for the provided belief.
+                 * @param result The pool where to append the best possible cross-sum for the provided belief.
                  */
                 template <typename ProjectionsRow>
-                VEntry crossSumBestAtBelief(const ProjectionsRow & projs, size_t a, const Belief & b);
+                void crossSumBestAtBelief(const ProjectionsRow & projs, size_t a, const Belief & b, AlphaVectorPool * result);
 
                 /**
                  * @brief This function adds a default cross-sum to the agenda, to start off the algorithm.
@@ -148,16 +147,17 @@ namespace AIToolbox {
                  *
                  * @param projs The projections from which the VEntry was derived.
                  * @param a The action for the cross-sums.
-                 * @param variated The VEntry to use as a base.
+                 * @param variated The pool containing the VEntry to use as a base.
+                 * @param id The index of the VEntry in the pool.
                  */
                 template <typename ProjectionsRow>
-                void addVariations(const ProjectionsRow & projs, size_t a, const VEntry & variated);
+                void addVariations(const ProjectionsRow & projs, size_t a, const AlphaVectorPool & variated, size_t id);
 
                 size_t S, A, O;
                 unsigned horizon_;
                 double epsilon_;
 
-                VList agenda_;
+                AlphaVectorPool agenda_;
                 std::unordered_set<VObs, boost::hash<VObs>> triedVectors_;
         };
 
@@ -167,7 +167,8 @@ namespace AIToolbox {
             A = model.getA();
             O = model.getO();
 
-            std::vector<VList> U(A);
+            std::vector<AlphaVectorPool> U(A, AlphaVectorPool(S, O));
+            agenda_ = AlphaVectorPool(S, O);
 
             ValueFunction v(1, VList(1, makeVEntry(S))); // TODO: May take user input
 
@@ -214,14 +215,14 @@ namespace AIToolbox {
 
                     // We check whether any element in the agenda improves what we have
                     while ( !agenda_.empty() ) {
-                        auto result = lp.findWitness( std::get<VALUES>(agenda_.back()) );
+                        auto result = lp.findWitness( agenda_.values(agenda_.size() - 1) );
                         if ( std::get<0>(result) ) {
                             auto & witness = std::get<1>(result);
                             // If so, we generate the best vector for that particular belief point.
-                            U[a].push_back(crossSumBestAtBelief(projections[a], a, witness));
-                            lp.addOptimalRow(std::get<VALUES>(U[a].back()));
+                            crossSumBestAtBelief(projections[a], a, witness, &U[a]);
+                            lp.addOptimalRow(U[a].values(U[a].size() - 1));
                             // We add to the agenda all possible "variations" of the VEntry found.
-                            addVariations(projections[a], a, U[a].back());
+                            addVariations(projections[a], a, U[a], U[a].size() - 1);
                             // We manually check memory for the lp, since this method
                             // cannot know in advance how many rows it'll need to do.
                             if ( ++counter == reserveSize ) {
@@ -234,17 +235,17 @@ namespace AIToolbox {
                     }
                     finalWSize += U[a].size();
                 }
-                VList w;
+                AlphaVectorPool w(S, O);
                 w.reserve(finalWSize);
 
                 // We put together all VEntries we found.
                 for ( size_t a = 0; a < A; ++a )
-                    std::move(std::begin(U[a]), std::end(U[a]), std::back_inserter(w));
+                    w.append(U[a]);
 
                 // We have them all, and we prune one final time to be sure we have
                 // computed the parsimonious set of value functions.
                 prune( &w );
-                v.emplace_back(std::move(w));
+                v.emplace_back(w.toVList());
 
                 // Check convergence
                 if ( useEpsilon ) {
@@ -256,44 +257,41 @@ namespace AIToolbox {
         }
 
         template <typename ProjectionsRow>
-        POMDP::VEntry Witness::crossSumBestAtBelief(const ProjectionsRow & projs, size_t a, const Belief & b) {
-            MDP::Values v(S); v.fill(0.0);
-            VObs obs(O);
+        void Witness::crossSumBestAtBelief(const ProjectionsRow & projs, size_t a, const Belief & b, AlphaVectorPool * result) {
+            size_t i = result->push_back(a);
+            auto v = result->values(i);
+            auto obs = result->obs(i);
 
             // We compute the crossSum between each best vector for the belief.
             for ( size_t o = 0; o < O; ++o ) {
-                const VList & projsO = projs[o];
-                auto bestMatch = findBestAtBelief(b, std::begin(projsO), std::end(projsO));
+                const AlphaVectorPool & projsO = projs[o];
+                auto bestMatch = findBestAtBelief(b, projsO, 0, projsO.size());
 
                 for ( size_t s = 0; s < S; ++s )
-                    v[s] += std::get<VALUES>(*bestMatch)[s];
+                    v[s] += projsO.values(bestMatch)[s];
 
-                obs[o] = std::get<OBS>(*bestMatch)[0];
+                obs[o] = projsO.obs(bestMatch)[0];
             }
-
-            return std::make_tuple(std::move(v), a, std::move(obs));
         }
 
         template <typename ProjectionsRow>
         void Witness::addDefaultEntry(const ProjectionsRow & projs, size_t a) {
-            MDP::Values v(S); v.fill(0.0);
-            VObs obs(O, 0);
+            auto v = agenda_.values(agenda_.push_back(a));
 
             // We compute the crossSum between each best vector for the belief.
             for ( size_t o = 0; o < O; ++o ) {
                 for ( size_t s = 0; s < S; ++s )
-                    v[s] += std::get<VALUES>(projs[o][0])[s];
+                    v[s] += projs[o].values(0)[s];
             }
 
-            triedVectors_.insert(obs);
-            agenda_.emplace_back(std::move(v), a, std::move(obs));
+            triedVectors_.insert(VObs(O, 0));
         }
 
         template <typename ProjectionsRow>
-        void Witness::addVariations(const ProjectionsRow & projs, size_t a, const VEntry & variated) {
+        void Witness::addVariations(const ProjectionsRow & projs, size_t a, const AlphaVectorPool & variated, size_t id) {
             // We need to copy this one unfortunately
-            auto   vObs    = std::get<OBS>   (variated);
-            auto & vValues = std::get<VALUES>(variated);
+            VObs vObs(variated.obs(id), variated.obs(id) + O);
+            auto vValues = variated.values(id);
 
             for ( size_t o = 0; o < O; ++o ) {
                 size_t skip = vObs[o];
@@ -305,15 +303,16 @@ namespace AIToolbox {
                     if ( triedVectors_.find(vObs) != std::end(triedVectors_) ) continue;
 
                     // Allocate only when needed
-                    auto obs = vObs;
-                    auto v = vValues;
+                    size_t k = agenda_.push_back(a);
+                    auto v = agenda_.values(k);
+                    v = vValues;
 
                     for ( size_t s = 0; s < S; ++s ) {
-                        v[s] -= std::get<VALUES>(projs[o][skip])[s];
-                        v[s] += std::get<VALUES>(projs[o][i])[s];
+                        v[s] -= projs[o].values(skip)[s];
+                        v[s] += projs[o].values(i)[s];
                     }
-                    triedVectors_.insert(obs);
-                    agenda_.emplace_back(std::move(v), a, std::move(obs));
+                    std::copy(std::begin(vObs), std::end(vObs), agenda_.obs(k));
+                    triedVectors_.insert(vObs);
                 }
                 vObs[o] = skip;
             }
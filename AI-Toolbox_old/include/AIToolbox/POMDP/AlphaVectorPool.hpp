@@ -0,0 +1,278 @@
+#ifndef AI_TOOLBOX_POMDP_ALPHA_VECTOR_POOL_HEADER_FILE
+#define AI_TOOLBOX_POMDP_ALPHA_VECTOR_POOL_HEADER_FILE
+
+#include <cstddef>
+#include <vector>
+
+#include <AIToolbox/POMDP/Types.hpp>
+
+namespace AIToolbox {
+    namespace POMDP {
+        /**
+         * @brief This class keeps a list of VEntries in contiguous memory.
+         *
+         * A VList stores each VEntry separately, with its values and its
+         * observation indeces in two different heap allocations. This class
+         * keeps the same data in three flat buffers instead: the values are
+         * the rows of a single row-major matrix, while the actions and the
+         * observation indeces are kept in parallel arrays. Each row is padded
+         * so that it starts at an address aligned for Eigen's vectorization,
+         * and the values of an entry can then be used as an MDP::Values.
+         *
+         * All entries in a pool have the same number of observation indeces.
+         *
+         * Entries are only appended at the end, and the pool is shrunk by
+         * erasing a range, which moves the following entries down. The
+         * functions in POMDP/Utils.hpp which work on VList ranges have
+         * overloads which take a pool and indeces instead, and which swap
+         * the entries in the same way.
+         */
+        class AlphaVectorPool {
+            public:
+#if EIGEN_VERSION_AT_LEAST(3,3,0)
+                enum { Alignment = Eigen::AlignedMax };
+#else
+                enum { Alignment = Eigen::Aligned };
+#endif
+                using Values      = Eigen::Map<MDP::Values, Alignment>;
+                using ConstValues = Eigen::Map<const MDP::Values, Alignment>;
+                using Alphas      = Eigen::Map<const AlphaMatrix, Alignment, Eigen::OuterStride<>>;
+
+                /**
+                 * @brief Basic constructor.
+                 *
+                 * @param S The number of states of each entry.
+                 * @param O The number of observation indeces of each entry.
+                 */
+                AlphaVectorPool(size_t S = 0, size_t O = 0);
+
+                /**
+                 * @brief This constructor copies a VList into a new pool.
+                 *
+                 * The number of observation indeces is taken from the first
+                 * VEntry, and must be the same for all of them.
+                 *
+                 * @param S The number of states of each entry.
+                 * @param w The VList to copy.
+                 */
+                AlphaVectorPool(size_t S, const VList & w);
+
+                /**
+                 * @brief This function copies the pool into a VList.
+                 *
+                 * @return A VList with the same entries in the same order.
+                 */
+                VList toVList() const;
+
+                /**
+                 * @brief This function reserves space for a number of entries.
+                 *
+                 * @param n The number of entries to reserve space for.
+                 */
+                void reserve(size_t n);
+
+                /**
+                 * @brief This function appends an entry to the pool.
+                 *
+                 * The values and the observation indeces of the new entry
+                 * are all zero.
+                 *
+                 * @param a The action of the new entry.
+                 *
+                 * @return The index of the new entry.
+                 */
+                size_t push_back(size_t a);
+
+                /**
+                 * @brief This function appends a copy of an entry of another pool.
+                 *
+                 * @param other The pool to copy from, with the same sizes as this one.
+                 * @param i The index of the entry to copy.
+                 *
+                 * @return The index of the new entry.
+                 */
+                size_t push_back(const AlphaVectorPool & other, size_t i);
+
+                /**
+                 * @brief This function appends all the entries of another pool.
+                 *
+                 * @param other The pool to copy from, with the same sizes as this one.
+                 */
+                void append(const AlphaVectorPool & other);
+
+                /**
+                 * @brief This function removes the last entry of the pool.
+                 */
+                void pop_back();
+
+                /**
+                 * @brief This function removes a range of entries.
+                 *
+                 * The entries after the range are moved down to fill it,
+                 * in order. The memory is not released.
+                 *
+                 * @param begin The first entry to remove.
+                 * @param end The end of the range to remove (excluded).
+                 */
+                void erase(size_t begin, size_t end);
+
+                /**
+                 * @brief This function removes all entries, without releasing memory.
+                 */
+                void clear();
+
+                /**
+                 * @brief This function swaps two entries.
+                 *
+                 * @param i The first entry.
+                 * @param j The second entry.
+                 */
+                void swap(size_t i, size_t j);
+
+                /**
+                 * @brief This function returns the values of an entry.
+                 *
+                 * @param i The index of the entry.
+                 *
+                 * @return An aligned map to its values.
+                 */
+                Values values(size_t i);
+
+                /**
+                 * @brief This function returns the values of an entry.
+                 *
+                 * @param i The index of the entry.
+                 *
+                 * @return An aligned map to its values.
+                 */
+                ConstValues values(size_t i) const;
+
+                /**
+                 * @brief This function returns the action of an entry.
+                 *
+                 * @param i The index of the entry.
+                 *
+                 * @return A reference to its action.
+                 */
+                size_t & action(size_t i);
+
+                /**
+                 * @brief This function returns the action of an entry.
+                 *
+                 * @param i The index of the entry.
+                 *
+                 * @return Its action.
+                 */
+                size_t action(size_t i) const;
+
+                /**
+                 * @brief This function returns the observation indeces of an entry.
+                 *
+                 * @param i The index of the entry.
+                 *
+                 * @return A pointer to its getO() observation indeces.
+                 */
+                size_t * obs(size_t i);
+
+                /**
+                 * @brief This function returns the observation indeces of an entry.
+                 *
+                 * @param i The index of the entry.
+                 *
+                 * @return A pointer to its getO() observation indeces.
+                 */
+                const size_t * obs(size_t i) const;
+
+                /**
+                 * @brief This function returns a range of entries as an AlphaMatrix.
+                 *
+                 * No copy is made: the matrix maps the rows of the pool as
+                 * its columns, and is invalidated when the pool grows.
+                 *
+                 * @param begin The first entry of the range.
+                 * @param end The end of the range (excluded).
+                 *
+                 * @return An S x (end - begin) matrix with the values of the entries.
+                 */
+                Alphas alphas(size_t begin, size_t end) const;
+
+                /**
+                 * @brief This function returns all entries as an AlphaMatrix.
+                 *
+                 * @return An S x size() matrix with the values of the entries.
+                 */
+                Alphas alphas() const;
+
+                /**
+                 * @brief This function returns the number of entries in the pool.
+                 *
+                 * @return The number of entries.
+                 */
+                size_t size() const;
+
+                /**
+                 * @brief This function returns whether the pool is empty.
+                 *
+                 * @return True if there are no entries.
+                 */
+                bool empty() const;
+
+                /**
+                 * @brief This function returns the number of states of each entry.
+                 *
+                 * @return The number of states.
+                 */
+                size_t getS() const;
+
+                /**
+                 * @brief This function returns the number of observation indeces of each entry.
+                 *
+                 * @return The number of observation indeces.
+                 */
+                size_t getO() const;
+
+            private:
+                /**
+                 * @brief This function makes sure there is space for at least n entries.
+                 *
+                 * @param n The number of entries.
+                 */
+                void grow(size_t n);
+
+                size_t S, O, stride_, size_;
+
+                Matrix2D values_;
+                std::vector<size_t> actions_;
+                VObs obs_;
+        };
+
+        inline AlphaVectorPool::Values AlphaVectorPool::values(size_t i) {
+            return Values(values_.data() + i * stride_, S);
+        }
+
+        inline AlphaVectorPool::ConstValues AlphaVectorPool::values(size_t i) const {
+            return ConstValues(values_.data() + i * stride_, S);
+        }
+
+        inline size_t & AlphaVectorPool::action(size_t i) { return actions_[i]; }
+        inline size_t AlphaVectorPool::action(size_t i) const { return actions_[i]; }
+
+        inline size_t * AlphaVectorPool::obs(size_t i) { return obs_.data() + i * O; }
+        inline const size_t * AlphaVectorPool::obs(size_t i) const { return obs_.data() + i * O; }
+
+        inline AlphaVectorPool::Alphas AlphaVectorPool::alphas(size_t begin, size_t end) const {
+            return Alphas(values_.data() + begin * stride_, S, end - begin, Eigen::OuterStride<>(stride_));
+        }
+
+        inline AlphaVectorPool::Alphas AlphaVectorPool::alphas() const {
+            return alphas(0, size_);
+        }
+
+        inline size_t AlphaVectorPool::size() const { return size_; }
+        inline bool AlphaVectorPool::empty() const { return !size_; }
+        inline size_t AlphaVectorPool::getS() const { return S; }
+        inline size_t AlphaVectorPool::getO() const { return O; }
+    }
+}
+
+#endif
@@ -58,6 +58,13 @@ namespace AIToolbox {
         using VList         = std::vector<VEntry>;
         using ValueFunction = std::vector<VList>;
 
+        /**
+         * @brief This represents the values of several VEntries, one per column.
+         *
+         * See makeAlphaMatrix() and findBestAtBeliefs().
+         */
+        using AlphaMatrix   = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor | Eigen::AutoAlign>;
+
         /** @}  */
 
         /**
@@ -1,15 +1,22 @@
 #ifndef AI_TOOLBOX_POMDP_UTILS_HEADER_FILE
 #define AI_TOOLBOX_POMDP_UTILS_HEADER_FILE
 
+#include <algorithm>
 #include <cstddef>
 #include <iterator>
 #include <numeric>
+#include <vector>
 
 #include <AIToolbox/ProbabilityUtils.hpp>
 #include <AIToolbox/Utils.hpp>
 #include <AIToolbox/POMDP/Types.hpp>
+#include <AIToolbox/POMDP/AlphaVectorPool.hpp>
 
 namespace AIToolbox {
+    namespace Impl {
+        class ThreadPool;
+    }
+
     namespace POMDP {
         /**
          * @brief This function creates an empty VEntry.
@@ -382,6 +389,74 @@ namespace AIToolbox {
             return bestMatch;
         }
 
+        /**
+         * @brief This function packs the values of a range of VEntries in an AlphaMatrix.
+         *
+         * The matrix can then be used to find the best VEntry at many beliefs
+         * without going through the VList again.
+         *
+         * @tparam Iterator An iterator, can be const or not, from VList.
+         * @param S The number of states in the Model.
+         * @param begin The start of the range to pack.
+         * @param end The end of the range to pack (excluded).
+         *
+         * @return An S x N matrix, whose i-th column holds the values of the i-th VEntry.
+         */
+        template <typename Iterator>
+        AlphaMatrix makeAlphaMatrix(size_t S, Iterator begin, Iterator end) {
+            AlphaMatrix alphas(S, std::distance(begin, end));
+            for ( size_t i = 0; begin != end; ++begin, ++i )
+                alphas.col(i) = std::get<VALUES>(*begin);
+            return alphas;
+        }
+
+        /**
+         * @brief This function returns the index of the column of an AlphaMatrix with the best value for the specified belief.
+         *
+         * This is findBestAtBelief() on the packed VEntries, with the same
+         * result and value.
+         *
+         * @param b The belief to evaluate.
+         * @param alphas The packed VEntries, which must not be empty.
+         * @param value A pointer to double, which gets set to the value of the given belief with the found column.
+         *
+         * @return The index of the best column.
+         */
+        size_t findBestAtBelief(const Belief & b, const Eigen::Ref<const AlphaMatrix> & alphas, double * value = nullptr);
+
+        /**
+         * @brief This function returns the index of the column of an AlphaMatrix with the best value for each of the specified beliefs.
+         *
+         * The beliefs are evaluated in blocks, each with a single matrix
+         * product. Since the product does not round as a dot product does,
+         * the columns within its error bound of the best one are then
+         * evaluated again one by one, so that the result, ties included, is
+         * the same as calling findBestAtBelief() on each belief.
+         *
+         * @param beliefs The beliefs to evaluate.
+         * @param alphas The packed VEntries, which must not be empty.
+         * @param values If not null, it is set to the value of each belief with its best column.
+         *
+         * @return The index of the best column for each belief.
+         */
+        std::vector<size_t> findBestAtBeliefs(const std::vector<Belief> & beliefs, const Eigen::Ref<const AlphaMatrix> & alphas, std::vector<double> * values = nullptr);
+
+        /**
+         * @brief This function returns the index of the entry of an AlphaVectorPool with the best value for the specified belief.
+         *
+         * This is findBestAtBelief() on a range of the pool, with the same
+         * result.
+         *
+         * @param b The belief to evaluate.
+         * @param w The pool to look in.
+         * @param begin The start of the range to look in.
+         * @param end The end of the range to look in (excluded).
+         * @param value A pointer to double, which gets set to the value of the given belief with the found entry.
+         *
+         * @return The index of the best entry in range.
+         */
+        size_t findBestAtBelief(const Belief & b, const AlphaVectorPool & w, size_t begin, size_t end, double * value = nullptr);
+
         /**
          * @brief This function returns an iterator pointing to the best value for the specified corner of the simplex space.
          *
@@ -412,6 +487,19 @@ namespace AIToolbox {
             return bestMatch;
         }
 
+        /**
+         * @brief This function returns the index of the entry of an AlphaVectorPool with the best value for the specified corner of the simplex space.
+         *
+         * @param corner The corner of the belief space we are checking.
+         * @param w The pool to look in.
+         * @param begin The start of the range to look in.
+         * @param end The end of the range to look in (excluded).
+         * @param value A pointer to double, which gets set to the value of the corner with the found entry.
+         *
+         * @return The index of the best entry in range.
+         */
+        size_t findBestAtSimplexCorner(size_t corner, const AlphaVectorPool & w, size_t begin, size_t end, double * value = nullptr);
+
         /**
          * @brief This function finds and moves the ValueFunction with the highest value for the given belief at the beginning of the specified range.
          *
@@ -439,6 +527,119 @@ namespace AIToolbox {
             return bound;
         }
 
+        /**
+         * @brief This function finds and moves the entry of an AlphaVectorPool with the highest value for the given belief at the beginning of the specified range.
+         *
+         * This is extractWorstAtBelief() on a range of the pool.
+         *
+         * @param b The belief to evaluate.
+         * @param w The pool to search in.
+         * @param begin The begin of the search range.
+         * @param bound The begin of the 'useful' range.
+         * @param end The range end to be checked. It is NOT included in the search.
+         *
+         * @return The new bound.
+         */
+        size_t extractWorstAtBelief(const Belief & b, AlphaVectorPool & w, size_t begin, size_t bound, size_t end);
+
+        /**
+         * @brief This function moves the best columns of an AlphaMatrix at each of a list of beliefs at the beginning of their range.
+         *
+         * This replays the swaps that extractWorstAtBelief() would do for
+         * each belief in order, given the best column at each belief. The
+         * columns are only read before the first swap.
+         *
+         * @param alphas The values of the range.
+         * @param best The result of findBestAtBeliefs() on the range.
+         * @param bound The index of the begin of the 'useful' range.
+         * @param swap A function swapping the elements at two indeces of the range.
+         *
+         * @return The new bound.
+         */
+        template <typename Swap>
+        size_t partitionWorstAtBeliefs(const Eigen::Ref<const AlphaMatrix> & alphas, const std::vector<size_t> & best, size_t bound, Swap swap) {
+            const size_t S = alphas.rows(), N = alphas.cols();
+
+            // Equal ValueFunctions are grouped, since extractWorstAtBelief()
+            // picks the last of them in the range as it is when it is called.
+            std::vector<size_t> sorted(N), group(N), groupBegin;
+            std::iota(std::begin(sorted), std::end(sorted), 0);
+            auto lexLess = [&alphas, S](size_t lhs, size_t rhs) {
+                return std::lexicographical_compare(alphas.col(lhs).data(), alphas.col(lhs).data() + S,
+                                                    alphas.col(rhs).data(), alphas.col(rhs).data() + S);
+            };
+            std::sort(std::begin(sorted), std::end(sorted), lexLess);
+            for ( size_t k = 0; k < N; ++k ) {
+                if ( !k || lexLess(sorted[k-1], sorted[k]) ) groupBegin.push_back(k);
+                group[sorted[k]] = groupBegin.size() - 1;
+            }
+            groupBegin.push_back(N);
+
+            // We track where each ValueFunction is, to swap them as
+            // extractWorstAtBelief() would.
+            std::vector<size_t> position(N), id(N);
+            std::iota(std::begin(position), std::end(position), 0);
+            std::iota(std::begin(id), std::end(id), 0);
+
+            size_t b = bound;
+            for ( auto i : best ) {
+                size_t p = 0;
+                for ( size_t k = groupBegin[group[i]]; k < groupBegin[group[i] + 1]; ++k )
+                    p = std::max(p, position[sorted[k]]);
+                if ( p >= b ) {
+                    swap(p, b);
+                    std::swap(id[p], id[b]);
+                    position[id[p]] = p;
+                    position[id[b]] = b;
+                    ++b;
+                }
+            }
+            return b;
+        }
+
+        /**
+         * @brief This function finds and moves the ValueFunctions with the highest value for each of the given beliefs at the beginning of the specified range.
+         *
+         * This is the same as calling extractWorstAtBelief() for each
+         * belief in order, but the range is only packed and evaluated once
+         * with findBestAtBeliefs().
+         *
+         * @tparam Iterator An iterator, can be const or not, from VList.
+         * @param S The number of states in the Model.
+         * @param beliefs The beliefs to evaluate, in order.
+         * @param begin The begin of the search range.
+         * @param bound The begin of the 'useful' range.
+         * @param end The range end to be checked. It is NOT included in the search.
+         *
+         * @return The new bound iterator.
+         */
+        template <typename Iterator>
+        Iterator extractWorstAtBeliefs(size_t S, const std::vector<Belief> & beliefs, Iterator begin, Iterator bound, Iterator end) {
+            if ( begin == end || beliefs.empty() ) return bound;
+
+            const auto alphas = makeAlphaMatrix(S, begin, end);
+            auto best = findBestAtBeliefs(beliefs, alphas);
+
+            return begin + partitionWorstAtBeliefs(alphas, best, std::distance(begin, bound),
+                                                   [begin](size_t i, size_t j) { std::iter_swap(begin + i, begin + j); });
+        }
+
+        /**
+         * @brief This function finds and moves the entries of an AlphaVectorPool with the highest value for each of the given beliefs at the beginning of the specified range.
+         *
+         * This is extractWorstAtBeliefs() on a range of the pool, which
+         * is evaluated in place.
+         *
+         * @param beliefs The beliefs to evaluate, in order.
+         * @param w The pool to search in.
+         * @param begin The begin of the search range.
+         * @param bound The begin of the 'useful' range.
+         * @param end The range end to be checked. It is NOT included in the search.
+         *
+         * @return The new bound.
+         */
+        size_t extractWorstAtBeliefs(const std::vector<Belief> & beliefs, AlphaVectorPool & w, size_t begin, size_t bound, size_t end);
+
         /**
          * @brief This function finds and moves all best ValueFunctions in the simplex corners at the beginning of the specified range.
          *
@@ -472,6 +673,80 @@ namespace AIToolbox {
             return bound;
         }
 
+        /**
+         * @brief This function finds and moves all best entries of an AlphaVectorPool in the simplex corners at the beginning of the specified range.
+         *
+         * This is extractWorstAtSimplexCorners() on a range of the pool.
+         *
+         * @param w The pool to search in.
+         * @param begin The begin of the search range.
+         * @param bound The begin of the 'useful' range.
+         * @param end The end of the search range. It is NOT included in the search.
+         *
+         * @return The new bound.
+         */
+        size_t extractWorstAtSimplexCorners(AlphaVectorPool & w, size_t begin, size_t bound, size_t end);
+
+        /**
+         * @brief This function finds which alpha vectors are dominated by others.
+         *
+         * A vector is dominated if another one is at least as large in every
+         * state, and larger in at least one. Equal vectors are grouped, and the
+         * groups that are not dominated are numbered.
+         *
+         * The vectors are sorted by decreasing sum, then in decreasing
+         * lexicographic order, so that a vector can only be dominated by
+         * vectors before it. Each vector is then only compared with the
+         * non-dominated vectors found so far, first through a bitset of the
+         * states where it is above the average vector, and then state by
+         * state.
+         *
+         * If a pool is given, the comparisons with the vectors found in
+         * previous batches are run in parallel; the result is the same.
+         *
+         * @param S The number of states in the Model.
+         * @param values The vectors to compare, S values each.
+         * @param pool The pool to use, if any.
+         *
+         * @return For each vector, the index of its group, or values.size() if dominated.
+         */
+        std::vector<size_t> classifyDominated(size_t S, const std::vector<const double *> & values, Impl::ThreadPool * pool = nullptr);
+
+        /**
+         * @brief This function moves the vectors classified as dominated by classifyDominated() at the end of their range.
+         *
+         * A vector is removed if another one still in the range is at
+         * least as good: if it is dominated, or if it has a duplicate left.
+         * The swaps are the ones extractDominatedPairwise() would do, so
+         * that the range ends up in the same order.
+         *
+         * @param groups The result of classifyDominated() on the range.
+         * @param swap A function swapping the elements at two indeces of the range.
+         *
+         * @return The number of elements kept at the beginning of the range.
+         */
+        template <typename Swap>
+        size_t partitionDominated(const std::vector<size_t> & groups, Swap swap) {
+            const size_t N = groups.size();
+            std::vector<size_t> copies(N, 0), ids(N);
+            for ( auto g : groups )
+                if ( g < N ) ++copies[g];
+            std::iota(std::begin(ids), std::end(ids), 0);
+
+            size_t i = 0, end = N;
+            while ( i < end ) {
+                size_t g = groups[ids[i]];
+                if ( g == N || copies[g] > 1 ) {
+                    if ( g < N ) --copies[g];
+                    swap(i, --end);
+                    std::swap(ids[i], ids[end]);
+                } else {
+                    ++i;
+                }
+            }
+            return end;
+        }
+
         /**
          * @brief This function finds and movess all ValueFunctions in the VList that are dominated by others.
          *
@@ -480,7 +755,54 @@ namespace AIToolbox {
          * multiple linear programming problems. However, this function will not return the truly
          * parsimonious set of ValueFunctions, as its pruning powers are limited.
          *
-         * Dominated elements will be moved at the end of the range for safe removal.
+         * Dominated elements will be moved at the end of the range for safe removal. Of
+         * several equal ValueFunctions only one is kept.
+         *
+         * The comparisons are done by classifyDominated(), and the result,
+         * including the order of the range, is the same as with
+         * extractDominatedPairwise().
+         *
+         * @param S The number of states in the Model.
+         * @param begin The begin of the list that needs to be pruned.
+         * @param end The end of the list that needs to be pruned.
+         * @param pool The pool to compare the ValueFunctions with, if any.
+         *
+         * @return The iterator that separates dominated elements with non-pruned.
+         */
+        template <typename Iterator>
+        Iterator extractDominated(size_t S, Iterator begin, Iterator end, Impl::ThreadPool * pool = nullptr) {
+            const size_t N = std::distance(begin, end);
+            if ( N < 2 ) return end;
+
+            std::vector<const double *> values;
+            values.reserve(N);
+            for ( auto it = begin; it != end; ++it )
+                values.push_back(std::get<VALUES>(*it).data());
+
+            auto groups = classifyDominated(S, values, pool);
+
+            return begin + partitionDominated(groups, [begin](size_t i, size_t j) { std::iter_swap(begin + i, begin + j); });
+        }
+
+        /**
+         * @brief This function finds and moves all entries of an AlphaVectorPool that are dominated by others.
+         *
+         * This is extractDominated() on a range of the pool.
+         *
+         * @param w The pool to prune.
+         * @param begin The begin of the range that needs to be pruned.
+         * @param end The end of the range that needs to be pruned.
+         * @param pool The pool to compare the ValueFunctions with, if any.
+         *
+         * @return The index that separates dominated entries with non-pruned.
+         */
+        size_t extractDominated(AlphaVectorPool & w, size_t begin, size_t end, Impl::ThreadPool * pool = nullptr);
+
+        /**
+         * @brief This function finds and moves all ValueFunctions in the VList that are dominated by others, comparing all pairs.
+         *
+         * This is the reference implementation of extractDominated(), in
+         * O(n^2 * S). It is kept to test and benchmark the faster one.
          *
          * @param S The number of states in the Model.
          * @param begin The begin of the list that needs to be pruned.
@@ -489,7 +811,7 @@ namespace AIToolbox {
          * @return The iterator that separates dominated elements with non-pruned.
          */
         template <typename Iterator>
-        Iterator extractDominated(size_t S, Iterator begin, Iterator end) {
+        Iterator extractDominatedPairwise(size_t S, Iterator begin, Iterator end) {
             if ( std::distance(begin, end) < 2 ) return end;
 
             // We use this comparison operator to filter all dominated vectors.
@@ -5,13 +5,32 @@
 
 namespace AIToolbox {
     namespace Impl {
-        Seeder::Seeder() : generator_(std::chrono::system_clock::now().time_since_epoch().count()) {}
+        Seeder::Seeder() : rootSeed_(std::chrono::system_clock::now().time_since_epoch().count()), generator_(rootSeed_) {}
 
-        unsigned Seeder::getSeed() {
+        Seeder & Seeder::instance() {
             static Seeder instance;
-            static std::uniform_int_distribution<unsigned> dist(0, std::numeric_limits<unsigned>::max());
+            return instance;
+        }
+
+        unsigned Seeder::getSeed() {
+            std::uniform_int_distribution<unsigned> dist(0, std::numeric_limits<unsigned>::max());
+
+            auto & self = instance();
+            std::lock_guard<std::mutex> lock(self.mutex_);
+            return dist(self.generator_);
+        }
+
+        void Seeder::setRootSeed(unsigned seed) {
+            auto & self = instance();
+            std::lock_guard<std::mutex> lock(self.mutex_);
+            self.rootSeed_ = seed;
+            self.generator_.seed(seed);
+        }
 
-            return dist(instance.generator_);
+        unsigned Seeder::getRootSeed() {
+            auto & self = instance();
+            std::lock_guard<std::mutex> lock(self.mutex_);
+            return self.rootSeed_;
         }
     }
 }
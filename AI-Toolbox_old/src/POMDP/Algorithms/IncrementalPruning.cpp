@@ -1,8 +1,10 @@
 #include <AIToolbox/POMDP/Algorithms/IncrementalPruning.hpp>
 
+#include <algorithm>
+
 namespace AIToolbox {
     namespace POMDP {
-        IncrementalPruning::IncrementalPruning(unsigned h, double e) : horizon_(h) {
+        IncrementalPruning::IncrementalPruning(unsigned h, double e) : horizon_(h), threads_(1) {
             setEpsilon(e);
         }
 
@@ -14,6 +16,10 @@ namespace AIToolbox {
             epsilon_ = e;
         }
 
+        void IncrementalPruning::setThreads(size_t threads) {
+            threads_ = std::max<size_t>(1, threads);
+        }
+
         unsigned IncrementalPruning::getHorizon() const {
             return horizon_;
         }
@@ -22,39 +28,39 @@ namespace AIToolbox {
             return epsilon_;
         }
 
-        VList IncrementalPruning::crossSum(const VList & l1, const VList & l2, size_t a, bool order) {
-            VList c;
-
-            if ( ! ( l1.size() && l2.size() ) ) return c;
+        size_t IncrementalPruning::getThreads() const {
+            return threads_;
+        }
 
+        AlphaVectorPool IncrementalPruning::crossSum(const AlphaVectorPool & l1, const AlphaVectorPool & l2, size_t a, bool order) {
             // We can get the sizes of the observation vectors
-            // outside since all VEntries for our input VLists
-            // are guaranteed to be sized equally.
-            const auto O1size  = std::get<OBS>(l1[0]).size();
-            const auto O2size  = std::get<OBS>(l2[0]).size();
-            for ( const auto & v1 : l1 ) {
-                auto O1begin = std::begin(std::get<OBS>(v1));
-                auto O1end   = std::end  (std::get<OBS>(v1));
-                for ( const auto & v2 : l2 ) {
-                    auto O2begin = std::begin(std::get<OBS>(v2));
-                    auto O2end   = std::end  (std::get<OBS>(v2));
+            // outside since all entries of a pool are sized equally.
+            const auto O1size  = l1.getO();
+            const auto O2size  = l2.getO();
+
+            AlphaVectorPool c(S, O1size + O2size);
+            if ( l1.empty() || l2.empty() ) return c;
+
+            c.reserve(l1.size() * l2.size());
+            for ( size_t i = 0; i < l1.size(); ++i ) {
+                for ( size_t j = 0; j < l2.size(); ++j ) {
                     // Cross sum
-                    auto v = std::get<VALUES>(v1) + std::get<VALUES>(v2);
+                    size_t k = c.push_back(a);
+                    c.values(k) = l1.values(i) + l2.values(j);
 
                     // This step now depends on which order the two lists
                     // are. This function is only used in this class, so we
                     // know that the two lists are "adjacent"; however one
                     // is after the other. `order` tells us which one comes
                     // first, and we join the observation vectors accordingly.
-                    VObs obs; obs.reserve(O1size + O2size);
+                    auto obs = c.obs(k);
                     if ( order ) {
-                        obs.insert(std::end(obs),O1begin, O1end);
-                        obs.insert(std::end(obs),O2begin, O2end);
+                        obs = std::copy(l1.obs(i), l1.obs(i) + O1size, obs);
+                        std::copy(l2.obs(j), l2.obs(j) + O2size, obs);
                     } else {
-                        obs.insert(std::end(obs),O2begin, O2end);
-                        obs.insert(std::end(obs),O1begin, O1end);
+                        obs = std::copy(l2.obs(j), l2.obs(j) + O2size, obs);
+                        std::copy(l1.obs(i), l1.obs(i) + O1size, obs);
                     }
-                    c.emplace_back(std::move(v), a, std::move(obs));
                 }
             }
 
@@ -0,0 +1,104 @@
+#include <AIToolbox/POMDP/AlphaVectorPool.hpp>
+
+#include <algorithm>
+
+namespace AIToolbox {
+    namespace POMDP {
+        namespace {
+            // The number of doubles each row is padded to, so that all rows
+            // keep the alignment of the start of the matrix.
+#if EIGEN_VERSION_AT_LEAST(3,3,0)
+            const size_t alignment = EIGEN_MAX_ALIGN_BYTES > sizeof(double) ? EIGEN_MAX_ALIGN_BYTES / sizeof(double) : 1;
+#else
+            const size_t alignment = 16 / sizeof(double);
+#endif
+        }
+
+        AlphaVectorPool::AlphaVectorPool(size_t s, size_t o) :
+                S(s), O(o), stride_((s + alignment - 1) / alignment * alignment), size_(0) {}
+
+        AlphaVectorPool::AlphaVectorPool(size_t s, const VList & w) :
+                AlphaVectorPool(s, w.size() ? std::get<OBS>(w[0]).size() : 0)
+        {
+            reserve(w.size());
+            for ( const auto & entry : w ) {
+                size_t i = push_back(std::get<ACTION>(entry));
+                values(i) = std::get<VALUES>(entry);
+                std::copy(std::begin(std::get<OBS>(entry)), std::end(std::get<OBS>(entry)), obs(i));
+            }
+        }
+
+        VList AlphaVectorPool::toVList() const {
+            VList w;
+            w.reserve(size_);
+            for ( size_t i = 0; i < size_; ++i )
+                w.emplace_back(values(i), actions_[i], VObs(obs(i), obs(i) + O));
+            return w;
+        }
+
+        void AlphaVectorPool::reserve(size_t n) {
+            if ( n <= static_cast<size_t>(values_.rows()) ) return;
+            values_.conservativeResize(n, stride_);
+            actions_.resize(n);
+            obs_.resize(n * O);
+        }
+
+        void AlphaVectorPool::grow(size_t n) {
+            if ( n > static_cast<size_t>(values_.rows()) )
+                reserve(std::max(n, 2 * static_cast<size_t>(values_.rows())));
+        }
+
+        size_t AlphaVectorPool::push_back(size_t a) {
+            grow(size_ + 1);
+            values_.row(size_).fill(0.0);
+            actions_[size_] = a;
+            std::fill(obs(size_), obs(size_) + O, 0);
+            return size_++;
+        }
+
+        size_t AlphaVectorPool::push_back(const AlphaVectorPool & other, size_t i) {
+            grow(size_ + 1);
+            values_.row(size_) = other.values_.row(i);
+            actions_[size_] = other.actions_[i];
+            std::copy(other.obs(i), other.obs(i) + O, obs(size_));
+            return size_++;
+        }
+
+        void AlphaVectorPool::append(const AlphaVectorPool & other) {
+            grow(size_ + other.size_);
+            values_.middleRows(size_, other.size_) = other.values_.topRows(other.size_);
+            std::copy(other.actions_.data(), other.actions_.data() + other.size_, actions_.data() + size_);
+            std::copy(other.obs(0), other.obs(other.size_), obs(size_));
+            size_ += other.size_;
+        }
+
+        void AlphaVectorPool::pop_back() {
+            --size_;
+        }
+
+        void AlphaVectorPool::erase(size_t begin, size_t end) {
+            if ( begin >= end ) return;
+            const size_t tail = size_ - end;
+            if ( tail ) {
+                // Rows are moved down, so copying in order does not overwrite
+                // anything that still needs to be read.
+                for ( size_t i = 0; i < tail; ++i )
+                    values_.row(begin + i) = values_.row(end + i);
+                std::copy(actions_.data() + end, actions_.data() + size_, actions_.data() + begin);
+                std::copy(obs(end), obs(size_), obs(begin));
+            }
+            size_ -= end - begin;
+        }
+
+        void AlphaVectorPool::clear() {
+            size_ = 0;
+        }
+
+        void AlphaVectorPool::swap(size_t i, size_t j) {
+            if ( i == j ) return;
+            values_.row(i).swap(values_.row(j));
+            std::swap(actions_[i], actions_[j]);
+            std::swap_ranges(obs(i), obs(i) + O, obs(j));
+        }
+    }
+}
@@ -1,7 +1,64 @@
 #include <AIToolbox/POMDP/Utils.hpp>
 
+#include <algorithm>
+#include <cstdint>
+
+#include <AIToolbox/Impl/ThreadPool.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace AIToolbox {
     namespace POMDP {
+        namespace {
+            // Returns whether lhs[s] >= rhs[s] for all s.
+            bool dominates(const double * lhs, const double * rhs, size_t S) {
+                size_t s = 0;
+#if defined(__SSE2__)
+                for ( ; s + 4 <= S; s += 4 ) {
+                    __m128d low  = _mm_cmplt_pd(_mm_loadu_pd(lhs + s),     _mm_loadu_pd(rhs + s));
+                    __m128d high = _mm_cmplt_pd(_mm_loadu_pd(lhs + s + 2), _mm_loadu_pd(rhs + s + 2));
+                    if ( _mm_movemask_pd(_mm_or_pd(low, high)) ) return false;
+                }
+#endif
+                for ( ; s < S; ++s )
+                    if ( lhs[s] < rhs[s] ) return false;
+                return true;
+            }
+
+            // Returns the bound on the difference between two computations of
+            // the value of b with any column of alphas, whatever the order of
+            // their sums.
+            double roundingBound(const Belief & b, double maxAbs) {
+                return 2.0 * (b.size() + 1) * std::numeric_limits<double>::epsilon() * b.cwiseAbs().sum() * maxAbs;
+            }
+
+            // Applies the rule of findBestAtBelief() to the columns whose
+            // approximate value in scores is close enough to the best one to
+            // be it, evaluating them again as it does.
+            size_t refineBest(const Belief & b, const Eigen::Ref<const AlphaMatrix> & alphas, const double * scores, double tolerance, MDP::Values & buffer, double * value) {
+                const size_t S = alphas.rows(), N = alphas.cols();
+                const double cutoff = *std::max_element(scores, scores + N) - tolerance;
+
+                size_t best = N;
+                double bestValue = 0.0;
+                for ( size_t i = 0; i < N; ++i ) {
+                    if ( scores[i] < cutoff ) continue;
+                    // Copied so that the dot product runs on an aligned
+                    // vector, and sums in the same order as in findBestAtBelief().
+                    buffer = alphas.col(i);
+                    double currValue = b.dot(buffer);
+                    if ( best == N || currValue > bestValue || ( currValue == bestValue &&
+                         !std::lexicographical_compare(buffer.data(), buffer.data() + S, alphas.col(best).data(), alphas.col(best).data() + S) ) ) {
+                        best = i;
+                        bestValue = currValue;
+                    }
+                }
+                if ( value ) *value = bestValue;
+                return best;
+            }
+        }
 
         VEntry makeVEntry(size_t S, size_t a, size_t O) {
             auto values = MDP::Values(S);
@@ -54,5 +111,208 @@ namespace AIToolbox {
             }
             return distance;
         }
+
+        size_t findBestAtBelief(const Belief & b, const Eigen::Ref<const AlphaMatrix> & alphas, double * value) {
+            const Vector scores = alphas.transpose() * b;
+            MDP::Values buffer;
+            return refineBest(b, alphas, scores.data(), roundingBound(b, alphas.cwiseAbs().maxCoeff()), buffer, value);
+        }
+
+        std::vector<size_t> findBestAtBeliefs(const std::vector<Belief> & beliefs, const Eigen::Ref<const AlphaMatrix> & alphas, std::vector<double> * values) {
+            const size_t S = alphas.rows(), N = alphas.cols(), B = beliefs.size();
+            std::vector<size_t> best(B);
+            if ( values ) values->resize(B);
+            if ( !B ) return best;
+
+            const double maxAbs = alphas.cwiseAbs().maxCoeff();
+            // Blocks of beliefs are sized to keep their scores around 8MB.
+            const size_t blockSize = std::max<size_t>(1, std::min<size_t>(B, (1 << 20) / N));
+            Matrix2D block(blockSize, S), scores(blockSize, N);
+            MDP::Values buffer;
+
+            for ( size_t begin = 0; begin < B; begin += blockSize ) {
+                const size_t n = std::min(blockSize, B - begin);
+                for ( size_t i = 0; i < n; ++i )
+                    block.row(i) = beliefs[begin + i].transpose();
+
+                scores.topRows(n).noalias() = block.topRows(n) * alphas;
+
+                for ( size_t i = 0; i < n; ++i ) {
+                    const Belief & b = beliefs[begin + i];
+                    best[begin + i] = refineBest(b, alphas, scores.data() + i * N, roundingBound(b, maxAbs), buffer,
+                                                 values ? &(*values)[begin + i] : nullptr);
+                }
+            }
+            return best;
+        }
+
+        size_t findBestAtBelief(const Belief & b, const AlphaVectorPool & w, size_t begin, size_t end, double * value) {
+            const size_t S = w.getS();
+            size_t bestMatch = begin;
+            double bestValue = b.dot(w.values(bestMatch));
+
+            while ( (++begin) < end ) {
+                auto v = w.values(begin);
+                double currValue = b.dot(v);
+                if ( currValue > bestValue || ( currValue == bestValue &&
+                     !std::lexicographical_compare(v.data(), v.data() + S, w.values(bestMatch).data(), w.values(bestMatch).data() + S) ) ) {
+                    bestMatch = begin;
+                    bestValue = currValue;
+                }
+            }
+            if ( value ) *value = bestValue;
+            return bestMatch;
+        }
+
+        size_t findBestAtSimplexCorner(size_t corner, const AlphaVectorPool & w, size_t begin, size_t end, double * value) {
+            const size_t S = w.getS();
+            size_t bestMatch = begin;
+            double bestValue = w.values(bestMatch)[corner];
+
+            while ( (++begin) < end ) {
+                auto v = w.values(begin);
+                double currValue = v[corner];
+                if ( currValue > bestValue || ( currValue == bestValue &&
+                     !std::lexicographical_compare(v.data(), v.data() + S, w.values(bestMatch).data(), w.values(bestMatch).data() + S) ) ) {
+                    bestMatch = begin;
+                    bestValue = currValue;
+                }
+            }
+            if ( value ) *value = bestValue;
+            return bestMatch;
+        }
+
+        size_t extractWorstAtBelief(const Belief & b, AlphaVectorPool & w, size_t begin, size_t bound, size_t end) {
+            auto bestMatch = findBestAtBelief(b, w, begin, end);
+
+            if ( bestMatch >= bound )
+                w.swap(bestMatch, bound++);
+
+            return bound;
+        }
+
+        size_t extractWorstAtBeliefs(const std::vector<Belief> & beliefs, AlphaVectorPool & w, size_t begin, size_t bound, size_t end) {
+            if ( begin == end || beliefs.empty() ) return bound;
+
+            // The matrix maps the pool itself, which partitionWorstAtBeliefs()
+            // only reads before swapping anything.
+            const auto alphas = w.alphas(begin, end);
+            auto best = findBestAtBeliefs(beliefs, alphas);
+
+            return begin + partitionWorstAtBeliefs(alphas, best, bound - begin,
+                                                   [&w, begin](size_t i, size_t j) { w.swap(begin + i, begin + j); });
+        }
+
+        size_t extractWorstAtSimplexCorners(AlphaVectorPool & w, size_t begin, size_t bound, size_t end) {
+            if ( end == bound ) return bound;
+
+            // For each corner
+            for ( size_t s = 0; s < w.getS(); ++s ) {
+                auto bestMatch = findBestAtSimplexCorner(s, w, begin, end);
+
+                if ( bestMatch >= bound )
+                    w.swap(bestMatch, bound++);
+            }
+            return bound;
+        }
+
+        size_t extractDominated(AlphaVectorPool & w, size_t begin, size_t end, Impl::ThreadPool * pool) {
+            if ( end - begin < 2 ) return end;
+
+            std::vector<const double *> values;
+            values.reserve(end - begin);
+            for ( size_t i = begin; i < end; ++i )
+                values.push_back(w.values(i).data());
+
+            auto groups = classifyDominated(w.getS(), values, pool);
+
+            return begin + partitionDominated(groups, [&w, begin](size_t i, size_t j) { w.swap(begin + i, begin + j); });
+        }
+
+        std::vector<size_t> classifyDominated(size_t S, const std::vector<const double *> & values, Impl::ThreadPool * pool) {
+            const size_t N = values.size(), W = (S + 63) / 64;
+            std::vector<size_t> groups(N, N);
+            if ( !N ) return groups;
+
+            std::vector<double> sums(N, 0.0), means(S, 0.0);
+            for ( size_t i = 0; i < N; ++i ) {
+                for ( size_t s = 0; s < S; ++s ) {
+                    sums[i] += values[i][s];
+                    means[s] += values[i][s];
+                }
+            }
+            for ( auto & m : means ) m /= N;
+
+            // A vector can only be dominated by vectors which are above the
+            // average in at least the same states.
+            std::vector<std::uint64_t> above(N * W, 0);
+            for ( size_t i = 0; i < N; ++i )
+                for ( size_t s = 0; s < S; ++s )
+                    if ( values[i][s] > means[s] ) above[i * W + s / 64] |= std::uint64_t(1) << (s % 64);
+
+            // Sums are monotone, so a vector can only be dominated by one
+            // with a larger or equal sum, and in case of ties by one which is
+            // lexicographically larger.
+            std::vector<size_t> order(N);
+            std::iota(std::begin(order), std::end(order), 0);
+            std::stable_sort(std::begin(order), std::end(order), [&](size_t lhs, size_t rhs) {
+                if ( sums[lhs] != sums[rhs] ) return sums[lhs] > sums[rhs];
+                return std::lexicographical_compare(values[rhs], values[rhs] + S, values[lhs], values[lhs] + S);
+            });
+
+            // The non-dominated vectors found so far, one per group. Since
+            // dominance is transitive, a vector dominated by an earlier one
+            // is dominated by one of these.
+            std::vector<size_t> front;
+            auto findDominating = [&](size_t i, size_t from, size_t to) {
+                const std::uint64_t * bits = above.data() + i * W;
+                for ( size_t k = from; k < to; ++k ) {
+                    const std::uint64_t * frontBits = above.data() + front[k] * W;
+                    size_t w = 0;
+                    while ( w < W && !(bits[w] & ~frontBits[w]) ) ++w;
+                    if ( w == W && dominates(values[front[k]], values[i], S) ) return k;
+                }
+                return N;
+            };
+
+            // Vectors are processed in batches: each is compared in parallel
+            // with the front found before the batch, and then in order with
+            // the vectors added to it during the batch.
+            const size_t threads = pool ? pool->size() : 1;
+            const size_t batchSize = threads > 1 ? threads * 64 : N;
+            std::vector<size_t> found(N);
+            std::vector<Impl::ThreadPool::Task> tasks;
+            for ( size_t begin = 0; begin < N; begin += batchSize ) {
+                const size_t end = std::min(N, begin + batchSize), known = front.size();
+                auto compare = [&, known](size_t b, size_t e) {
+                    for ( size_t k = b; k < e; ++k )
+                        found[k] = findDominating(order[k], 0, known);
+                };
+                if ( threads > 1 && known ) {
+                    tasks.clear();
+                    const size_t chunk = (end - begin + threads - 1) / threads;
+                    for ( size_t b = begin; b < end; b += chunk )
+                        tasks.emplace_back([&compare, b, end, chunk]() { compare(b, std::min(end, b + chunk)); });
+                    pool->run(tasks);
+                } else {
+                    compare(begin, end);
+                }
+
+                for ( size_t k = begin; k < end; ++k ) {
+                    const size_t i = order[k];
+                    size_t f = found[k];
+                    if ( f == N ) f = findDominating(i, known, front.size());
+
+                    if ( f == N ) {
+                        groups[i] = front.size();
+                        front.push_back(i);
+                    } else if ( dominates(values[i], values[front[f]], S) ) {
+                        // Equal to a non-dominated vector.
+                        groups[i] = f;
+                    }
+                }
+            }
+            return groups;
+        }
     }
 }
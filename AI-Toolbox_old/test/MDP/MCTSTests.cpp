@@ -102,3 +102,30 @@ BOOST_AUTO_TEST_CASE( sampleOneTime ) {
     // We make a,o the new head
     solver.sampleAction( 0, s1, horizon - 1);
 }
+
+BOOST_AUTO_TEST_CASE( reproducibleWithRootSeed ) {
+    using namespace AIToolbox::MDP;
+
+    GridWorld grid(4,4);
+
+    auto run = [&grid]() {
+        AIToolbox::Impl::Seeder::setRootSeed(42);
+
+        auto model = makeCornerProblem(grid);
+        MCTS<decltype(model)> solver(model, 100, 5.0);
+
+        std::vector<double> values;
+        for ( size_t s = 0; s < model.getS(); ++s ) {
+            solver.sampleAction(s, 5);
+            for ( auto & a : solver.getGraph().children )
+                values.push_back(a.V);
+        }
+        return values;
+    };
+
+    auto first = run();
+    auto second = run();
+
+    BOOST_CHECK_EQUAL( AIToolbox::Impl::Seeder::getRootSeed(), 42u );
+    BOOST_CHECK_EQUAL_COLLECTIONS( first.begin(), first.end(), second.begin(), second.end() );
+}
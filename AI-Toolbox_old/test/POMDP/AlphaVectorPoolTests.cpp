@@ -0,0 +1,100 @@
+#define BOOST_TEST_MODULE POMDP_AlphaVectorPool
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <AIToolbox/POMDP/AlphaVectorPool.hpp>
+
+#include <cstdint>
+
+BOOST_AUTO_TEST_CASE( construction ) {
+    using namespace AIToolbox;
+
+    POMDP::AlphaVectorPool w(5, 3);
+
+    BOOST_CHECK_EQUAL(w.getS(), 5);
+    BOOST_CHECK_EQUAL(w.getO(), 3);
+    BOOST_CHECK_EQUAL(w.size(), 0);
+    BOOST_CHECK(w.empty());
+
+    // New entries are zeroed, and keep their data when the pool grows.
+    for ( size_t i = 0; i < 100; ++i ) {
+        size_t id = w.push_back(i % 4);
+        BOOST_CHECK_EQUAL(id, i);
+        BOOST_CHECK_EQUAL(w.values(id).sum(), 0.0);
+        BOOST_CHECK_EQUAL(w.obs(id)[0] + w.obs(id)[1] + w.obs(id)[2], 0);
+
+        w.values(id).setConstant(i);
+        w.obs(id)[1] = i;
+    }
+
+    BOOST_CHECK_EQUAL(w.size(), 100);
+    for ( size_t i = 0; i < w.size(); ++i ) {
+        BOOST_CHECK_EQUAL(w.values(i)[4], i);
+        BOOST_CHECK_EQUAL(w.action(i), i % 4);
+        BOOST_CHECK_EQUAL(w.obs(i)[1], i);
+        // Every entry starts at an aligned address.
+        BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(w.values(i).data()) % 16, 0);
+    }
+
+    auto alphas = w.alphas(10, 20);
+    BOOST_CHECK_EQUAL(alphas.rows(), 5);
+    BOOST_CHECK_EQUAL(alphas.cols(), 10);
+    BOOST_CHECK_EQUAL(alphas(2, 3), 13.0);
+}
+
+BOOST_AUTO_TEST_CASE( vlistConversion ) {
+    using namespace AIToolbox;
+
+    POMDP::VList v;
+    for ( size_t i = 0; i < 7; ++i ) {
+        MDP::Values values(3);
+        values << i, 2.0 * i, -1.0 * i;
+        v.emplace_back(values, i, POMDP::VObs{i, i + 1});
+    }
+
+    POMDP::AlphaVectorPool w(3, v);
+    BOOST_CHECK_EQUAL(w.size(), v.size());
+    BOOST_CHECK_EQUAL(w.getO(), 2);
+
+    auto copy = w.toVList();
+    BOOST_CHECK(copy == v);
+}
+
+BOOST_AUTO_TEST_CASE( editing ) {
+    using namespace AIToolbox;
+
+    POMDP::AlphaVectorPool w(2, 1), other(2, 1);
+    for ( size_t i = 0; i < 6; ++i ) {
+        w.values(w.push_back(i)).setConstant(i);
+        w.obs(i)[0] = i;
+        other.values(other.push_back(10 + i)).setConstant(10 + i);
+    }
+
+    // Erasing moves the following entries down, in order.
+    w.erase(1, 3);
+    BOOST_CHECK_EQUAL(w.size(), 4);
+    size_t left[] = {0, 3, 4, 5};
+    for ( size_t i = 0; i < 4; ++i ) {
+        BOOST_CHECK_EQUAL(w.values(i)[1], left[i]);
+        BOOST_CHECK_EQUAL(w.action(i), left[i]);
+        BOOST_CHECK_EQUAL(w.obs(i)[0], left[i]);
+    }
+
+    w.swap(0, 3);
+    BOOST_CHECK_EQUAL(w.values(0)[0], 5.0);
+    BOOST_CHECK_EQUAL(w.obs(3)[0], 0);
+
+    w.pop_back();
+    w.push_back(other, 2);
+    BOOST_CHECK_EQUAL(w.size(), 4);
+    BOOST_CHECK_EQUAL(w.values(3)[0], 12.0);
+    BOOST_CHECK_EQUAL(w.action(3), 12);
+
+    w.append(other);
+    BOOST_CHECK_EQUAL(w.size(), 10);
+    BOOST_CHECK_EQUAL(w.values(9)[1], 15.0);
+
+    w.clear();
+    BOOST_CHECK(w.empty());
+}
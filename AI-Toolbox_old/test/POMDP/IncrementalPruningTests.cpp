@@ -302,3 +302,32 @@ BOOST_AUTO_TEST_CASE( undiscountedHorizonSparse ) {
         BOOST_CHECK_EQUAL(values, truthValues);
     }
 }
+
+BOOST_AUTO_TEST_CASE( multithreaded ) {
+    using namespace AIToolbox;
+
+    auto model = makeTigerProblem();
+    model.setDiscount(0.95);
+
+    unsigned horizon = 15;
+    POMDP::IncrementalPruning solver(horizon, 0.0);
+    auto vlist = std::get<1>(solver(model))[horizon];
+
+    solver.setThreads(4);
+    BOOST_CHECK_EQUAL(solver.getThreads(), 4);
+    auto threaded = std::get<1>(solver(model))[horizon];
+
+    auto comparer = [](const POMDP::VEntry & lhs, const POMDP::VEntry & rhs) {
+        return POMDP::operator<(lhs, rhs);
+    };
+
+    // Vectors may come out in a different order, but they must be the same.
+    std::sort(std::begin(vlist), std::end(vlist), comparer);
+    std::sort(std::begin(threaded), std::end(threaded), comparer);
+
+    BOOST_CHECK_EQUAL(vlist.size(), threaded.size());
+    for ( size_t i = 0; i < vlist.size(); ++i ) {
+        BOOST_CHECK_EQUAL(std::get<POMDP::ACTION>(vlist[i]), std::get<POMDP::ACTION>(threaded[i]));
+        BOOST_CHECK_EQUAL(std::get<POMDP::VALUES>(vlist[i]), std::get<POMDP::VALUES>(threaded[i]));
+    }
+}
@@ -0,0 +1,70 @@
+#define BOOST_TEST_MODULE POMDP_Pruner
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <AIToolbox/POMDP/Algorithms/Utils/Pruner.hpp>
+#include <AIToolbox/POMDP/Algorithms/Utils/WitnessLP_lpsolve.hpp>
+#include <AIToolbox/POMDP/Types.hpp>
+
+#include <algorithm>
+
+namespace {
+    // Builds the tangents to (p - 0.5)^2 at p = 0, 0.1, ..., 1.0, which are
+    // all useful, and the tangents at the midpoints lowered by 0.01, which
+    // are not. Most of them are not dominated by any single tangent.
+    AIToolbox::POMDP::AlphaVectorPool makeTangents() {
+        using namespace AIToolbox;
+
+        auto tangent = [](double p, double shift) {
+            // f(x) - (x - p)^2, evaluated at x = 1 and x = 0.
+            MDP::Values v(2);
+            v << (0.5 * 0.5) - (1.0 - p) * (1.0 - p) - shift, (0.5 * 0.5) - p * p - shift;
+            return v;
+        };
+
+        POMDP::AlphaVectorPool w(2, 1);
+        for ( size_t k = 0; k < 21; ++k ) {
+            // Interleaved, so useful and useless vectors are mixed.
+            size_t i = (k * 8) % 21;
+            size_t id = w.push_back(i);
+            if ( i % 2 ) w.values(id) = tangent(i / 20.0, 0.01);
+            else         w.values(id) = tangent(i / 20.0, 0.0);
+        }
+        return w;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( prefilterSavesLPs ) {
+    using namespace AIToolbox;
+
+    auto w1 = makeTangents();
+    auto w2 = makeTangents();
+
+    POMDP::Pruner<POMDP::WitnessLP_lpsolve> fewBeliefs(2, 0);
+    POMDP::Pruner<POMDP::WitnessLP_lpsolve> manyBeliefs(2, 64);
+
+    fewBeliefs(&w1);
+    manyBeliefs(&w2);
+
+    BOOST_CHECK_EQUAL(w1.size(), 11);
+    BOOST_CHECK_EQUAL(w2.size(), 11);
+
+    std::vector<size_t> a1, a2;
+    for ( size_t i = 0; i < w1.size(); ++i ) {
+        a1.push_back(w1.action(i));
+        a2.push_back(w2.action(i));
+    }
+    std::sort(std::begin(a1), std::end(a1));
+    std::sort(std::begin(a2), std::end(a2));
+    for ( size_t i = 0; i < a1.size(); ++i )
+        BOOST_CHECK_EQUAL(a1[i], 2 * i);
+
+    BOOST_CHECK(a1 == a2);
+
+    // Each useful vector which is not found at the lookup beliefs needs
+    // exactly one lp, while the useless ones need one lp each regardless.
+    BOOST_CHECK(manyBeliefs.getLastSavedLPCalls() > fewBeliefs.getLastSavedLPCalls());
+    BOOST_CHECK_EQUAL(fewBeliefs.getLastLPCalls() - manyBeliefs.getLastLPCalls(),
+                      manyBeliefs.getLastSavedLPCalls() - fewBeliefs.getLastSavedLPCalls());
+}
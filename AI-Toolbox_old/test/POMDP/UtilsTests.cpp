@@ -0,0 +1,211 @@
+#define BOOST_TEST_MODULE POMDP_Utils
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+
+#include <AIToolbox/POMDP/Utils.hpp>
+#include <AIToolbox/POMDP/Types.hpp>
+#include <AIToolbox/Impl/ThreadPool.hpp>
+
+#include <random>
+
+namespace {
+    // Random VList where some vectors are copies of earlier ones, and
+    // values are rounded so that many of them dominate each other.
+    AIToolbox::POMDP::VList makeVList(size_t n, size_t S, std::mt19937 & rnd) {
+        using namespace AIToolbox;
+        std::uniform_int_distribution<int> values(0, 3);
+
+        POMDP::VList w;
+        for ( size_t i = 0; i < n; ++i ) {
+            MDP::Values v(S);
+            if ( i && rnd() % 4 == 0 )
+                v = std::get<POMDP::VALUES>(w[rnd() % i]);
+            else
+                for ( size_t s = 0; s < S; ++s )
+                    v[s] = values(rnd);
+            w.emplace_back(v, i % 3, POMDP::VObs(1, i));
+        }
+        return w;
+    }
+
+    bool sameVList(const AIToolbox::POMDP::VList & lhs, const AIToolbox::POMDP::VList & rhs) {
+        using namespace AIToolbox;
+        if ( lhs.size() != rhs.size() ) return false;
+        for ( size_t i = 0; i < lhs.size(); ++i )
+            if ( std::get<POMDP::OBS>(lhs[i]) != std::get<POMDP::OBS>(rhs[i]) ) return false;
+        return true;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( extractDominatedSimple ) {
+    using namespace AIToolbox;
+
+    const size_t S = 3;
+    MDP::Values a(S), b(S), c(S);
+    a << 1.0, 2.0, 3.0;
+    b << 1.0, 1.0, 3.0;
+    c << 3.0, 0.0, 0.0;
+
+    // b is dominated by a, and the second copy of a by the first.
+    POMDP::VList w{ std::make_tuple(b, 0, POMDP::VObs(1, 0)),
+                    std::make_tuple(a, 0, POMDP::VObs(1, 1)),
+                    std::make_tuple(c, 0, POMDP::VObs(1, 2)),
+                    std::make_tuple(a, 0, POMDP::VObs(1, 3)) };
+
+    auto it = POMDP::extractDominated(S, w.begin(), w.end());
+    BOOST_CHECK_EQUAL(std::distance(w.begin(), it), 2);
+
+    // The survivors are a and c, in no particular order.
+    bool foundA = false, foundC = false;
+    for ( auto i = w.begin(); i != it; ++i ) {
+        foundA |= ( std::get<POMDP::VALUES>(*i) == a );
+        foundC |= ( std::get<POMDP::VALUES>(*i) == c );
+    }
+    BOOST_CHECK(foundA);
+    BOOST_CHECK(foundC);
+}
+
+BOOST_AUTO_TEST_CASE( extractDominatedMatchesPairwise ) {
+    using namespace AIToolbox;
+
+    std::mt19937 rnd(0);
+    Impl::ThreadPool pool(3);
+
+    for ( size_t S : { 1, 2, 5, 64, 67 } ) {
+        for ( size_t n : { 0, 1, 2, 10, 300 } ) {
+            auto w = makeVList(n, S, rnd);
+
+            auto reference = w;
+            reference.erase(POMDP::extractDominatedPairwise(S, reference.begin(), reference.end()), reference.end());
+
+            auto sorted = w;
+            sorted.erase(POMDP::extractDominated(S, sorted.begin(), sorted.end()), sorted.end());
+            BOOST_CHECK(sameVList(reference, sorted));
+
+            auto parallel = w;
+            parallel.erase(POMDP::extractDominated(S, parallel.begin(), parallel.end(), &pool), parallel.end());
+            BOOST_CHECK(sameVList(reference, parallel));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( findBestAtBeliefsMatchesFindBestAtBelief ) {
+    using namespace AIToolbox;
+
+    std::mt19937 rnd(1);
+    std::uniform_real_distribution<double> probs(0.0, 1.0);
+
+    for ( size_t S : { 1, 3, 8, 33 } ) {
+        // Many equal values, so that ties are broken as findBestAtBelief does.
+        auto w = makeVList(200, S, rnd);
+        auto alphas = POMDP::makeAlphaMatrix(S, std::begin(w), std::end(w));
+
+        std::vector<POMDP::Belief> beliefs;
+        for ( size_t i = 0; i < 500; ++i ) {
+            POMDP::Belief b(S);
+            if ( i < S ) {
+                b.fill(0.0); b[i] = 1.0;
+            } else {
+                for ( size_t s = 0; s < S; ++s ) b[s] = probs(rnd);
+                b /= b.sum();
+            }
+            beliefs.push_back(b);
+        }
+
+        std::vector<double> values;
+        auto best = POMDP::findBestAtBeliefs(beliefs, alphas, &values);
+        BOOST_CHECK_EQUAL(best.size(), beliefs.size());
+
+        for ( size_t i = 0; i < beliefs.size(); ++i ) {
+            double value, singleValue;
+            auto bestMatch = POMDP::findBestAtBelief(beliefs[i], std::begin(w), std::end(w), &value);
+            BOOST_CHECK_EQUAL(best[i], std::distance(std::begin(w), bestMatch));
+            BOOST_CHECK_EQUAL(values[i], value);
+
+            BOOST_CHECK_EQUAL(POMDP::findBestAtBelief(beliefs[i], alphas, &singleValue), best[i]);
+            BOOST_CHECK_EQUAL(singleValue, value);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( extractWorstAtBeliefsMatchesExtractWorstAtBelief ) {
+    using namespace AIToolbox;
+
+    std::mt19937 rnd(2);
+    std::uniform_real_distribution<double> probs(0.0, 1.0);
+
+    for ( size_t S : { 1, 2, 4 } ) {
+        for ( size_t n : { 1, 5, 40 } ) {
+            auto w = makeVList(n, S, rnd);
+
+            std::vector<POMDP::Belief> beliefs;
+            for ( size_t i = 0; i < 30; ++i ) {
+                POMDP::Belief b(S);
+                for ( size_t s = 0; s < S; ++s ) b[s] = probs(rnd);
+                beliefs.push_back(b / b.sum());
+            }
+
+            auto reference = w;
+            auto bound = std::begin(reference);
+            for ( auto & b : beliefs )
+                bound = POMDP::extractWorstAtBelief(b, std::begin(reference), bound, std::end(reference));
+
+            auto batched = w;
+            auto batchedBound = POMDP::extractWorstAtBeliefs(S, beliefs, std::begin(batched), std::begin(batched), std::end(batched));
+
+            BOOST_CHECK_EQUAL(std::distance(std::begin(reference), bound), std::distance(std::begin(batched), batchedBound));
+            BOOST_CHECK(sameVList(reference, batched));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( alphaVectorPoolMatchesVList ) {
+    using namespace AIToolbox;
+
+    std::mt19937 rnd(3);
+    std::uniform_real_distribution<double> probs(0.0, 1.0);
+
+    for ( size_t S : { 1, 3, 5, 16 } ) {
+        for ( size_t n : { 1, 7, 120 } ) {
+            auto w = makeVList(n, S, rnd);
+
+            std::vector<POMDP::Belief> beliefs;
+            for ( size_t i = 0; i < 20; ++i ) {
+                POMDP::Belief b(S);
+                for ( size_t s = 0; s < S; ++s ) b[s] = probs(rnd);
+                beliefs.push_back(b / b.sum());
+            }
+
+            // Each function is applied to both the VList and the pool, and
+            // they must leave the entries in the same order.
+            auto reference = w;
+            POMDP::AlphaVectorPool pool(S, w);
+
+            reference.erase(POMDP::extractDominated(S, std::begin(reference), std::end(reference)), std::end(reference));
+            pool.erase(POMDP::extractDominated(pool, 0, pool.size()), pool.size());
+            BOOST_CHECK(sameVList(reference, pool.toVList()));
+
+            auto bound = POMDP::extractWorstAtSimplexCorners(S, std::begin(reference), std::begin(reference), std::end(reference));
+            size_t poolBound = POMDP::extractWorstAtSimplexCorners(pool, 0, 0, pool.size());
+            BOOST_CHECK_EQUAL(std::distance(std::begin(reference), bound), poolBound);
+            BOOST_CHECK(sameVList(reference, pool.toVList()));
+
+            bound = POMDP::extractWorstAtBelief(beliefs[0], std::begin(reference), bound, std::end(reference));
+            poolBound = POMDP::extractWorstAtBelief(beliefs[0], pool, 0, poolBound, pool.size());
+            BOOST_CHECK_EQUAL(std::distance(std::begin(reference), bound), poolBound);
+
+            bound = POMDP::extractWorstAtBeliefs(S, beliefs, std::begin(reference), bound, std::end(reference));
+            poolBound = POMDP::extractWorstAtBeliefs(beliefs, pool, 0, poolBound, pool.size());
+            BOOST_CHECK_EQUAL(std::distance(std::begin(reference), bound), poolBound);
+            BOOST_CHECK(sameVList(reference, pool.toVList()));
+
+            for ( const auto & b : beliefs ) {
+                double value, poolValue;
+                auto bestMatch = POMDP::findBestAtBelief(b, std::begin(reference), std::end(reference), &value);
+                BOOST_CHECK_EQUAL(POMDP::findBestAtBelief(b, pool, 0, pool.size(), &poolValue), std::distance(std::begin(reference), bestMatch));
+                BOOST_CHECK_EQUAL(poolValue, value);
+            }
+        }
+    }
+}
@@ -0,0 +1,186 @@
+#ifndef AI_TOOLBOX_POMDP_BELIEF_CACHE_HEADER_FILE
+#define AI_TOOLBOX_POMDP_BELIEF_CACHE_HEADER_FILE
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace AIToolbox {
+  namespace POMDP {
+
+    /**
+     * @brief This class memoizes exact environment-belief updates.
+     *
+     * An entry maps a parent belief over environments, the observation
+     * it was reached with, an action and the next observation to the
+     * updated belief. Beliefs are stored by their support (see
+     * SparseEnvBelief), and parent beliefs are compared bit for bit, so
+     * a hit returns exactly what the update would have computed.
+     *
+     * The cache holds at most a fixed number of entries and evicts the
+     * least recently used one when full. All functions are thread-safe.
+     */
+    class BeliefCache {
+    public:
+      /**
+       * @brief Basic constructor.
+       *
+       * @param E The number of environments.
+       * @param capacity The maximum number of entries, 0 disables the cache.
+       */
+      BeliefCache(size_t E, size_t capacity);
+
+      /**
+       * @brief This function looks up an update.
+       *
+       * @param pobs The observation of the parent node.
+       * @param a The action taken.
+       * @param o The observation reached.
+       * @param envs The environments in the support of the parent belief.
+       * @param probs Their probabilities.
+       * @param n The size of the parent support.
+       * @param outEnvs Where to write the support of the updated belief on a hit, room for n entries.
+       * @param outProbs Where to write its probabilities.
+       *
+       * @return The size of the updated support, 0 if the update was not found.
+       */
+      size_t lookup(size_t pobs, size_t a, size_t o, const std::uint32_t * envs, const double * probs, size_t n,
+		    std::uint32_t * outEnvs, double * outProbs);
+
+      /**
+       * @brief This function stores an update, evicting the least recently used one if needed.
+       *
+       * @param pobs The observation of the parent node.
+       * @param a The action taken.
+       * @param o The observation reached.
+       * @param envs The environments in the support of the parent belief.
+       * @param probs Their probabilities.
+       * @param n The size of the parent support.
+       * @param resultEnvs The support of the updated belief.
+       * @param resultProbs Its probabilities.
+       * @param m The size of the updated support.
+       */
+      void insert(size_t pobs, size_t a, size_t o, const std::uint32_t * envs, const double * probs, size_t n,
+		  const std::uint32_t * resultEnvs, const double * resultProbs, size_t m);
+
+      /**
+       * @brief This function removes all entries and resets the counters.
+       */
+      void clear();
+
+      size_t getHits() const { return hits_; }
+      size_t getMisses() const { return misses_; }
+      size_t getCapacity() const { return capacity_; }
+      size_t size() const;
+
+      /**
+       * @brief This function returns the fraction of lookups that were hits.
+       */
+      double getHitRate() const;
+
+    private:
+      struct Entry {
+	std::uint64_t hash;
+	size_t pobs, a, o;
+	std::vector<std::uint32_t> parentEnvs, resultEnvs;
+	std::vector<double> parentProbs, resultProbs;
+      };
+      using Entries = std::list<Entry>;
+
+      std::uint64_t hash(size_t pobs, size_t a, size_t o, const std::uint32_t * envs, const double * probs, size_t n) const;
+      bool matches(const Entry & e, size_t pobs, size_t a, size_t o, const std::uint32_t * envs, const double * probs, size_t n) const;
+
+      size_t E_, capacity_;
+      Entries lru_; // Most recently used first
+      std::unordered_map<std::uint64_t, Entries::iterator> index_;
+      mutable std::mutex mutex_;
+      std::atomic<size_t> hits_, misses_;
+    };
+
+    inline BeliefCache::BeliefCache(size_t E, size_t capacity) : E_(E), capacity_(capacity), hits_(0), misses_(0) {
+      index_.reserve(capacity_);
+    }
+
+    inline std::uint64_t BeliefCache::hash(size_t pobs, size_t a, size_t o, const std::uint32_t * envs, const double * probs, size_t n) const {
+      // FNV-1a over the key, with the belief taken as raw bits.
+      std::uint64_t h = 14695981039346656037ULL;
+      auto mix = [&h](std::uint64_t v) { h ^= v; h *= 1099511628211ULL; };
+      mix(pobs); mix(a); mix(o); mix(n);
+      for (size_t i = 0; i < n; ++i) {
+	std::uint64_t bits;
+	std::memcpy(&bits, probs + i, sizeof(bits));
+	mix(envs[i]);
+	mix(bits);
+      }
+      return h;
+    }
+
+    inline bool BeliefCache::matches(const Entry & e, size_t pobs, size_t a, size_t o, const std::uint32_t * envs, const double * probs, size_t n) const {
+      return e.pobs == pobs && e.a == a && e.o == o && e.parentEnvs.size() == n
+	&& !std::memcmp(e.parentEnvs.data(), envs, n * sizeof(std::uint32_t))
+	&& !std::memcmp(e.parentProbs.data(), probs, n * sizeof(double));
+    }
+
+    inline size_t BeliefCache::lookup(size_t pobs, size_t a, size_t o, const std::uint32_t * envs, const double * probs, size_t n,
+				      std::uint32_t * outEnvs, double * outProbs) {
+      if (!capacity_) return 0;
+      std::uint64_t h = hash(pobs, a, o, envs, probs, n);
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = index_.find(h);
+      if (it == index_.end() || !matches(*it->second, pobs, a, o, envs, probs, n)) {
+	misses_++;
+	return 0;
+      }
+      lru_.splice(lru_.begin(), lru_, it->second);
+      const Entry & e = *it->second;
+      std::copy(e.resultEnvs.begin(), e.resultEnvs.end(), outEnvs);
+      std::copy(e.resultProbs.begin(), e.resultProbs.end(), outProbs);
+      hits_++;
+      return e.resultEnvs.size();
+    }
+
+    inline void BeliefCache::insert(size_t pobs, size_t a, size_t o, const std::uint32_t * envs, const double * probs, size_t n,
+				    const std::uint32_t * resultEnvs, const double * resultProbs, size_t m) {
+      if (!capacity_ || !m) return;
+      std::uint64_t h = hash(pobs, a, o, envs, probs, n);
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = index_.find(h);
+      if (it != index_.end()) {
+	// Either another thread got there first, or a hash collision:
+	// in both cases the newest key wins the slot.
+	lru_.erase(it->second);
+	index_.erase(it);
+      } else if (lru_.size() >= capacity_) {
+	index_.erase(lru_.back().hash);
+	lru_.pop_back();
+      }
+      lru_.push_front(Entry{h, pobs, a, o, std::vector<std::uint32_t>(envs, envs + n), std::vector<std::uint32_t>(resultEnvs, resultEnvs + m),
+	    std::vector<double>(probs, probs + n), std::vector<double>(resultProbs, resultProbs + m)});
+      index_[h] = lru_.begin();
+    }
+
+    inline void BeliefCache::clear() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      lru_.clear();
+      index_.clear();
+      hits_ = 0;
+      misses_ = 0;
+    }
+
+    inline size_t BeliefCache::size() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return lru_.size();
+    }
+
+    inline double BeliefCache::getHitRate() const {
+      size_t total = hits_ + misses_;
+      return total ? static_cast<double>(hits_) / total : 0.0;
+    }
+  }
+}
+
+#endif
@@ -4,6 +4,14 @@
 #include <AIToolbox/ProbabilityUtils.hpp>
 #include <AIToolbox/POMDP/Types.hpp>
 #include <AIToolbox/Impl/Seeder.hpp>
+#include <AIToolbox/Impl/ThreadPool.hpp>
+#include "BeliefIndex.hpp"
+#include "BeliefKernel.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <random>
 
 namespace AIToolbox {
     namespace POMDP {
@@ -14,14 +22,25 @@ namespace AIToolbox {
         class BeliefGenerator;
 #endif
         /**
-         * @brief This class offers pruning facilities for non-parsimonious ValueFunction sets.
+         * @brief This class generates reachable beliefs from a given Model.
+         *
+         * New beliefs are found by sampling transitions from the beliefs of
+         * the list, and keeping the one farthest away from the list. The
+         * distances are looked up in a BeliefIndex, and the beliefs of the
+         * list are expanded in parallel batches.
          */
         template <typename M>
         class BeliefGenerator<M> {
             public:
                 using BeliefList = std::vector<Belief>;
 
-                BeliefGenerator(const M& model);
+                /**
+                 * @brief Basic constructor.
+                 *
+                 * @param model The Model used to generate beliefs.
+                 * @param threads The number of threads expanding beliefs in parallel, including the calling one.
+                 */
+                BeliefGenerator(const M& model, size_t threads = 1);
 
                 BeliefList operator()(size_t beliefNumber) const;
                 void operator()(size_t beliefNumber, BeliefList * bl) const;
@@ -36,14 +55,37 @@ namespace AIToolbox {
                  */
                 void expandBeliefList(size_t max, BeliefList * bl) const;
 
+                // The new beliefs sampled from a belief of the list, which are
+                // not already in it, E probabilities each.
+                struct Samples {
+                    std::vector<size_t> actions, observations;
+                    std::vector<double> distances;
+                    std::vector<double> envs;
+                };
+
+                /**
+                 * @brief This function samples 20 new beliefs per action from a belief of the list.
+                 *
+                 * @param b The belief to expand.
+                 * @param bObs The observation of b, or O if it spans several.
+                 * @param bEnv The E probabilities of b if on a single observation.
+                 * @param index The beliefs to compute the distances from.
+                 * @param rnd The random engine to sample with.
+                 * @param out Where to add the samples, in order of action and draw.
+                 */
+                void sampleBeliefs(const Belief & b, size_t bObs, const double * bEnv, const BeliefIndex & index,
+                                   std::default_random_engine & rnd, Samples * out) const;
+
                 const M& model_;
                 size_t S, A;
 
                 mutable std::default_random_engine rand_;
+                std::shared_ptr<Impl::ThreadPool> pool_;
         };
 
         template <typename M>
-        BeliefGenerator<M>::BeliefGenerator(const M& model) : model_(model), S(model_.getS()), A(model_.getA()), rand_(Impl::Seeder::getSeed()) {}
+        BeliefGenerator<M>::BeliefGenerator(const M& model, size_t threads) : model_(model), S(model_.getS()), A(model_.getA()), rand_(Impl::Seeder::getSeed()),
+                                                                               pool_(std::make_shared<Impl::ThreadPool>(threads)) {}
 
         template <typename M>
         typename BeliefGenerator<M>::BeliefList BeliefGenerator<M>::operator()(size_t beliefNumber) const {
@@ -107,8 +149,9 @@ namespace AIToolbox {
 		  beliefs.emplace_back(S);
 		  beliefs.back().fill(0.0);
 		  double sum = 0.;
-		  size_t o = rand() % (int)(model_.getO());
-		  static std::uniform_real_distribution<double> sampleDistribution(0.0, 1.0);
+		  std::uniform_int_distribution<size_t> sampleObservation(0, model_.getO() - 1);
+		  size_t o = sampleObservation(rand_);
+		  std::uniform_real_distribution<double> sampleDistribution(0.0, 1.0);
 		  for (size_t e = 0; e < model_.getE(); e++) {
 		    beliefs.back()(e * model_.getO() + o) = sampleDistribution(rand_);
 		    sum += beliefs.back()(e * model_.getO() + o);
@@ -127,52 +170,150 @@ namespace AIToolbox {
             assert(blp);
             auto & bl = *blp;
             size_t size = bl.size();
+            size_t E = model_.getE(), O = model_.getO();
 
-            std::vector<Belief> newBeliefs(A);
-            std::vector<double> distances(A);
-            auto dBegin = std::begin(distances), dEnd = std::end(distances);
-
-            // L1 distance
-            auto computeDistance = [this](const Belief & lhs, const Belief & rhs) {
-                double distance = 0.0;
-                for ( size_t i = 0; i < S; ++i )
-                    distance += std::abs(lhs[i] - rhs[i]);
-                return distance;
+            // Environment probabilities of the beliefs on a single
+            // observation, which are expanded without going through the
+            // full states.
+            std::vector<size_t> sourceObs;
+            std::vector<double> sourceEnvs;
+            BeliefIndex index(E, O);
+            auto addSource = [&](const Belief & b) {
+                size_t o = O;
+                for ( size_t s = 0; s < S; ++s ) {
+                    if ( b[s] > 0.0 ) {
+                        if ( o == O ) o = s % O;
+                        else if ( s % O != o ) { o = O; break; }
+                    }
+                }
+                sourceObs.push_back(o);
+                for ( size_t e = 0; e < E; ++e )
+                    sourceEnvs.push_back(o == O ? 0.0 : b[e * O + o]);
             };
+            for ( auto & b : bl ) {
+                addSource(b);
+                index.add(b);
+            }
+
+            // Each belief draws its samples from its own engine, seeded
+            // from the pass seed and its position in the list, so the
+            // beliefs found do not depend on the number of threads.
+            unsigned passSeed = rand_();
+            size_t batchSize = pool_->size() * 4;
+            std::vector<Samples> samples;
+            std::vector<Impl::ThreadPool::Task> tasks;
 
-            Belief helper; double distance;
             // We apply the discovery process also to all beliefs we discover
             // along the way.
-            for ( auto it = std::begin(bl); it != std::end(bl); ++it ) {
-                // Compute all new beliefs
-                for ( size_t a = 0; a < A; ++a ) {
-                    distances[a] = 0.0;
-                    for ( int j = 0; j < 20; ++j ) {
-                        size_t s = sampleProbability(S, *it, rand_);
-
-                        size_t o;
-                        std::tie(std::ignore, o, std::ignore) = model_.sampleSOR(s, a);
-                        helper = updateBelief(model_, *it, a, o);
-
-                        // Compute distance (here we compare also against elements we just added!)
-                        distance = computeDistance(helper, bl.front());
-                        for ( auto jt = ++std::begin(bl); jt != std::end(bl); ++jt ) {
-                            if ( checkEqualSmall(distance, 0.0) ) break; // We already have it!
-                            distance = std::min(distance, computeDistance(helper, *jt));
-                        }
+            for ( size_t begin = 0; begin < bl.size() && size < max; ) {
+                size_t end = std::min(begin + batchSize, bl.size());
+
+                // Sample the new beliefs of a batch in parallel, and their
+                // distance from the list as it was before the batch.
+                samples.assign(end - begin, Samples());
+                tasks.clear();
+                for ( size_t i = begin; i < end; ++i )
+                    tasks.emplace_back([this, i, begin, passSeed, E, &bl, &sourceObs, &sourceEnvs, &index, &samples]() {
+                        std::seed_seq seq{passSeed, static_cast<unsigned>(i)};
+                        std::default_random_engine rnd(seq);
+                        sampleBeliefs(bl[i], sourceObs[i], sourceEnvs.data() + i * E, index, rnd, &samples[i - begin]);
+                    });
+                pool_->run(tasks);
+
+                // Then select them in order, comparing also against the
+                // beliefs added earlier in the batch.
+                std::vector<double> distances(A);
+                std::vector<size_t> newBeliefs(A);
+                size_t firstAdded = sourceObs.size();
+                for ( size_t i = begin; i < end && size < max; ++i ) {
+                    auto & sm = samples[i - begin];
+                    std::fill(std::begin(distances), std::end(distances), 0.0);
+                    for ( size_t k = 0; k < sm.actions.size(); ++k ) {
+                        size_t o = sm.observations[k];
+                        const double * env = sm.envs.data() + k * E;
+                        double distance = sm.distances[k];
+                        for ( size_t j = firstAdded; j < sourceObs.size() && checkDifferentSmall(distance, 0.0); ++j )
+                            distance = std::min(distance, sourceObs[j] == o ? BeliefIndex::distance(env, sourceEnvs.data() + j * E, E) : 2.0);
                         // Select the best found over 20 times
-                        if ( distance > distances[a] ) {
-                            distances[a] = distance;
-                            newBeliefs[a] = helper;  // ALLOCATION ERROR BECAUSE OF MOVE
+                        if ( distance > distances[sm.actions[k]] ) {
+                            distances[sm.actions[k]] = distance;
+                            newBeliefs[sm.actions[k]] = k;
                         }
                     }
+                    // Find furthest away, add only if it is new.
+                    size_t id = std::distance( std::begin(distances), std::max_element(std::begin(distances), std::end(distances)) );
+                    if ( checkDifferentSmall(distances[id], 0.0) ) {
+                        size_t k = newBeliefs[id], o = sm.observations[k];
+                        const double * env = sm.envs.data() + k * E;
+                        bl.emplace_back(S);
+                        bl.back().fill(0.0);
+                        for ( size_t e = 0; e < E; ++e )
+                            bl.back()(e * O + o) = env[e];
+                        sourceObs.push_back(o);
+                        sourceEnvs.insert(std::end(sourceEnvs), env, env + E);
+                        ++size;
+                    }
                 }
-                // Find furthest away, add only if it is new.
-                size_t id = std::distance( dBegin, std::max_element(dBegin, dEnd) );
-                if ( checkDifferentSmall(distances[id], 0.0) ) {
-		    bl.emplace_back(newBeliefs[id]); // REMOVED STD::MOVE
-                    ++size;
-                    if ( size == max ) break;
+                for ( size_t j = firstAdded; j < sourceObs.size(); ++j )
+                    index.add(sourceObs[j], sourceEnvs.data() + j * E);
+                begin = end;
+            }
+        }
+
+        template <typename M>
+        void BeliefGenerator<M>::sampleBeliefs(const Belief & b, size_t bObs, const double * bEnv, const BeliefIndex & index,
+                                               std::default_random_engine & rnd, Samples * out) const {
+            size_t E = model_.getE(), O = model_.getO();
+            std::uniform_real_distribution<double> sampleDistribution(0.0, 1.0);
+            std::vector<double> env(E), buffer(E);
+
+            for ( size_t a = 0; a < A; ++a ) {
+                size_t first = out->actions.size();
+                for ( int j = 0; j < 20; ++j ) {
+                    // Same walk as sampleProbability(), over the environments when possible.
+                    size_t s;
+                    double p = sampleDistribution(rnd);
+                    if ( bObs < O ) {
+                        size_t e = 0;
+                        for ( ; e + 1 < E && !(bEnv[e] > p); ++e ) p -= bEnv[e];
+                        s = e * O + bObs;
+                    } else {
+                        s = 0;
+                        for ( ; s + 1 < S && !(b[s] > p); ++s ) p -= b[s];
+                    }
+
+                    size_t o;
+                    std::tie(std::ignore, o, std::ignore) = model_.sampleSOR(s, a, rnd);
+
+                    // Same update as updateBelief(), restricted to the states of o.
+                    if ( bObs < O ) {
+                        const double * probs = model_.environment_transitions(bObs, a, o, buffer.data());
+                        double nrm = Impl::BeliefKernel::multiplySum(probs, bEnv, env.data(), E);
+                        if ( !(nrm > 0.0) ) continue;
+                        Impl::BeliefKernel::divide(env.data(), nrm, E);
+                    } else {
+                        std::fill(std::begin(env), std::end(env), 0.0);
+                        StateSpan prev = model_.previous_observations(o);
+                        for ( auto it = prev.begin(); it != prev.end(); ++it ) {
+                            const double * probs = model_.environment_transitions(*it, a, o, buffer.data());
+                            Impl::BeliefKernel::accumulateStrided(probs, b.data() + *it, O, env.data(), E);
+                        }
+                        if ( !(Impl::BeliefKernel::normalize(env.data(), E) > 0.0) ) continue;
+                    }
+
+                    // Samples we already have, or which are already in the
+                    // list, can never be selected.
+                    bool seen = false;
+                    for ( size_t k = first; k < out->actions.size() && !seen; ++k )
+                        seen = out->observations[k] == o && std::equal(std::begin(env), std::end(env), out->envs.data() + k * E);
+                    if ( seen ) continue;
+                    double distance = index.distance(o, env.data(), 5 * std::numeric_limits<double>::epsilon());
+                    if ( checkEqualSmall(distance, 0.0) ) continue;
+
+                    out->actions.push_back(a);
+                    out->observations.push_back(o);
+                    out->distances.push_back(distance);
+                    out->envs.insert(std::end(out->envs), std::begin(env), std::end(env));
                 }
             }
         }
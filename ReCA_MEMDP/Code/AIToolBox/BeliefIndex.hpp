@@ -0,0 +1,235 @@
+#ifndef AI_TOOLBOX_POMDP_BELIEF_INDEX_HEADER_FILE
+#define AI_TOOLBOX_POMDP_BELIEF_INDEX_HEADER_FILE
+
+#include <AIToolbox/POMDP/Types.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace AIToolbox {
+  namespace POMDP {
+
+    /**
+     * @brief This class answers L1 nearest neighbour queries over the beliefs of a MEMDP.
+     *
+     * A belief concentrated on a single observation o is stored as o and
+     * its E probabilities over environments. Two such beliefs on
+     * different observations have disjoint supports, so their distance
+     * is always 2, and only beliefs on the same observation need to be
+     * searched.
+     *
+     * The beliefs of each observation are kept in vantage point trees
+     * over their environment probabilities. Since trees cannot grow, a
+     * new belief is added as a tree of its own, and trees of equal size
+     * are merged and rebuilt, so that there are at most log2(n) trees per
+     * observation and each belief is rebuilt O(log n) times.
+     *
+     * The few beliefs spread over several observations are compared
+     * linearly, by their block on the observation of the query and their
+     * mass elsewhere.
+     *
+     * Queries are const and can be run concurrently.
+     */
+    class BeliefIndex {
+    public:
+      /**
+       * @brief Basic constructor, for an empty index.
+       *
+       * @param E The number of environments.
+       * @param O The number of observations.
+       */
+      BeliefIndex(size_t E, size_t O);
+
+      /**
+       * @brief This function adds a belief over the states e * O + o.
+       */
+      void add(const Belief & b);
+
+      /**
+       * @brief This function adds a belief concentrated on a single observation.
+       *
+       * @param o The observation of the belief.
+       * @param env Its E probabilities.
+       */
+      void add(size_t o, const double * env);
+
+      /**
+       * @brief This function returns the L1 distance from a belief to the closest one in the index.
+       *
+       * @param o The observation of the belief.
+       * @param env Its E probabilities.
+       * @param stop The search ends as soon as a belief this close is found.
+       *
+       * @return The smallest distance, or some distance not above stop; infinity if the index is empty.
+       */
+      double distance(size_t o, const double * env, double stop = 0.0) const;
+
+      /**
+       * @brief This function returns the L1 distance between two environment beliefs.
+       */
+      static double distance(const double * lhs, const double * rhs, size_t E);
+
+      size_t size() const { return size_; }
+
+    private:
+      // A vantage point tree, stored in preorder: the subtree of node i
+      // spans [i, end), its inside children [i + 1, split[i]) are at most
+      // mu[i] away from node i, and the outside ones [split[i], end) at
+      // least as far.
+      struct Tree {
+	std::vector<std::uint32_t> ids;
+	std::vector<std::uint32_t> split;
+	std::vector<double> mu;
+      };
+
+      /**
+       * @brief This function adds a belief spread over several observations.
+       */
+      void addMixed(const Belief & b);
+
+      /**
+       * @brief This function builds a tree over the given beliefs of an observation, reordering them.
+       */
+      void build(size_t o, Tree & tree, size_t begin, size_t end, std::vector<std::pair<double, std::uint32_t>> & buffer) const;
+
+      /**
+       * @brief This function searches a subtree, lowering best to the closest distance found.
+       *
+       * @return True once best is not above stop.
+       */
+      bool search(size_t o, const Tree & tree, size_t begin, size_t end, const double * env, double stop, double & best) const;
+
+      size_t E_, O_, size_;
+      std::vector<std::vector<double>> points_;        // E probabilities per belief, for each observation
+      std::vector<std::vector<Tree>> trees_;           // In decreasing order of size, for each observation
+      std::vector<double> mixedBlocks_;                // O blocks of E probabilities per mixed belief
+      std::vector<double> mixedOutside_;               // Mass outside of each observation per mixed belief
+    };
+
+    inline BeliefIndex::BeliefIndex(size_t E, size_t O) : E_(E), O_(O), size_(0), points_(O), trees_(O) {}
+
+    inline double BeliefIndex::distance(const double * lhs, const double * rhs, size_t E) {
+      double d = 0.0;
+      for (size_t e = 0; e < E; ++e)
+	d += std::abs(lhs[e] - rhs[e]);
+      return d;
+    }
+
+    inline void BeliefIndex::add(const Belief & b) {
+      size_t o = O_;
+      for (size_t s = 0; s < static_cast<size_t>(b.size()); ++s) {
+	if (b[s] > 0.0) {
+	  if (o == O_) o = s % O_;
+	  else if (s % O_ != o) {
+	    addMixed(b);
+	    return;
+	  }
+	}
+      }
+      if (o == O_) o = 0;
+      std::vector<double> env(E_);
+      for (size_t e = 0; e < E_; ++e)
+	env[e] = b[e * O_ + o];
+      add(o, env.data());
+    }
+
+    inline void BeliefIndex::add(size_t o, const double * env) {
+      auto & points = points_[o];
+      auto & trees = trees_[o];
+      std::uint32_t id = points.size() / E_;
+      points.insert(points.end(), env, env + E_);
+      ++size_;
+
+      Tree tree;
+      tree.ids.push_back(id);
+      while (!trees.empty() && trees.back().ids.size() == tree.ids.size()) {
+	tree.ids.insert(tree.ids.end(), trees.back().ids.begin(), trees.back().ids.end());
+	trees.pop_back();
+      }
+      tree.split.resize(tree.ids.size());
+      tree.mu.resize(tree.ids.size());
+      std::vector<std::pair<double, std::uint32_t>> buffer;
+      build(o, tree, 0, tree.ids.size(), buffer);
+      trees.push_back(std::move(tree));
+    }
+
+    inline void BeliefIndex::addMixed(const Belief & b) {
+      double total = 0.0;
+      for (size_t s = 0; s < static_cast<size_t>(b.size()); ++s)
+	total += b[s];
+      for (size_t o = 0; o < O_; ++o) {
+	double mass = 0.0;
+	for (size_t e = 0; e < E_; ++e) {
+	  mixedBlocks_.push_back(b[e * O_ + o]);
+	  mass += b[e * O_ + o];
+	}
+	mixedOutside_.push_back(total - mass);
+      }
+      ++size_;
+    }
+
+    inline void BeliefIndex::build(size_t o, Tree & tree, size_t begin, size_t end, std::vector<std::pair<double, std::uint32_t>> & buffer) const {
+      while (end - begin > 1) {
+	const double * vp = points_[o].data() + tree.ids[begin] * E_;
+	buffer.clear();
+	for (size_t i = begin + 1; i < end; ++i)
+	  buffer.emplace_back(distance(vp, points_[o].data() + tree.ids[i] * E_, E_), tree.ids[i]);
+	auto middle = buffer.begin() + buffer.size() / 2;
+	std::nth_element(buffer.begin(), middle, buffer.end());
+	size_t split = begin + 1 + (middle - buffer.begin());
+	for (size_t i = 0; i < buffer.size(); ++i)
+	  tree.ids[begin + 1 + i] = buffer[i].second;
+	tree.split[begin] = split;
+	tree.mu[begin] = middle->first;
+	build(o, tree, begin + 1, split, buffer);
+	begin = split;
+      }
+      if (begin < end) {
+	tree.split[begin] = end;
+	tree.mu[begin] = 0.0;
+      }
+    }
+
+    inline bool BeliefIndex::search(size_t o, const Tree & tree, size_t begin, size_t end, const double * env, double stop, double & best) const {
+      while (begin < end) {
+	double d = distance(env, points_[o].data() + tree.ids[begin] * E_, E_);
+	if (d < best) {
+	  best = d;
+	  if (best <= stop) return true;
+	}
+	size_t split = tree.split[begin];
+	double mu = tree.mu[begin];
+	// Visit first the side the belief falls in, then the other one if it may still hold a closer belief.
+	if (d <= mu) {
+	  if (d - best <= mu && search(o, tree, begin + 1, split, env, stop, best)) return true;
+	  if (!(d + best >= mu)) return false;
+	  begin = split;
+	} else {
+	  if (d + best >= mu && search(o, tree, split, end, env, stop, best)) return true;
+	  if (!(d - best <= mu)) return false;
+	  end = split;
+	  ++begin;
+	}
+      }
+      return false;
+    }
+
+    inline double BeliefIndex::distance(size_t o, const double * env, double stop) const {
+      double best = std::numeric_limits<double>::infinity();
+      // Any belief on another observation, including the mixed ones, is at most 2 away.
+      if (size_ > points_[o].size() / E_) best = 2.0;
+      for (size_t i = 0; i < mixedOutside_.size(); i += O_)
+	best = std::min(best, mixedOutside_[i + o] + distance(env, mixedBlocks_.data() + (i + o) * E_, E_));
+      if (best <= stop) return best;
+      for (auto & tree : trees_[o])
+	if (search(o, tree, 0, tree.ids.size(), env, stop, best)) break;
+      return best;
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef AI_TOOLBOX_IMPL_BELIEF_KERNEL_HEADER_FILE
+#define AI_TOOLBOX_IMPL_BELIEF_KERNEL_HEADER_FILE
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define AI_TOOLBOX_BELIEF_KERNEL_X86
+#endif
+
+namespace AIToolbox {
+  namespace Impl {
+
+    /**
+     * @brief Vectorized kernels of the environment belief update.
+     *
+     * An environment belief holds one probability per environment, and
+     * is updated with the probabilities of the observed transition in
+     * each environment, stored contiguously (see
+     * Model::environment_transitions).
+     *
+     * The AVX2 path is picked at runtime when the CPU supports it, the
+     * SSE2 one otherwise. Products and quotients are computed lane-wise
+     * while sums are accumulated in index order, so that all paths return
+     * bitwise identical results, equal to those of the plain loops.
+     */
+    namespace BeliefKernel {
+
+      /**
+       * @brief This function computes out[i] = p[i] * in[i] and returns the sum of out.
+       *
+       * out may alias p or in.
+       */
+      inline double multiplySum(const double * p, const double * in, double * out, size_t n);
+
+      /**
+       * @brief This function computes out[i] += p[i] * in[i * stride].
+       *
+       * This gathers one observation across environments from a full
+       * belief over states, where states are laid out as e * O + o.
+       */
+      inline void accumulateStrided(const double * p, const double * in, size_t stride, double * out, size_t n);
+
+      /**
+       * @brief This function divides x by its sum and returns the sum.
+       */
+      inline double normalize(double * x, size_t n);
+
+      /**
+       * @brief This function divides x by nrm.
+       */
+      inline void divide(double * x, double nrm, size_t n);
+
+      // Portable versions, also used for the tails of the vectorized ones.
+      namespace Scalar {
+	inline void multiply(const double * p, const double * in, double * out, size_t n, size_t i) {
+	  for (; i < n; ++i)
+	    out[i] = p[i] * in[i];
+	}
+
+	inline void accumulateStrided(const double * p, const double * in, size_t stride, double * out, size_t n, size_t i) {
+	  for (; i < n; ++i)
+	    out[i] += p[i] * in[i * stride];
+	}
+
+	inline double sum(const double * x, size_t n) {
+	  double s = 0.;
+	  for (size_t i = 0; i < n; ++i)
+	    s += x[i];
+	  return s;
+	}
+
+	inline void divide(double * x, double nrm, size_t n, size_t i) {
+	  for (; i < n; ++i)
+	    x[i] /= nrm;
+	}
+      }
+
+#ifdef AI_TOOLBOX_BELIEF_KERNEL_X86
+      namespace SSE {
+	inline void multiply(const double * p, const double * in, double * out, size_t n) {
+	  size_t i = 0;
+	  for (; i + 2 <= n; i += 2)
+	    _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(p + i), _mm_loadu_pd(in + i)));
+	  Scalar::multiply(p, in, out, n, i);
+	}
+
+	inline void divide(double * x, double nrm, size_t n) {
+	  __m128d d = _mm_set1_pd(nrm);
+	  size_t i = 0;
+	  for (; i + 2 <= n; i += 2)
+	    _mm_storeu_pd(x + i, _mm_div_pd(_mm_loadu_pd(x + i), d));
+	  Scalar::divide(x, nrm, n, i);
+	}
+      }
+
+      namespace AVX2 {
+	__attribute__((target("avx2"))) inline void multiply(const double * p, const double * in, double * out, size_t n) {
+	  size_t i = 0;
+	  for (; i + 4 <= n; i += 4)
+	    _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(p + i), _mm256_loadu_pd(in + i)));
+	  Scalar::multiply(p, in, out, n, i);
+	}
+
+	__attribute__((target("avx2"))) inline void accumulateStrided(const double * p, const double * in, size_t stride, double * out, size_t n) {
+	  const __m256i offsets = _mm256_set_epi64x(3 * stride, 2 * stride, stride, 0);
+	  size_t i = 0;
+	  for (; i + 4 <= n; i += 4) {
+	    __m256d g = _mm256_i64gather_pd(in + i * stride, offsets, 8);
+	    _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(out + i), _mm256_mul_pd(_mm256_loadu_pd(p + i), g)));
+	  }
+	  Scalar::accumulateStrided(p, in, stride, out, n, i);
+	}
+
+	__attribute__((target("avx2"))) inline void divide(double * x, double nrm, size_t n) {
+	  __m256d d = _mm256_set1_pd(nrm);
+	  size_t i = 0;
+	  for (; i + 4 <= n; i += 4)
+	    _mm256_storeu_pd(x + i, _mm256_div_pd(_mm256_loadu_pd(x + i), d));
+	  Scalar::divide(x, nrm, n, i);
+	}
+      }
+
+      inline bool hasAVX2() {
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+      }
+
+      inline double multiplySum(const double * p, const double * in, double * out, size_t n) {
+	if (hasAVX2()) AVX2::multiply(p, in, out, n);
+	else SSE::multiply(p, in, out, n);
+	return Scalar::sum(out, n);
+      }
+
+      inline void accumulateStrided(const double * p, const double * in, size_t stride, double * out, size_t n) {
+	// SSE2 has no gather, strided loads are left to the compiler.
+	if (hasAVX2()) AVX2::accumulateStrided(p, in, stride, out, n);
+	else Scalar::accumulateStrided(p, in, stride, out, n, 0);
+      }
+
+      inline void divide(double * x, double nrm, size_t n) {
+	if (hasAVX2()) AVX2::divide(x, nrm, n);
+	else SSE::divide(x, nrm, n);
+      }
+
+      inline double normalize(double * x, size_t n) {
+	double nrm = Scalar::sum(x, n);
+	divide(x, nrm, n);
+	return nrm;
+      }
+#else
+      inline double multiplySum(const double * p, const double * in, double * out, size_t n) {
+	Scalar::multiply(p, in, out, n, 0);
+	return Scalar::sum(out, n);
+      }
+
+      inline void accumulateStrided(const double * p, const double * in, size_t stride, double * out, size_t n) {
+	Scalar::accumulateStrided(p, in, stride, out, n, 0);
+      }
+
+      inline void divide(double * x, double nrm, size_t n) {
+	Scalar::divide(x, nrm, n, 0);
+      }
+
+      inline double normalize(double * x, size_t n) {
+	double nrm = Scalar::sum(x, n);
+	divide(x, nrm, n);
+	return nrm;
+      }
+#endif
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef AI_TOOLBOX_POMDP_BLOCK_POLICY_HEADER_FILE
+#define AI_TOOLBOX_POMDP_BLOCK_POLICY_HEADER_FILE
+
+#include <AIToolbox/POMDP/Types.hpp>
+#include "BlockValueFunction.hpp"
+
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+
+namespace AIToolbox {
+  namespace POMDP {
+
+    /**
+     * @brief This class represents a POMDP Policy stored as a BlockValueFunction.
+     *
+     * It works as POMDP::Policy, except that beliefs are given with
+     * their observation, since only the block of that observation is
+     * looked at. The ValueFunction is shared between copies, so that
+     * copying the policy for each evaluation thread is cheap.
+     *
+     * Horizons whose values were dropped by the solver can still be
+     * followed as a policy graph with sampleAction(id, o, horizon). At a
+     * belief, the closest later horizon with values is used instead.
+     * startRun() and continueRun() choose between the two along a run,
+     * so each copy of the policy follows one run at a time.
+     */
+    class BlockPolicy {
+    public:
+      /**
+       * @brief Basic constructor.
+       *
+       * @param a The number of actions of the model.
+       * @param v The BlockValueFunction to derive the policy from.
+       */
+      BlockPolicy(size_t a, BlockValueFunction v);
+
+      /**
+       * @brief This function chooses an action for a belief, given a horizon.
+       *
+       * @param b The sampled belief, which must be zero outside of observation o.
+       * @param o The observation of the belief.
+       * @param horizon The requested horizon.
+       *
+       * @return A tuple containing the chosen action and the id of the vector used, at getValuesHorizon(horizon).
+       */
+      std::tuple<size_t, size_t> sampleAction(const Belief & b, size_t o, unsigned horizon) const;
+
+      /**
+       * @brief This function chooses an action for a belief over environments, given a horizon.
+       *
+       * @param b The E probabilities of the environments.
+       * @param o The current observation.
+       * @param horizon The requested horizon.
+       *
+       * @return A tuple containing the chosen action and the id of the vector used, at getValuesHorizon(horizon).
+       */
+      std::tuple<size_t, size_t> sampleAction(const double * b, size_t o, unsigned horizon) const;
+
+      /**
+       * @brief This function chooses an action given the previous action and observation.
+       *
+       * @param id The id of the vector used at the previous step, at horizon + 1.
+       * @param o The observation obtained.
+       * @param horizon The current horizon.
+       *
+       * @return A tuple containing the chosen action and the id of the vector used.
+       */
+      std::tuple<size_t, size_t> sampleAction(size_t id, size_t o, unsigned horizon) const;
+
+      /**
+       * @brief This function chooses the first action of a run.
+       *
+       * @param b The initial belief, which must be zero outside of observation o.
+       * @param o The initial observation.
+       * @param horizon The requested horizon.
+       *
+       * @return A tuple containing the chosen action and the id of the vector used, at getValuesHorizon(horizon).
+       */
+      std::tuple<size_t, size_t> startRun(const Belief & b, size_t o, unsigned horizon);
+
+      /**
+       * @brief This function chooses the next action of a run.
+       *
+       * If the values of the horizon were dropped and the action taken
+       * is the one chosen at the previous step, the policy graph is
+       * followed one step from the vector used there, as long as this
+       * does not go below the requested horizon. Otherwise the action is
+       * chosen at the belief, as sampleAction() does.
+       *
+       * @param b The updated belief, which must be zero outside of observation o.
+       * @param a The action taken at the previous step.
+       * @param o The observation obtained.
+       * @param horizon The current horizon.
+       *
+       * @return A tuple containing the chosen action and the id of the vector used.
+       */
+      std::tuple<size_t, size_t> continueRun(const Belief & b, size_t a, size_t o, unsigned horizon);
+
+      /**
+       * @brief This function returns the closest horizon, from the given one up, whose values are stored.
+       */
+      unsigned getValuesHorizon(unsigned horizon) const;
+
+      size_t getA() const { return A; }
+      size_t getH() const { return H; }
+      const BlockValueFunction & getValueFunction() const { return *policy_; }
+
+    private:
+      size_t A, H;
+      std::shared_ptr<const BlockValueFunction> policy_;
+
+      // Last step of the current run: vector id, its horizon (0 if none) and its action.
+      size_t runId_, runAction_;
+      unsigned runHorizon_;
+    };
+
+    inline BlockPolicy::BlockPolicy(size_t a, BlockValueFunction v) : A(a), H(v.size() - 1), runId_(0), runAction_(0), runHorizon_(0) {
+      if ( !v.size() ) throw std::invalid_argument("The BlockValueFunction supplied to POMDP::BlockPolicy is empty.");
+      policy_ = std::make_shared<const BlockValueFunction>(std::move(v));
+    }
+
+    inline std::tuple<size_t, size_t> BlockPolicy::sampleAction(const Belief & b, size_t o, unsigned horizon) const {
+      auto & vlist = (*policy_)[getValuesHorizon(horizon)];
+      size_t E = vlist.getE(), O = vlist.getO();
+      std::vector<double> env(E);
+      for (size_t e = 0; e < E; ++e)
+	env[e] = b(e * O + o);
+      return sampleAction(env.data(), o, horizon);
+    }
+
+    inline std::tuple<size_t, size_t> BlockPolicy::sampleAction(const double * b, size_t o, unsigned horizon) const {
+      auto & vlist = (*policy_)[getValuesHorizon(horizon)];
+      size_t id = vlist.owner(o, vlist.bestAtBelief(o, b).first);
+      return std::make_tuple(vlist.getAction(id), id);
+    }
+
+    inline std::tuple<size_t, size_t> BlockPolicy::sampleAction(size_t id, size_t o, unsigned horizon) const {
+      // Horizon + 1 means one step in the past.
+      assert(("Following a horizon which was not kept", (*policy_)[horizon+1].size() > id && (*policy_)[horizon].size()));
+      size_t newId  = (*policy_)[horizon+1].getObs(id)[o];
+      size_t action = (*policy_)[horizon].getAction(newId);
+      return std::make_tuple(action, newId);
+    }
+
+    inline std::tuple<size_t, size_t> BlockPolicy::startRun(const Belief & b, size_t o, unsigned horizon) {
+      auto result = sampleAction(b, o, horizon);
+      std::tie(runAction_, runId_) = result;
+      runHorizon_ = getValuesHorizon(horizon);
+      return result;
+    }
+
+    inline std::tuple<size_t, size_t> BlockPolicy::continueRun(const Belief & b, size_t a, size_t o, unsigned horizon) {
+      // Steps where no prediction was made may leave the run above horizon + 1.
+      bool follow = !(*policy_)[horizon].hasValues() && runHorizon_ > horizon && runAction_ == a
+		    && (*policy_)[runHorizon_ - 1].size();
+      auto result = follow ? sampleAction(runId_, o, runHorizon_ - 1) : sampleAction(b, o, horizon);
+      std::tie(runAction_, runId_) = result;
+      runHorizon_ = follow ? runHorizon_ - 1 : getValuesHorizon(horizon);
+      return result;
+    }
+
+    inline unsigned BlockPolicy::getValuesHorizon(unsigned horizon) const {
+      while ( horizon < H && !(*policy_)[horizon].hasValues() ) ++horizon;
+      return horizon;
+    }
+  }
+}
+
+#endif
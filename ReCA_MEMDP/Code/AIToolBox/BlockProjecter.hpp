@@ -0,0 +1,148 @@
+#ifndef AI_TOOLBOX_POMDP_BLOCK_PROJECTER_HEADER_FILE
+#define AI_TOOLBOX_POMDP_BLOCK_PROJECTER_HEADER_FILE
+
+#include <AIToolbox/POMDP/Types.hpp>
+#include "BlockValueFunction.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace AIToolbox {
+  namespace POMDP {
+
+#ifndef DOXYGEN_SKIP
+    // This is done to avoid bringing around the enable_if everywhere.
+    template <typename M, typename = typename std::enable_if<is_model<M>::value>::type>
+    class BlockProjecter;
+#endif
+    /**
+     * @brief This class offers projecting facilities on the blocks of a BlockVList.
+     *
+     * The projection of an alpha vector for action a and observation o
+     * only differs from the immediate rewards on the observations
+     * preceding o, and there it only depends on the block of o. Instead
+     * of materializing the projections of every vector, this class
+     * computes them on the fly from the blocks, the
+     * environment_transitions() of the model and the immediate rewards,
+     * which are stored by observation with environments contiguous.
+     */
+    template <typename M>
+    class BlockProjecter<M> {
+    public:
+      /**
+       * @brief Basic constructor.
+       *
+       * This constructor precomputes the immediate rewards and the
+       * successors of each observation.
+       *
+       * @param model The model that is used as a base for all projections.
+       */
+      BlockProjecter(const M & model);
+
+      /**
+       * @brief This function returns the value of a projected block at an environment belief.
+       *
+       * @param w The list containing the block.
+       * @param k The index of the block among those of o.
+       * @param p The observation of the belief, which must precede o.
+       * @param a The action of the projection.
+       * @param o The observation of the block.
+       * @param b The E probabilities of the belief.
+       * @param buffer Room for E values.
+       */
+      double value(const BlockVList & w, size_t k, size_t p, size_t a, size_t o, const double * b, double * buffer) const;
+
+      /**
+       * @brief This function computes a block of the cross-sum of projections for an action.
+       *
+       * For each observation o following p, the projection of the block
+       * choice[o] of o is added, in increasing order of o as in the dense
+       * cross-sum.
+       *
+       * @param w The list to project.
+       * @param a The action of the cross-sum.
+       * @param p The observation of the block to compute.
+       * @param choice The O indices of the chosen blocks, see BlockVList::block().
+       * @param out Room for E values.
+       * @param buffer Room for E values.
+       */
+      void crossBlock(const BlockVList & w, size_t a, size_t p, const std::uint32_t * choice, double * out, double * buffer) const;
+
+      /**
+       * @brief This function returns the immediate rewards of an action in an observation.
+       *
+       * @return E rewards, normalized by the number of observations.
+       */
+      const double * getImmediateRewards(size_t a, size_t p) const { return immediateRewards_.data() + (a * O + p) * E; }
+
+      /**
+       * @brief This function returns the observations which can follow p, in increasing order.
+       */
+      const std::vector<std::uint32_t> & successors(size_t p) const { return successors_[p]; }
+
+    private:
+      /**
+       * @brief This function precomputes immediate rewards for the POMDP state-action pairs.
+       */
+      void computeImmediateRewards();
+
+      const M & model_;
+      size_t E, A, O;
+      double discount_;
+
+      std::vector<double> immediateRewards_;                 // E rewards per (action, observation)
+      std::vector<std::vector<std::uint32_t>> successors_;
+    };
+
+    template <typename M>
+    BlockProjecter<M>::BlockProjecter(const M & model) : model_(model), E(model_.getE()), A(model_.getA()), O(model_.getO()), discount_(model_.getDiscount()),
+							 immediateRewards_(A * O * E, 0.0), successors_(O)
+    {
+      computeImmediateRewards();
+      for ( size_t o = 0; o < O; ++o ) {
+	StateSpan prev = model_.previous_observations(o);
+	for (auto it = prev.begin(); it != prev.end(); ++it)
+	  successors_[*it].push_back(o);
+      }
+    }
+
+    template <typename M>
+    double BlockProjecter<M>::value(const BlockVList & w, size_t k, size_t p, size_t a, size_t o, const double * b, double * buffer) const {
+      const double * probs = model_.environment_transitions(p, a, o, buffer);
+      return Impl::BlockKernel::projectDot(probs, w.block(o, k), getImmediateRewards(a, p), discount_, b, E);
+    }
+
+    template <typename M>
+    void BlockProjecter<M>::crossBlock(const BlockVList & w, size_t a, size_t p, const std::uint32_t * choice, double * out, double * buffer) const {
+      const double * irw = getImmediateRewards(a, p);
+      for (size_t e = 0; e < E; ++e)
+	out[e] = O * irw[e];
+      for (auto o : successors_[p]) {
+	const double * probs = model_.environment_transitions(p, a, o, buffer);
+	Impl::BlockKernel::accumulateProjected(probs, w.block(o, choice[o]), irw, discount_, out, E);
+      }
+    }
+
+    template <typename M>
+    void BlockProjecter<M>::computeImmediateRewards() {
+      for ( size_t a = 0; a < A; ++a ) {
+	for ( size_t e = 0; e < E; ++e ) {
+	  for ( size_t p = 0; p < O; ++p ) {
+	    size_t s = e * O + p;
+	    double & r = immediateRewards_[(a * O + p) * E + e];
+	    std::vector<size_t> target = model_.reachable_states(s);
+	    for (auto it = target.begin(); it != target.end(); ++it) {
+	      // OPT: Only one s1 such that T(s, a, s1) and R(s, a, s1) are both non-null
+	      r += model_.getTransitionProbability(s, a, *it) * model_.getExpectedReward(s, a, *it);
+	    }
+	    // You can find out why this is divided in the incremental pruning paper =)
+	    // The idea is that at the end of all the cross sums it's going to add up to the correct value.
+	    r /= static_cast<double>(O);
+	  }
+	}
+      }
+    }
+  }
+}
+
+#endif
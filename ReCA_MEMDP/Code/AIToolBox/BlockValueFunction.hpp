@@ -0,0 +1,300 @@
+#ifndef AI_TOOLBOX_POMDP_BLOCK_VALUE_FUNCTION_HEADER_FILE
+#define AI_TOOLBOX_POMDP_BLOCK_VALUE_FUNCTION_HEADER_FILE
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace AIToolbox {
+  namespace Impl {
+
+    /**
+     * @brief Kernels on the E-dimensional blocks of a MEMDP alpha vector.
+     *
+     * A block holds the values of an alpha vector for one observation, in
+     * all environments (states e * O + o for a fixed o). Sums are
+     * accumulated in environment order, which is also the order in which
+     * the dense code visits these states, so that results match it bit
+     * for bit.
+     */
+    namespace BlockKernel {
+
+      /**
+       * @brief This function returns the sum of v[e] * b[e].
+       */
+      inline double dot(const double * v, const double * b, size_t E) {
+	double s = 0.;
+	for (size_t e = 0; e < E; ++e)
+	  s += v[e] * b[e];
+	return s;
+      }
+
+      /**
+       * @brief This function returns true if v[e] >= w[e] for all e.
+       */
+      inline bool dominates(const double * v, const double * w, size_t E) {
+	for (size_t e = 0; e < E; ++e)
+	  if (v[e] < w[e]) return false;
+	return true;
+      }
+
+      /**
+       * @brief This function returns the dot product of a projected block with b, without storing the projection.
+       *
+       * The projection of the block alpha of o2 on o1 for action a is
+       * (p[e] * alpha[e]) * discount + irw[e], where p[e] is the
+       * probability of o1 -a-> o2 in environment e and irw the immediate
+       * rewards of o1.
+       */
+      inline double projectDot(const double * p, const double * alpha, const double * irw, double discount, const double * b, size_t E) {
+	double s = 0.;
+	for (size_t e = 0; e < E; ++e)
+	  s += ((p[e] * alpha[e]) * discount + irw[e]) * b[e];
+	return s;
+      }
+
+      /**
+       * @brief This function adds a projected block, minus its immediate rewards, to out.
+       */
+      inline void accumulateProjected(const double * p, const double * alpha, const double * irw, double discount, double * out, size_t E) {
+	for (size_t e = 0; e < E; ++e)
+	  out[e] += ((p[e] * alpha[e]) * discount + irw[e]) - irw[e];
+      }
+
+      /**
+       * @brief This function returns the maximum of |v[e] - w[e]|.
+       */
+      inline double distance(const double * v, const double * w, size_t E) {
+	double d = 0.;
+	for (size_t e = 0; e < E; ++e)
+	  d = std::max(d, std::abs(v[e] - w[e]));
+	return d;
+      }
+    }
+  }
+
+  namespace POMDP {
+
+    /**
+     * @brief This class represents a VList of a MEMDP by observation blocks.
+     *
+     * In a MEMDP every reachable belief is concentrated on a single
+     * observation, so the value of an alpha vector at a belief only
+     * depends on the E values of that observation. Each alpha vector is
+     * thus stored as O blocks of E values, and a block is dropped when an
+     * earlier alpha vector already has a block at least as large for the
+     * same observation: at every belief the earlier one is worth as much,
+     * so the later one is never the first maximum there.
+     *
+     * Since most blocks of the alpha vectors built for an action only
+     * depend on the action itself, they are duplicates, and only about one
+     * block per observation and belief point is left in practice instead
+     * of O.
+     *
+     * When vectors are added in decreasing lexicographic order, the first
+     * best block at a belief belongs to the vector findBestAtBelief()
+     * would return among the full vectors, ties included.
+     *
+     * The first alpha vector is never pruned, and keeps all its blocks.
+     * Alpha vectors keep their id, action and the ids of the vectors of
+     * the previous horizon they were built from, even when all their
+     * blocks are gone.
+     */
+    class BlockVList {
+    public:
+      /**
+       * @brief Basic constructor, for an empty list.
+       *
+       * @param E The number of environments.
+       * @param O The number of observations.
+       */
+      BlockVList(size_t E, size_t O) : E_(E), O_(O), values_(O), owners_(O) {}
+
+      /**
+       * @brief This function returns the list of horizon 0, with a single zero vector.
+       */
+      static BlockVList zero(size_t E, size_t O);
+
+      /**
+       * @brief This function adds an alpha vector, without blocks.
+       *
+       * @param action The action of the vector.
+       * @param obs The O ids of the vectors of the previous horizon chosen for each observation.
+       *
+       * @return The id of the new vector.
+       */
+      size_t add(size_t action, const std::uint32_t * obs);
+
+      /**
+       * @brief This function sets a block of the last vector added, unless an earlier vector dominates it.
+       *
+       * @param o The observation of the block.
+       * @param values Its E values.
+       *
+       * @return True if the block was stored.
+       */
+      bool addBlock(size_t o, const double * values);
+
+      /**
+       * @brief This function finds the first best block of an observation at an environment belief.
+       *
+       * The observation must own at least one block.
+       *
+       * @param o The observation of the belief.
+       * @param b Its E probabilities.
+       *
+       * @return The index of the block, see owner(), and its value.
+       */
+      std::pair<size_t, double> bestAtBelief(size_t o, const double * b) const;
+
+      /**
+       * @brief This function frees the blocks, keeping the actions and observation links.
+       *
+       * The list is then a node of a policy graph: it can still be
+       * followed from the next horizon, but not evaluated at a belief.
+       */
+      void dropValues();
+
+      /**
+       * @brief This function frees the whole list.
+       */
+      void clear();
+
+      /**
+       * @brief This function returns whether the blocks are stored, see dropValues().
+       *
+       * The per-observation block accessors may only be used if so.
+       */
+      bool hasValues() const { return !owners_.empty(); }
+
+      size_t size() const { return actions_.size(); }
+      size_t getE() const { return E_; }
+      size_t getO() const { return O_; }
+      size_t getAction(size_t id) const { return actions_[id]; }
+      const std::uint32_t * getObs(size_t id) const { return obs_.data() + id * O_; }
+
+      /**
+       * @brief This function returns the number of blocks stored for an observation.
+       */
+      size_t blocks(size_t o) const { return owners_[o].size(); }
+
+      /**
+       * @brief This function returns the total number of blocks stored.
+       */
+      size_t blocks() const;
+
+      /**
+       * @brief This function returns the id of the vector owning the k-th block of an observation.
+       */
+      size_t owner(size_t o, size_t k) const { return owners_[o][k]; }
+
+      /**
+       * @brief This function returns the values of the k-th block of an observation.
+       */
+      const double * block(size_t o, size_t k) const { return values_[o].data() + k * E_; }
+
+    private:
+      size_t E_, O_;
+      std::vector<std::uint32_t> actions_;
+      std::vector<std::uint32_t> obs_;                   // O entries per vector
+      std::vector<std::vector<double>> values_;          // Blocks of each observation, E values each
+      std::vector<std::vector<std::uint32_t>> owners_;   // Vector of each block, in increasing order
+    };
+
+    /**
+     * @brief A BlockVList per horizon, as in a ValueFunction.
+     */
+    using BlockValueFunction = std::vector<BlockVList>;
+
+    /**
+     * @brief This function computes the weak bound distance between two BlockVLists.
+     *
+     * This is weakBoundDistance() restricted to blocks: the farthest
+     * new block from its closest old block of the same observation.
+     */
+    double weakBoundDistance(const BlockVList & oldV, const BlockVList & newV);
+
+    inline BlockVList BlockVList::zero(size_t E, size_t O) {
+      BlockVList v(E, O);
+      std::vector<std::uint32_t> obs(O, 0);
+      std::vector<double> values(E, 0.0);
+      v.add(0, obs.data());
+      for (size_t o = 0; o < O; ++o)
+	v.addBlock(o, values.data());
+      return v;
+    }
+
+    inline size_t BlockVList::add(size_t action, const std::uint32_t * obs) {
+      actions_.push_back(action);
+      obs_.insert(obs_.end(), obs, obs + O_);
+      return actions_.size() - 1;
+    }
+
+    inline bool BlockVList::addBlock(size_t o, const double * values) {
+      assert(("Adding a block to no vector", actions_.size() > 0));
+      auto & owners = owners_[o];
+      auto & blocks = values_[o];
+      std::uint32_t id = actions_.size() - 1;
+      assert(("Adding two blocks for the same observation", owners.empty() || owners.back() < id));
+      for (size_t k = 0; k < owners.size(); ++k)
+	if (Impl::BlockKernel::dominates(blocks.data() + k * E_, values, E_)) return false;
+      owners.push_back(id);
+      blocks.insert(blocks.end(), values, values + E_);
+      return true;
+    }
+
+    inline std::pair<size_t, double> BlockVList::bestAtBelief(size_t o, const double * b) const {
+      assert(("Looking for the best block of an observation without blocks", !owners_[o].empty()));
+      const auto & blocks = values_[o];
+      size_t best = 0;
+      double bestValue = Impl::BlockKernel::dot(blocks.data(), b, E_);
+      for (size_t k = 1; k < owners_[o].size(); ++k) {
+	double value = Impl::BlockKernel::dot(blocks.data() + k * E_, b, E_);
+	if (value > bestValue) {
+	  bestValue = value;
+	  best = k;
+	}
+      }
+      return std::make_pair(best, bestValue);
+    }
+
+    inline void BlockVList::dropValues() {
+      std::vector<std::vector<double>>().swap(values_);
+      std::vector<std::vector<std::uint32_t>>().swap(owners_);
+    }
+
+    inline void BlockVList::clear() {
+      dropValues();
+      std::vector<std::uint32_t>().swap(actions_);
+      std::vector<std::uint32_t>().swap(obs_);
+    }
+
+    inline size_t BlockVList::blocks() const {
+      size_t n = 0;
+      for (auto & owners : owners_)
+	n += owners.size();
+      return n;
+    }
+
+    inline double weakBoundDistance(const BlockVList & oldV, const BlockVList & newV) {
+      if ( !oldV.size() ) return 0.0;
+      size_t E = newV.getE();
+      double distance = 0.0;
+      for (size_t o = 0; o < newV.getO(); ++o) {
+	for (size_t k = 0; k < newV.blocks(o); ++k) {
+	  double closestDistance = std::numeric_limits<double>::infinity();
+	  for (size_t j = 0; j < oldV.blocks(o); ++j)
+	    closestDistance = std::min(closestDistance, Impl::BlockKernel::distance(newV.block(o, k), oldV.block(o, j), E));
+	  distance = std::max(distance, closestDistance);
+	}
+      }
+      return distance;
+    }
+  }
+}
+
+#endif
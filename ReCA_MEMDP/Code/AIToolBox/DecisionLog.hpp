@@ -0,0 +1,97 @@
+#ifndef AI_TOOLBOX_POMDP_DECISION_LOG_HEADER_FILE
+#define AI_TOOLBOX_POMDP_DECISION_LOG_HEADER_FILE
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+namespace AIToolbox {
+  namespace POMDP {
+
+    /**
+     * @brief This struct holds the measurements of a single online planning decision.
+     */
+    struct DecisionStats {
+      double wallMs = 0.0;         // Time spent simulating
+      unsigned simulations = 0;    // Simulations completed
+      size_t nodes = 0;            // Belief nodes allocated in the main tree
+      unsigned depth = 0;          // Deepest tree level reached, the root being 0
+      size_t cacheHits = 0;        // Exact belief updates found in the cache
+      size_t cacheMisses = 0;      // Exact belief updates computed
+      size_t rolloutSteps = 0;     // Model steps sampled by rollouts
+      size_t prunedEnvs = 0;       // Environments dropped from the exact beliefs of new nodes
+      size_t action = 0;           // Action returned
+    };
+
+    /**
+     * @brief This class writes one line per planning decision to a file.
+     *
+     * Lines are either CSV (with a header) or JSON objects, so that
+     * throughput can be charted across runs. The log is meant to be
+     * shared by all copies of a solver: writes are serialized, and
+     * every decision gets a unique sequence number.
+     */
+    class DecisionLog {
+    public:
+      enum class Format { CSV, JSON };
+
+      /**
+       * @brief Basic constructor.
+       *
+       * @param filename The file to write, truncated if it exists.
+       * @param format The format of each line.
+       */
+      DecisionLog(const std::string & filename, Format format);
+
+      /**
+       * @brief This function appends a decision to the log.
+       *
+       * @param solver A short name of the solver that took the decision.
+       * @param d The measurements of the decision.
+       */
+      void write(const char * solver, const DecisionStats & d);
+
+      /**
+       * @brief This function returns whether the file could be opened.
+       */
+      bool good() const { return out_.good(); }
+
+      /**
+       * @brief This function returns the number of decisions written so far.
+       */
+      size_t size() const { return count_; }
+
+    private:
+      std::ofstream out_;
+      Format format_;
+      std::mutex mutex_;
+      std::atomic<size_t> count_;
+    };
+
+    inline DecisionLog::DecisionLog(const std::string & filename, Format format) : out_(filename), format_(format), count_(0) {
+      if (format_ == Format::CSV)
+	out_ << "decision,solver,wall_ms,simulations,sims_per_s,nodes,depth,cache_hits,cache_misses,rollout_steps,pruned_envs,action\n";
+    }
+
+    inline void DecisionLog::write(const char * solver, const DecisionStats & d) {
+      double rate = d.wallMs > 0 ? 1000.0 * d.simulations / d.wallMs : 0.0;
+      size_t id = count_++;
+      // Format outside of the lock, only the write is serialized.
+      std::ostringstream line;
+      if (format_ == Format::CSV)
+	line << id << ',' << solver << ',' << d.wallMs << ',' << d.simulations << ',' << rate << ',' << d.nodes << ','
+	     << d.depth << ',' << d.cacheHits << ',' << d.cacheMisses << ',' << d.rolloutSteps << ',' << d.prunedEnvs << ',' << d.action << '\n';
+      else
+	line << "{\"decision\":" << id << ",\"solver\":\"" << solver << "\",\"wall_ms\":" << d.wallMs
+	     << ",\"simulations\":" << d.simulations << ",\"sims_per_s\":" << rate << ",\"nodes\":" << d.nodes
+	     << ",\"depth\":" << d.depth << ",\"cache_hits\":" << d.cacheHits << ",\"cache_misses\":" << d.cacheMisses
+	     << ",\"rollout_steps\":" << d.rolloutSteps << ",\"pruned_envs\":" << d.prunedEnvs << ",\"action\":" << d.action << "}\n";
+      std::lock_guard<std::mutex> lock(mutex_);
+      out_ << line.str();
+    }
+  }
+}
+
+#endif
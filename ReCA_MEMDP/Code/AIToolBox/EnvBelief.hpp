@@ -0,0 +1,275 @@
+#ifndef AI_TOOLBOX_POMDP_ENV_BELIEF_HEADER_FILE
+#define AI_TOOLBOX_POMDP_ENV_BELIEF_HEADER_FILE
+
+#include "BeliefKernel.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace AIToolbox {
+  namespace POMDP {
+
+    /**
+     * @brief This class represents a belief over environments by its support.
+     *
+     * Only the environments with a non-zero probability are stored, in
+     * increasing order. In a MEMDP most observations rule out whole
+     * groups of environments, so the support quickly shrinks to a few
+     * entries and updates only touch those.
+     *
+     * Environments whose probability falls below a threshold can be
+     * pruned as well: the remaining ones are renormalized, and the mass
+     * discarded so far is kept in dropped(). With a zero threshold
+     * nothing but exact zeros is removed, and the probabilities are
+     * bitwise identical to those of the dense update.
+     *
+     * The static functions work on raw arrays, so that beliefs stored
+     * elsewhere (e.g. in a SearchTree) share the same code.
+     */
+    class SparseEnvBelief {
+    public:
+      /**
+       * @brief Basic constructor, for an empty belief.
+       */
+      SparseEnvBelief() : dropped_(0.0) {}
+
+      /**
+       * @brief This constructor copies a support.
+       *
+       * @param envs n environments, in increasing order.
+       * @param probs Their probabilities.
+       * @param n The size of the support.
+       */
+      SparseEnvBelief(const std::uint32_t * envs, const double * probs, size_t n) : envs_(envs, envs + n), probs_(probs, probs + n), dropped_(0.0) {}
+
+      /**
+       * @brief This constructor extracts the support of a dense belief.
+       *
+       * @param dense Any container of E probabilities indexed with operator[].
+       * @param E The number of environments.
+       * @param threshold Environments below this probability are pruned.
+       */
+      template <typename V>
+      SparseEnvBelief(const V & dense, size_t E, double threshold = 0.0);
+
+      /**
+       * @brief This function returns the uniform belief over E environments.
+       */
+      static SparseEnvBelief uniform(size_t E);
+
+      /**
+       * @brief This function updates the belief after observing pobs -a-> o.
+       *
+       * @param model The model, providing the environment_transitions() of the support.
+       * @param pobs The previous observation.
+       * @param a The action taken.
+       * @param o The observation reached.
+       * @param threshold Environments below this probability are pruned.
+       *
+       * @return False if the observation is impossible in every environment of the support, in which case the belief is left empty.
+       */
+      template <typename M>
+      bool update(const M & model, size_t pobs, size_t a, size_t o, double threshold = 0.0);
+
+      /**
+       * @brief This function prunes the environments below a threshold.
+       *
+       * @return The mass dropped, before renormalization.
+       */
+      double prune(double threshold);
+
+      /**
+       * @brief This function returns the probability of an environment, in O(log |support|).
+       */
+      double operator[](size_t e) const;
+
+      /**
+       * @brief This function samples an environment.
+       *
+       * The draw is the same as sampleProbability() on the dense belief.
+       */
+      template <typename G>
+      size_t sample(G & rnd) const { return sample(envs_.data(), probs_.data(), envs_.size(), rnd); }
+
+      /**
+       * @brief This function returns the dense belief over E environments.
+       */
+      std::vector<double> toDense(size_t E) const;
+
+      size_t size() const { return envs_.size(); }
+      bool empty() const { return envs_.empty(); }
+      const std::uint32_t * envs() const { return envs_.data(); }
+      const double * probs() const { return probs_.data(); }
+
+      /**
+       * @brief This function returns the total mass pruned since construction.
+       *
+       * Each pruning drops a fraction of the mass which was left by the
+       * previous ones, so this is 1 - prod(1 - dropped_i).
+       */
+      double dropped() const { return dropped_; }
+
+      /**
+       * @brief This function updates a support given the transitions of its environments.
+       *
+       * outEnvs may alias envs, and outProbs may alias p or probs.
+       *
+       * @param p The n transition probabilities of the environments, see Model::environment_transitions.
+       * @param envs The n environments of the support.
+       * @param probs Their probabilities.
+       * @param n The size of the support.
+       * @param outEnvs Where to write the new support.
+       * @param outProbs Where to write its probabilities.
+       * @param threshold Environments below this probability are pruned.
+       * @param dropped If not null, set to the mass pruned.
+       *
+       * @return The size of the new support, 0 if the transition is impossible.
+       */
+      static size_t update(const double * p, const std::uint32_t * envs, const double * probs, size_t n,
+			   std::uint32_t * outEnvs, double * outProbs, double threshold, double * dropped = nullptr);
+
+      /**
+       * @brief This function removes the environments below a threshold from a support, and renormalizes it.
+       *
+       * The most likely environment is always kept.
+       *
+       * @return The size of the new support.
+       */
+      static size_t prune(std::uint32_t * envs, double * probs, size_t n, double threshold, double * dropped = nullptr);
+
+      /**
+       * @brief This function samples an environment from a support.
+       */
+      template <typename G>
+      static size_t sample(const std::uint32_t * envs, const double * probs, size_t n, G & rnd);
+
+    private:
+      // Compacts the entries with a probability of at least cutoff, and returns their number and mass.
+      static size_t compact(const std::uint32_t * envs, const double * probs, size_t n, double cutoff,
+			    std::uint32_t * outEnvs, double * outProbs, double & kept);
+
+      std::vector<std::uint32_t> envs_;
+      std::vector<double> probs_;
+      double dropped_;
+    };
+
+    template <typename V>
+    SparseEnvBelief::SparseEnvBelief(const V & dense, size_t E, double threshold) : dropped_(0.0) {
+      for (size_t e = 0; e < E; ++e) {
+	if (dense[e] > 0.0) {
+	  envs_.push_back(e);
+	  probs_.push_back(dense[e]);
+	}
+      }
+      prune(threshold);
+    }
+
+    inline SparseEnvBelief SparseEnvBelief::uniform(size_t E) {
+      SparseEnvBelief b;
+      b.envs_.resize(E);
+      b.probs_.assign(E, 1.0 / E);
+      for (size_t e = 0; e < E; ++e) b.envs_[e] = e;
+      return b;
+    }
+
+    template <typename M>
+    bool SparseEnvBelief::update(const M & model, size_t pobs, size_t a, size_t o, double threshold) {
+      std::vector<double> p(envs_.size());
+      model.environment_transitions(pobs, a, o, envs_.data(), envs_.size(), p.data());
+      double d = 0.0;
+      size_t n = update(p.data(), envs_.data(), probs_.data(), envs_.size(), envs_.data(), probs_.data(), threshold, &d);
+      envs_.resize(n);
+      probs_.resize(n);
+      dropped_ += (1.0 - dropped_) * d;
+      return n > 0;
+    }
+
+    inline double SparseEnvBelief::prune(double threshold) {
+      double d = 0.0;
+      size_t n = prune(envs_.data(), probs_.data(), envs_.size(), threshold, &d);
+      envs_.resize(n);
+      probs_.resize(n);
+      dropped_ += (1.0 - dropped_) * d;
+      return d;
+    }
+
+    inline double SparseEnvBelief::operator[](size_t e) const {
+      auto it = std::lower_bound(envs_.begin(), envs_.end(), e);
+      return ((it != envs_.end() && *it == e) ? probs_[it - envs_.begin()] : 0.0);
+    }
+
+    inline std::vector<double> SparseEnvBelief::toDense(size_t E) const {
+      std::vector<double> dense(E, 0.0);
+      for (size_t i = 0; i < envs_.size(); ++i)
+	dense[envs_[i]] = probs_[i];
+      return dense;
+    }
+
+    inline size_t SparseEnvBelief::compact(const std::uint32_t * envs, const double * probs, size_t n, double cutoff,
+					   std::uint32_t * outEnvs, double * outProbs, double & kept) {
+      size_t m = 0;
+      kept = 0.0;
+      for (size_t i = 0; i < n; ++i) {
+	if (probs[i] > 0.0 && probs[i] >= cutoff) {
+	  outEnvs[m] = envs[i];
+	  outProbs[m] = probs[i];
+	  kept += probs[i];
+	  ++m;
+	}
+      }
+      return m;
+    }
+
+    inline size_t SparseEnvBelief::update(const double * p, const std::uint32_t * envs, const double * probs, size_t n,
+					  std::uint32_t * outEnvs, double * outProbs, double threshold, double * dropped) {
+      if (dropped) *dropped = 0.0;
+      double nrm = Impl::BeliefKernel::multiplySum(p, probs, outProbs, n);
+      if (!(nrm > 0.0)) return 0;
+      // Zeros add nothing to the sums, so without pruning kept == nrm
+      // and the result matches the dense update bit for bit.
+      double kept;
+      size_t m = compact(envs, outProbs, n, threshold * nrm, outEnvs, outProbs, kept);
+      if (!m) {
+	// Everything is below the threshold: only keep the most likely environment.
+	size_t best = std::max_element(outProbs, outProbs + n) - outProbs;
+	outEnvs[0] = envs[best];
+	outProbs[0] = kept = outProbs[best];
+	m = 1;
+      }
+      if (dropped) *dropped = (nrm - kept) / nrm;
+      Impl::BeliefKernel::divide(outProbs, kept, m);
+      return m;
+    }
+
+    inline size_t SparseEnvBelief::prune(std::uint32_t * envs, double * probs, size_t n, double threshold, double * dropped) {
+      if (dropped) *dropped = 0.0;
+      if (!n) return 0;
+      double total = Impl::BeliefKernel::Scalar::sum(probs, n);
+      size_t best = std::max_element(probs, probs + n) - probs;
+      double cutoff = std::min(threshold * total, probs[best]);
+      double kept;
+      size_t m = compact(envs, probs, n, cutoff, envs, probs, kept);
+      if (kept != total) {
+	if (dropped) *dropped = (total - kept) / total;
+	Impl::BeliefKernel::divide(probs, kept, m);
+      }
+      return m;
+    }
+
+    template <typename G>
+    size_t SparseEnvBelief::sample(const std::uint32_t * envs, const double * probs, size_t n, G & rnd) {
+      // Same draw and walk as sampleProbability(), skipping the zeros.
+      std::uniform_real_distribution<double> sampleDistribution(0.0, 1.0);
+      double p = sampleDistribution(rnd);
+      for (size_t i = 0; i < n; ++i) {
+	if (probs[i] > p) return envs[i];
+	p -= probs[i];
+      }
+      return envs[n - 1];
+    }
+  }
+}
+
+#endif
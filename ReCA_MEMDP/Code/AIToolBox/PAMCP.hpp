@@ -4,9 +4,19 @@
 #include <AIToolbox/POMDP/Types.hpp>
 #include <AIToolbox/ProbabilityUtils.hpp>
 #include <AIToolbox/Impl/Seeder.hpp>
+#include <AIToolbox/Impl/ThreadPool.hpp>
+#include "EnvBelief.hpp"
+#include "SearchTree.hpp"
+#include "BeliefCache.hpp"
+#include "DecisionLog.hpp"
 
-#include <unordered_map>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
 
 namespace AIToolbox {
   namespace POMDP {
@@ -20,32 +30,27 @@ namespace AIToolbox {
     /**
      * @brief This class represents the POMCP optimized for our MEMDP model.
      *
+     * The search tree is stored in a SearchTree arena: nodes are
+     * referred to by index, re-rooting after a step only moves the root
+     * index, and dropping the tree between sessions is O(1).
      */
     template <typename M>
     class PAMCP<M> {
     public:
       using SampleBelief = std::vector<size_t>;
+      using NodeId = SearchTree::Id;
+      using ActionNode = SearchTree::ActionNode;
 
-      struct BeliefNode;
-      using BeliefNodes = std::unordered_map<size_t, BeliefNode>;
-
-      struct ActionNode {
-	BeliefNodes children;
-	double V = 0.0;
-	unsigned N = 0;
-      };
-      using ActionNodes = std::vector<ActionNode>;
-
-      struct BeliefNode {
-	BeliefNode() : obs(0), N(0) {}
-	BeliefNode(size_t o) : obs(o), N(0) {}
-	BeliefNode(size_t o, size_t s) : obs(o), smplbelief(1, s), N(0) {}
-	ActionNodes children;
-	SampleBelief smplbelief;
-	Belief envbelief;
-	size_t obs;
-	unsigned N;
-      };
+      /**
+       * @brief The ways the simulations of a single decision can be spread over threads.
+       *
+       * - None: all simulations run sequentially on the calling thread.
+       * - Root: each thread builds its own tree from the current root; the trees are
+       *   merged into the main one at the end of the decision.
+       * - Tree: all threads share the main tree, using virtual loss to keep them from
+       *   all exploring the same branch.
+       */
+      enum class Parallelism { None, Root, Tree };
 
       /**
        * @brief Basic constructor.
@@ -55,7 +60,7 @@ namespace AIToolbox {
        * @param beliefSize The size of the initial particle belief.
        * @param iterations The number of episodes to run before completion.
        * @param exp The exploration constant. This parameter is VERY important to determine the final POMCP performance.
-       * @param with_tree If True, maintain a past-aware search tree.
+       * @param with_tree If True, maintain a past-aware search tree: the tree grown from the start of a session is reused by the next one.
        * @param with_exact_belief If True, use exact belief computation instead of particles
        */
       PAMCP(const M& m, size_t beliefSize, unsigned iterations, double exp, bool with_tree=false, bool with_exact_belief=true);
@@ -98,6 +103,36 @@ namespace AIToolbox {
        */
       size_t sampleAction(size_t a, size_t o, unsigned horizon);
 
+      /**
+       * @brief This function is sampleAction(be, o, horizon, start_session) with a wall-clock budget.
+       *
+       * Simulations run until the budget expires, instead of for a
+       * fixed number of iterations. The clock is only read between
+       * batches of simulations, so the budget may be overrun by the
+       * duration of one batch; at least one batch is always run.
+       *
+       * @param be The initial belief online environment.
+       * @param o The initial observation / user history
+       * @param horizon The horizon to plan for.
+       * @param budget The time available for the decision.
+       * @param start_session Whether this is the first decision of a session.
+       *
+       * @return The best action, and the number of simulations completed.
+       */
+      std::pair<size_t, unsigned> sampleActionWithin(const Belief& be, size_t o, unsigned horizon, std::chrono::microseconds budget, bool start_session=false);
+
+      /**
+       * @brief This function is sampleAction(a, o, horizon) with a wall-clock budget.
+       *
+       * @param a The action taken in the last timestep.
+       * @param o The observation received in the last timestep.
+       * @param horizon The horizon to plan for.
+       * @param budget The time available for the decision.
+       *
+       * @return The best action, and the number of simulations completed.
+       */
+      std::pair<size_t, unsigned> sampleActionWithin(size_t a, size_t o, unsigned horizon, std::chrono::microseconds budget);
+
       /**
        * @brief This function sets the new size for initial beliefs created from sampleAction().
        *
@@ -116,6 +151,17 @@ namespace AIToolbox {
        */
       void setIterations(unsigned iter);
 
+      /**
+       * @brief This function sets a wall-clock budget for every call to sampleAction().
+       *
+       * While set, the number of iterations is ignored: each
+       * decision simulates until the budget expires, see
+       * sampleActionWithin().
+       *
+       * @param budget The time available per decision, zero to go back to a fixed number of iterations.
+       */
+      void setTimeBudget(std::chrono::microseconds budget);
+
       /**
        * @brief This function sets the new exploration constant for POMCP.
        *
@@ -129,6 +175,68 @@ namespace AIToolbox {
        */
       void setExploration(double exp);
 
+      /**
+       * @brief This function sets how the simulations of each decision are spread over threads.
+       *
+       * The number of simulations per decision is not changed: the
+       * iterations are split among the threads. Each thread uses its
+       * own random engine.
+       *
+       * @param mode The parallelization scheme.
+       * @param nThreads The number of threads to use, including the calling one.
+       * @param virtualLoss Penalty applied per pending simulation on an action in Tree mode. Negative values default to the exploration constant.
+       */
+      void setParallelism(Parallelism mode, size_t nThreads, double virtualLoss = -1.0);
+
+      /**
+       * @brief This function sets the size above which a past-aware tree is dropped at the start of a session.
+       *
+       * @param maxNodes The maximum number of belief nodes kept across sessions.
+       */
+      void setMaxNodes(size_t maxNodes);
+
+      /**
+       * @brief This function sets the number of exact belief updates memoized across simulations and sessions.
+       *
+       * Copies of this solver share the same cache.
+       *
+       * @param entries The maximum number of cached updates, 0 disables the cache.
+       */
+      void setBeliefCacheSize(size_t entries);
+
+      /**
+       * @brief This function sets the probability below which environments are dropped from exact beliefs.
+       *
+       * Pruned beliefs are renormalized over the remaining environments,
+       * which keeps the cost of the updates proportional to the number of
+       * environments still plausible. With 0, only environments ruled out
+       * by the observations are dropped and beliefs are exact.
+       *
+       * This resets the belief cache.
+       *
+       * @param threshold The pruning threshold, in [0, 1).
+       */
+      void setPruneThreshold(double threshold);
+
+      /**
+       * @brief This function reseeds the random engines of this solver.
+       *
+       * Worker engines used by parallel search are derived from the
+       * same seed, so that a reseeded solver replays the same searches.
+       *
+       * @param seed The new seed.
+       */
+      void setSeed(unsigned seed);
+
+      /**
+       * @brief This function sets where the measurements of each decision are written.
+       *
+       * Copies of this solver share the same log.
+       *
+       * @param log The log to write to, or nullptr to disable logging.
+       */
+      void setDecisionLog(std::shared_ptr<DecisionLog> log);
+
       /**
        * @brief This function returns the POMDP generative model being used.
        *
@@ -144,11 +252,52 @@ namespace AIToolbox {
       const std::vector<double> getEnvBelief() const;
 
       /**
-       * @brief This function returns a reference to the internal graph structure holding the results of rollouts.
+       * @brief This function returns the belief over environments at the current root, by its support.
+       *
+       * With particle beliefs, this is the frequency of each environment among the particles.
+       *
+       * @return The belief over environment
+       */
+      SparseEnvBelief getSparseEnvBelief() const;
+
+      /**
+       * @brief This function returns a reference to the internal tree holding the results of rollouts.
+       *
+       * @return The internal tree.
+       */
+      const SearchTree& getTree() const;
+
+      /**
+       * @brief This function returns the index of the current root in the internal tree.
+       *
+       * @return The current root.
+       */
+      NodeId getRoot() const;
+
+      /**
+       * @brief This function returns the statistics of an action at the current root.
+       *
+       * @param a The action.
+       *
+       * @return The root action node for a.
+       */
+      const ActionNode& getRootAction(size_t a) const;
+
+      /**
+       * @brief This function returns the exact belief update cache, e.g. to read its hit and miss counters.
+       *
+       * @return The cache shared by this solver and its copies.
+       */
+      const BeliefCache& getBeliefCache() const;
+
+      /**
+       * @brief This function returns the measurements of the last decision.
        *
-       * @return The internal graph.
+       * They are collected whether or not a DecisionLog is set.
+       *
+       * @return The statistics of the last call to sampleAction().
        */
-      const BeliefNode& getGraph() const;
+      const DecisionStats& getLastDecision() const;
 
       /**
        * @brief This function returns the initial particle size for converted Beliefs.
@@ -157,6 +306,13 @@ namespace AIToolbox {
        */
       size_t getBeliefSize() const;
 
+      /**
+       * @brief This function returns the pruning threshold of exact beliefs.
+       *
+       * @return The pruning threshold.
+       */
+      double getPruneThreshold() const;
+
       /**
        * @brief This function returns the number of iterations performed to plan for an action.
        *
@@ -164,6 +320,13 @@ namespace AIToolbox {
        */
       unsigned getIterations() const;
 
+      /**
+       * @brief This function returns the wall-clock budget per decision.
+       *
+       * @return The budget, zero if decisions use a fixed number of iterations.
+       */
+      std::chrono::microseconds getTimeBudget() const;
+
       /**
        * @brief This function returns the currently set exploration constant.
        *
@@ -171,17 +334,76 @@ namespace AIToolbox {
        */
       double getExploration() const;
 
+      /**
+       * @brief This function returns the current parallelization scheme.
+       *
+       * @return The parallelization scheme.
+       */
+      Parallelism getParallelism() const;
+
+      /**
+       * @brief This function returns the number of threads used per decision.
+       *
+       * @return The number of threads.
+       */
+      size_t getThreads() const;
+
     private:
+      /**
+       * @brief Striped mutexes protecting the nodes of a shared tree.
+       *
+       * Node locks are only ever held one at a time; the allocation
+       * lock may be taken while holding a node lock, never the reverse.
+       *
+       * Copies of the table get their own fresh mutexes, so that
+       * PAMCP can still be copied around by the evaluation routines.
+       */
+      class LockTable {
+      public:
+	LockTable(size_t n = 256) : locks_(n) {}
+	LockTable(const LockTable & other) : locks_(other.locks_.size()) {}
+	LockTable & operator=(const LockTable &) { return *this; }
+	std::mutex & get(NodeId b) { return locks_[b % locks_.size()]; }
+	std::mutex & allocator() { return allocator_; }
+      private:
+	std::vector<std::mutex> locks_;
+	std::mutex allocator_;
+      };
+
       const M& model_;
       size_t S, A, O, E, beliefSize_;
       unsigned iterations_, maxDepth_;
+      std::chrono::microseconds budget_;
+
+      // Simulations run between two reads of the clock under a time budget.
+      static constexpr unsigned BatchSize = 8;
       double exploration_;
 
-      BeliefNode graph_;
-      BeliefNode fullgraph_;
-      std::vector<std::pair<size_t, size_t> > history;
+      Parallelism parallelism_;
+      size_t nThreads_;
+      double virtualLoss_;
+      std::shared_ptr<Impl::ThreadPool> pool_;
+      std::vector<std::default_random_engine> workerRand_;
+      std::vector<SearchTree> workerTrees_;
+      LockTable locks_;
+
+      // Per-thread measurements of the current decision, merged into lastDecision_.
+      struct Counters {
+	size_t rolloutSteps = 0, cacheHits = 0, cacheMisses = 0, prunedEnvs = 0;
+	unsigned depth = 0;
+      };
+      std::vector<Counters> counters_;
+      DecisionStats lastDecision_;
+      std::shared_ptr<DecisionLog> log_;
+
+      SearchTree tree_;
+      NodeId root_;
+      NodeId sessionRoot_;
+      SampleBelief rootParticles_;
+      size_t maxNodes_;
+      std::shared_ptr<BeliefCache> beliefCache_;
+      double pruneThreshold_;
       bool reset_belief = true;
-      bool to_update;
       bool with_tree;
       bool with_exact_belief;
 
@@ -218,13 +440,21 @@ namespace AIToolbox {
        * update particle beliefs within the tree and the value
        * estimations for those beliefs.
        *
-       * @param b The tree node to simulate from.
+       * When the tree is shared between threads, every node is
+       * accessed under its lock from the LockTable, and the selected
+       * action carries a virtual loss until its value is backed up.
+       *
+       * @param t The tree to simulate in.
+       * @param b The tree node to simulate from, which must be expanded.
        * @param s The state from which we are simulating, possibly a particle of a previous particle belief.
        * @param horizon The depth within the tree already reached.
+       * @param rnd The random engine of the calling thread.
+       * @param c The measurements of the calling thread.
+       * @param shared Whether other threads are simulating in the same tree.
        *
        * @return The discounted reward obtained from the simulation performed from here to the end.
        */
-      double simulate(BeliefNode & b, size_t s, unsigned horizon);
+      double simulate(SearchTree & t, NodeId b, size_t s, unsigned horizon, std::default_random_engine & rnd, Counters & c, bool shared = false);
 
       /**
        * @brief This function implements the rollout policy for POMCP.
@@ -247,10 +477,69 @@ namespace AIToolbox {
        *
        * @param s The state from which to start the rollout.
        * @param horizon The horizon already reached while simulating inside the tree.
+       * @param rnd The random engine of the calling thread.
+       * @param c The measurements of the calling thread.
        *
        * @return An estimate return computed from simulating until max depth.
        */
-      double rollout(size_t s, unsigned horizon);
+      double rollout(size_t s, unsigned horizon, std::default_random_engine & rnd, Counters & c);
+
+      /**
+       * @brief This function samples a state from the belief at the current root.
+       *
+       * @param rnd The random engine of the calling thread.
+       *
+       * @return A state sampled from the root belief.
+       */
+      size_t sampleRootState(std::default_random_engine & rnd) const;
+
+      /**
+       * @brief This function replaces the root with a new node for the given belief.
+       *
+       * @param be The belief over environments.
+       * @param o The observation of the root.
+       */
+      void resetRoot(const Belief & be, size_t o);
+
+      /**
+       * @brief This function runs the simulations of a decision in parallel.
+       *
+       * @param deadline When to stop simulating, if running under a time budget.
+       *
+       * @return The number of simulations completed.
+       */
+      unsigned runParallelSimulation(std::chrono::steady_clock::time_point deadline);
+
+      /**
+       * @brief This function gathers the measurements of the decision just taken, and logs them.
+       *
+       * @param start The time the simulations started.
+       * @param nodes The size of the main tree before the simulations.
+       * @param simulations The number of simulations completed.
+       * @param action The action returned.
+       */
+      void recordDecision(std::chrono::steady_clock::time_point start, size_t nodes, unsigned simulations, size_t action);
+
+      /**
+       * @brief This function merges the statistics of a subtree into another.
+       *
+       * Action values are averaged weighted by their counts, and
+       * subtrees missing from dst are copied over from src.
+       *
+       * @param dst The tree receiving the statistics.
+       * @param d The node of dst to merge into.
+       * @param src The tree to merge from.
+       * @param s The node of src to merge.
+       * @param root Whether the two nodes are roots, which already share the same belief.
+       */
+      void mergeTree(SearchTree & dst, NodeId d, const SearchTree & src, NodeId s, bool root) const;
+
+      /**
+       * @brief This function copies a subtree of src into dst.
+       *
+       * @return The index of the copy of s in dst.
+       */
+      NodeId copyTree(SearchTree & dst, const SearchTree & src, NodeId s) const;
 
 
       /**
@@ -263,7 +552,7 @@ namespace AIToolbox {
        * @return The iterator to the ActionNode with the best value.
        */
       template <typename Iterator>
-      Iterator findBestA(Iterator begin, Iterator end);
+      Iterator findBestA(Iterator begin, Iterator end) const;
 
       /**
        * @brief This function finds the best action based on UCT.
@@ -292,176 +581,323 @@ namespace AIToolbox {
        * @return A particle belief approximating the input belief.
        */
       SampleBelief makeSampledBelief(const Belief & b, size_t o);
-
-      /**
-       * @brief This function updates the full graph with the current state of the simulation.
-       * More precisely, the last branch/actionNode corresponding to the current history is
-       * replaced by the currently build tree.
-       *
-       * @param current The subtree computed for action a.
-       * @param a The last action taken in the simulation.
-       */
-      //void update_fullgraph(ActionNode current, size_t a);
-      void update_fullgraph(BeliefNode current, size_t a);
     };
 
     template <typename M>
-    PAMCP<M>::PAMCP(const M& m, size_t beliefSize, unsigned iter, double exp, bool with_tree_/*=false*/, bool with_exact_belief_/*=true*/) : model_(m), S(model_.getS()), A(model_.getA()), O(model_.getO()), E(model_.getE()), beliefSize_(beliefSize), iterations_(iter), exploration_(exp), graph_(), with_tree(with_tree_), with_exact_belief(with_exact_belief_), rand_(Impl::Seeder::getSeed()) {}
+    PAMCP<M>::PAMCP(const M& m, size_t beliefSize, unsigned iter, double exp, bool with_tree_/*=false*/, bool with_exact_belief_/*=true*/) : model_(m), S(model_.getS()), A(model_.getA()), O(model_.getO()), E(model_.getE()), beliefSize_(beliefSize), iterations_(iter), budget_(0), exploration_(exp), parallelism_(Parallelism::None), nThreads_(1), virtualLoss_(exp), counters_(1), tree_(A, E), root_(SearchTree::None), sessionRoot_(SearchTree::None), maxNodes_(1 << 20), beliefCache_(std::make_shared<BeliefCache>(E, 1 << 16)), pruneThreshold_(0.0), with_tree(with_tree_), with_exact_belief(with_exact_belief_), rand_(Impl::Seeder::getSeed()) {}
 
     template <typename M>
     size_t PAMCP<M>::sampleAction(const Belief& be, size_t o, unsigned horizon, bool start_session /* false */) {
-      // Reset graph initially or with new belief (e.g. observation missing)
-      if (reset_belief || ! with_tree) {
-	graph_ = BeliefNode(o);
-	graph_.children.resize(A);
+      // Past-aware mode: a new session restarts from the tree grown during the
+      // previous ones, unless we lost track of the belief or it got too large.
+      if (with_tree && start_session && !reset_belief && sessionRoot_ != SearchTree::None
+	  && tree_.node(sessionRoot_).obs == o && tree_.size() <= maxNodes_) {
+	root_ = sessionRoot_;
+	if (with_exact_belief) {
+	  SparseEnvBelief eb(be, E, pruneThreshold_);
+	  tree_.setBelief(root_, eb.envs(), eb.probs(), eb.size());
+	} else {
+	  rootParticles_ = makeSampledBelief(be, o);
+	}
+      } else {
+	// Without tree reuse, or when starting over, drop everything in O(1)
+	if (!with_tree || start_session) tree_.clear();
+	resetRoot(be, o);
 	reset_belief = false;
       }
-      // Reset with the stored information
-      else {
-	graph_ = fullgraph_;
-      }
-      
-      // Initialize full graph
-      if (with_tree && start_session && history.size() == 0) {
-	fullgraph_ = BeliefNode(o);
-	fullgraph_.children.resize(A);
-      }
 
-      // Clear history if beginning
-      if (with_tree && start_session) {
-	history.clear();
-	to_update = true;
-      }
-
-      // Init the env belief
-      if (with_exact_belief) {
-	graph_.envbelief = be;
-      } else {	
-	graph_.smplbelief = makeSampledBelief(be, o);
-      }
+      if (with_tree && start_session)
+	sessionRoot_ = root_;
 
       return runSimulation(horizon);
     }
 
     template <typename M>
-    size_t PAMCP<M>::sampleAction(size_t a, size_t o, unsigned horizon) {
-      // Update full graph
-      if (with_tree && to_update) {
-	update_fullgraph(graph_, a);
-	history.push_back(std::make_pair(a, o));
-      }
+    std::pair<size_t, unsigned> PAMCP<M>::sampleActionWithin(const Belief& be, size_t o, unsigned horizon, std::chrono::microseconds budget, bool start_session /* false */) {
+      auto previous = budget_;
+      budget_ = budget;
+      size_t action = sampleAction(be, o, horizon, start_session);
+      budget_ = previous;
+      return std::make_pair(action, lastDecision_.simulations);
+    }
+
+    template <typename M>
+    std::pair<size_t, unsigned> PAMCP<M>::sampleActionWithin(size_t a, size_t o, unsigned horizon, std::chrono::microseconds budget) {
+      auto previous = budget_;
+      budget_ = budget;
+      size_t action = sampleAction(a, o, horizon);
+      budget_ = previous;
+      return std::make_pair(action, lastDecision_.simulations);
+    }
 
-      // Run simulation
-      auto & obs = graph_.children[a].children;
+    template <typename M>
+    void PAMCP<M>::resetRoot(const Belief & be, size_t o) {
+      root_ = tree_.addNode(o);
+      tree_.expand(root_);
+      if (with_exact_belief) {
+	SparseEnvBelief eb(be, E, pruneThreshold_);
+	tree_.setBelief(root_, eb.envs(), eb.probs(), eb.size());
+      } else {
+	rootParticles_ = makeSampledBelief(be, o);
+      }
+    }
 
-      auto it = obs.find(o);
-      if ( it == obs.end() ) {
+    template <typename M>
+    size_t PAMCP<M>::sampleAction(size_t a, size_t o, unsigned horizon) {
+      NodeId next = tree_.findChild(root_, a, o);
+      if ( next == SearchTree::None ) {
 	std::cerr << "\nObservation " << o << " never experienced in simulation, restarting belief from " << o << "\n";
 	auto b = Belief(E); b.fill(1.0 / E);
 	reset_belief = true;
-	to_update = false; // stop retaining information in case of failure
 	return sampleAction(b, o, horizon, false);
       }
 
-      // Here we need an additional step, because *it is contained by graph_.
-      // If we just move assign, graph_ is first going to delete everything it
-      // contains (included *it), and then we are going to move unallocated memory
-      // into graph_! So we move *it outside of the graph_ hierarchy, so that
-      // we can then assign safely.
-      { auto tmp = std::move(it->second); graph_ = std::move(tmp); }
+      // Re-rooting only moves the root index: the rest of the tree stays
+      // in the arena, where a past-aware search can find it again.
+      root_ = next;
+      if (!with_exact_belief)
+	tree_.getParticles(root_, rootParticles_);
 
-      if ( (with_exact_belief && ! graph_.envbelief.size()) || (! with_exact_belief && ! graph_.smplbelief.size()) ) {
+      if ( (with_exact_belief && ! tree_.hasBelief(root_)) || (! with_exact_belief && ! rootParticles_.size()) ) {
 	std::cerr << "POMCP Lost track of the belief, restarting with uniform..\n";
 	auto b = Belief(E); b.fill(1.0 / E);
 	reset_belief = true;
-	to_update = false;
 	return sampleAction(b, o, horizon);
       }
 
-      // We resize here in case we didn't have time to sample the new
+      // We expand here in case we didn't have time to sample the new
       // head node. In this case, the new head may not have children.
       // This would break the UCT call.
-      graph_.children.resize(A);
+      tree_.expand(root_);
 
       return runSimulation(horizon);
     }
 
-
     template <typename M>
+    size_t PAMCP<M>::runSimulation(unsigned horizon) {
+      if ( !horizon ) {
+	lastDecision_ = DecisionStats();
+	return 0;
+      }
+      maxDepth_ = horizon;
+      auto start = std::chrono::steady_clock::now();
+      auto deadline = start + budget_;
+      size_t nodes = tree_.size();
+      unsigned sims = 0;
+      for (auto & c : counters_) c = Counters();
+
+      if (parallelism_ != Parallelism::None && nThreads_ > 1)
+	sims = runParallelSimulation(deadline);
+      else if (budget_.count() == 0)
+	for ( ; sims < iterations_; ++sims )
+	  simulate(tree_, root_, sampleRootState(rand_), 0, rand_, counters_[0]);
+      else
+	do {
+	  for (unsigned i = 0; i < BatchSize; ++i, ++sims)
+	    simulate(tree_, root_, sampleRootState(rand_), 0, rand_, counters_[0]);
+	} while (std::chrono::steady_clock::now() < deadline);
+
+      auto begin = tree_.actions(root_);
+      size_t action = std::distance(begin, findBestA(begin, begin + A));
+      recordDecision(start, nodes, sims, action);
+      return action;
+    }
 
-    void PAMCP<M>::update_fullgraph(BeliefNode current, size_t a) {
-      auto & current_branch = fullgraph_;
-      // Browse history
-      for (auto it = history.begin(); it != history.end(); ++it) {
-	auto  an = current_branch.children[std::get<0>(*it)];
-	current_branch = an.children[std::get<1>(*it)];
+    template <typename M>
+    void PAMCP<M>::recordDecision(std::chrono::steady_clock::time_point start, size_t nodes, unsigned simulations, size_t action) {
+      DecisionStats & d = lastDecision_;
+      d = DecisionStats();
+      d.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      d.simulations = simulations;
+      d.nodes = tree_.size() - nodes;
+      d.action = action;
+      for (auto & c : counters_) {
+	d.depth = std::max(d.depth, c.depth);
+	d.cacheHits += c.cacheHits;
+	d.cacheMisses += c.cacheMisses;
+	d.rolloutSteps += c.rolloutSteps;
+	d.prunedEnvs += c.prunedEnvs;
       }
-      // Modify
-      current_branch = current;
+      if (log_)
+	log_->write(with_tree ? (with_exact_belief ? "pamcpex" : "pamcp") : (with_exact_belief ? "pomcpex" : "pomcp"), d);
     }
 
+    template <typename M>
+    unsigned PAMCP<M>::runParallelSimulation(std::chrono::steady_clock::time_point deadline) {
+      std::vector<Impl::ThreadPool::Task> tasks;
+      tasks.reserve(nThreads_);
+      // Root parallelism: worker 0 grows the main tree, the others
+      // start from a copy of the root in their own tree.
+      std::vector<NodeId> roots(nThreads_, root_);
+      std::vector<unsigned> done(nThreads_, 0);
+      if (parallelism_ == Parallelism::Root) {
+	for (size_t w = 1; w < nThreads_; ++w) {
+	  auto & t = workerTrees_[w - 1];
+	  t.clear();
+	  roots[w] = t.addNode(tree_.node(root_).obs);
+	  t.expand(roots[w]);
+	  if (with_exact_belief)
+	    t.setBelief(roots[w], tree_.beliefEnvs(root_), tree_.beliefProbs(root_), tree_.support(root_));
+	}
+      }
+
+      for (size_t w = 0; w < nThreads_; ++w) {
+	unsigned iters = iterations_ / nThreads_ + (w < iterations_ % nThreads_ ? 1 : 0);
+	bool shared = parallelism_ == Parallelism::Tree;
+	SearchTree * t = (shared || w == 0) ? &tree_ : &workerTrees_[w - 1];
+	NodeId root = roots[w];
+	std::default_random_engine * rnd = &workerRand_[w];
+	Counters * c = &counters_[w];
+	unsigned * sims = &done[w];
+	bool timed = budget_.count() != 0;
+	tasks.emplace_back([this, iters, shared, t, root, rnd, c, sims, timed, deadline]{
+	    if (!timed) {
+	      for ( ; *sims < iters; ++*sims)
+		simulate(*t, root, sampleRootState(*rnd), 0, *rnd, *c, shared);
+	      return;
+	    }
+	    do {
+	      for (unsigned i = 0; i < BatchSize; ++i, ++*sims)
+		simulate(*t, root, sampleRootState(*rnd), 0, *rnd, *c, shared);
+	    } while (std::chrono::steady_clock::now() < deadline);
+	  });
+      }
+      pool_->run(tasks);
 
+      if (parallelism_ == Parallelism::Root)
+	for (size_t w = 1; w < nThreads_; ++w)
+	  mergeTree(tree_, root_, workerTrees_[w - 1], roots[w], true);
+
+      unsigned sims = 0;
+      for (auto d : done) sims += d;
+      return sims;
+    }
 
     template <typename M>
-    size_t PAMCP<M>::runSimulation(unsigned horizon) {
-      if ( !horizon ) return 0;
-      maxDepth_ = horizon;
-      
-      if (with_exact_belief) {
-	for (unsigned i = 0; i < iterations_; ++i )
-	  simulate(graph_, O *  sampleProbability(E, graph_.envbelief, rand_) + graph_.obs, 0);
-      } else {
-	std::uniform_int_distribution<size_t> generator(0, graph_.smplbelief.size() - 1);
-	for (unsigned i = 0; i < iterations_; ++i )
-	  simulate(graph_, graph_.smplbelief.at(generator(rand_)), 0);
+    size_t PAMCP<M>::sampleRootState(std::default_random_engine & rnd) const {
+      if (with_exact_belief)
+	return O * SparseEnvBelief::sample(tree_.beliefEnvs(root_), tree_.beliefProbs(root_), tree_.support(root_), rnd) + tree_.node(root_).obs;
+      std::uniform_int_distribution<size_t> generator(0, rootParticles_.size() - 1);
+      return rootParticles_[generator(rnd)];
+    }
+
+    template <typename M>
+    void PAMCP<M>::mergeTree(SearchTree & dst, NodeId d, const SearchTree & src, NodeId s, bool root) const {
+      dst.node(d).N += src.node(s).N;
+      if (!root && !with_exact_belief) {
+	SampleBelief particles;
+	src.getParticles(s, particles);
+	for (auto p : particles) dst.addParticle(d, p);
       }
+      if (!src.isExpanded(s)) return;
+      dst.expand(d);
+
+      for (size_t a = 0; a < A; ++a) {
+	auto & dn = dst.action(d, a);
+	auto & sn = src.action(s, a);
+	if (sn.N) {
+	  unsigned total = dn.N + sn.N;
+	  dn.V = (dn.V * dn.N + sn.V * sn.N) / static_cast<double>(total);
+	  dn.N = total;
+	}
+	src.forEachChild(s, a, [&](size_t o, NodeId child) {
+	    NodeId it = dst.findChild(d, a, o);
+	    if (it == SearchTree::None)
+	      dst.link(d, a, o, copyTree(dst, src, child));
+	    else
+	      mergeTree(dst, it, src, child, false);
+	  });
+      }
+    }
 
-      auto begin = std::begin(graph_.children);
-      return std::distance(begin, findBestA(begin, std::end(graph_.children)));
+    template <typename M>
+    typename PAMCP<M>::NodeId PAMCP<M>::copyTree(SearchTree & dst, const SearchTree & src, NodeId s) const {
+      NodeId d = dst.addNode(src.node(s).obs);
+      dst.node(d).N = src.node(s).N;
+      if (src.hasBelief(s))
+	dst.setBelief(d, src.beliefEnvs(s), src.beliefProbs(s), src.support(s));
+      if (src.node(s).nParticles) {
+	SampleBelief particles;
+	src.getParticles(s, particles);
+	for (auto p : particles) dst.addParticle(d, p);
+      }
+      if (!src.isExpanded(s)) return d;
+      dst.expand(d);
+
+      for (size_t a = 0; a < A; ++a) {
+	auto & dn = dst.action(d, a);
+	dn.V = src.action(s, a).V;
+	dn.N = src.action(s, a).N;
+	src.forEachChild(s, a, [&](size_t o, NodeId child) {
+	    dst.link(d, a, o, copyTree(dst, src, child));
+	  });
+      }
+      return d;
     }
 
     template <typename M>
-    double PAMCP<M>::simulate(BeliefNode & b, size_t s, unsigned depth) {
-      b.N++;
-      auto begin = std::begin(b.children);
-      size_t a = std::distance(begin, findBestBonusA(begin, std::end(b.children), b.N));
+    double PAMCP<M>::simulate(SearchTree & t, NodeId b, size_t s, unsigned depth, std::default_random_engine & rnd, Counters & c, bool shared /* = false */) {
+      // In shared mode we never hold more than one node lock at a time.
+      std::unique_lock<std::mutex> lock;
+      if (shared) lock = std::unique_lock<std::mutex>(locks_.get(b));
+      c.depth = std::max(c.depth, depth);
+
+      t.node(b).N++;
+      auto begin = t.actions(b);
+      size_t a = std::distance(begin, findBestBonusA(begin, begin + A, t.node(b).N));
+      auto & aNode = begin[a];
+      if (shared) {
+	aNode.pending++;
+	lock.unlock();
+      }
 
       size_t s1, o; double rew;
-      std::tie(s1, o, rew) = model_.sampleSOR(s, a);
-      auto & aNode = b.children[a];
+      std::tie(s1, o, rew) = model_.sampleSOR(s, a, rnd);
       {
 	double futureRew = 0.0;
+	bool expanded = false;
+	NodeId next = SearchTree::None;
+
+	if (shared) lock.lock();
+	// Nodes only allocate while holding the allocation lock, which
+	// keeps the arenas consistent between threads.
+	std::unique_lock<std::mutex> alloc(locks_.allocator(), std::defer_lock);
+	if (shared) alloc.lock();
 	// We need to append the node anyway to perform the belief
 	// update for the next timestep.
-	auto ot = aNode.children.find(o);
-	if ((ot == std::end(aNode.children))) {
+	NodeId ot = t.findChild(b, a, o);
+	if (ot == SearchTree::None) {
+	  NodeId child = t.addChild(b, a, o);
 	  if (with_exact_belief) {
-	    aNode.children.emplace(std::piecewise_construct,
-				   std::forward_as_tuple(o),
-				   std::forward_as_tuple(o));
-	    // Update the envbelief of the newly created node
-	    double nrm = 0;
-	    aNode.children[o].envbelief.resize(E);
-	    for (int i = 0; i < E; i++) {
-	      aNode.children[o].envbelief(i) = b.envbelief(i) * model_.getTransitionProbability(i * O + b.obs, a, i * O + o);
-	      nrm += aNode.children[o].envbelief(i);
-	    }
-	    for (int i = 0; i < E; i++) {
-	      aNode.children[o].envbelief(i) /= nrm;
+	    // Update the envbelief of the newly created node. Its support
+	    // is a subset of the parent's, so that much room is enough.
+	    size_t n = t.support(b), pobs = t.node(b).obs;
+	    t.allocateBelief(child, n);
+	    const uint32_t * pe = t.beliefEnvs(b);
+	    const double * pb = t.beliefProbs(b);
+	    uint32_t * ce = t.beliefEnvs(child);
+	    double * cb = t.beliefProbs(child);
+	    size_t m = beliefCache_->lookup(pobs, a, o, pe, pb, n, ce, cb);
+	    if (m) {
+	      c.cacheHits++;
+	    } else {
+	      c.cacheMisses++;
+	      // The child belief doubles as buffer for the transitions of the support
+	      model_.environment_transitions(pobs, a, o, pe, n, cb);
+	      m = SparseEnvBelief::update(cb, pe, pb, n, ce, cb, pruneThreshold_);
+	      beliefCache_->insert(pobs, a, o, pe, pb, n, ce, cb, m);
 	    }
+	    c.prunedEnvs += n - m;
+	    t.setSupport(child, m);
 	  } else {
-	    aNode.children.emplace(std::piecewise_construct,
-				   std::forward_as_tuple(o),
-				   std::forward_as_tuple(o, s1));
+	    t.addParticle(child, s1);
 	  }
-
-	  // get the reward
-	  // This stops automatically if we go out of depth
-	  futureRew = rollout(s, depth + 1);
+	  expanded = true;
+	  c.depth = std::max(c.depth, depth + 1);
 	}
 	else {
 	  if (!with_exact_belief)
-	    ot->second.smplbelief.push_back(s1);
+	    t.addParticle(ot, s1);
 	  // We only go deeper if needed (maxDepth_ is always at least 1).
 	  if ( depth + 1 < maxDepth_ && !model_.isTerminal(s1) ) {
 	    // Since most memory is allocated on the leaves,
@@ -469,15 +905,30 @@ namespace AIToolbox {
 	    // we are actually descending into a node. If the node
 	    // already has memory this should not do anything in
 	    // any case.
-	    ot->second.children.resize(A);
-	    futureRew = simulate( ot->second, s1, depth + 1 );
+	    t.expand(ot);
+	    next = ot;
 	  }
 	}
+	if (shared) {
+	  alloc.unlock();
+	  lock.unlock();
+	}
+
+	// get the reward
+	// This stops automatically if we go out of depth
+	if (expanded)
+	  futureRew = rollout(s, depth + 1, rnd, c);
+	else if (next != SearchTree::None)
+	  futureRew = simulate( t, next, s1, depth + 1, rnd, c, shared );
 
 	rew += model_.getDiscount() * futureRew;
       }
 
       // Action update
+      if (shared) {
+	lock.lock();
+	aNode.pending--;
+      }
       aNode.N++;
       aNode.V += ( rew - aNode.V ) / static_cast<double>(aNode.N);
 
@@ -485,22 +936,23 @@ namespace AIToolbox {
     }
 
     template <typename M>
-    double PAMCP<M>::rollout(size_t s, unsigned depth) {
+    double PAMCP<M>::rollout(size_t s, unsigned depth, std::default_random_engine & rnd, Counters & c) {
       double rew = 0.0, totalRew = 0.0, gamma = 1.0;
 
       std::uniform_int_distribution<size_t> generator(0, A-1);
       for ( ; depth < maxDepth_; ++depth ) {
-	std::tie( s, rew ) = model_.sampleSR( s, generator(rand_) );
+	std::tie( s, rew ) = model_.sampleSR( s, generator(rnd), rnd );
 
 	totalRew += gamma * rew;
 	gamma *= model_.getDiscount();
+	c.rolloutSteps++;
       }
       return totalRew;
     }
 
     template <typename M>
     template <typename Iterator>
-    Iterator PAMCP<M>::findBestA(Iterator begin, Iterator end) {
+    Iterator PAMCP<M>::findBestA(Iterator begin, Iterator end) const {
       return std::max_element(begin, end, [](const ActionNode & lhs, const ActionNode & rhs){ return lhs.V < rhs.V; });
     }
 
@@ -513,7 +965,11 @@ namespace AIToolbox {
       // We use this function to produce a score for each action. This can be easily
       // substituted with something else to produce different POMCP variants.
       auto evaluationFunction = [this, logCount](const ActionNode & an){
-	return an.V + exploration_ * std::sqrt( logCount / an.N );
+	if ( !an.pending )
+	  return an.V + exploration_ * std::sqrt( logCount / an.N );
+	// Virtual loss: count pending simulations as visits which lost virtualLoss_.
+	double n = an.N + an.pending;
+	return ( an.V * an.N - virtualLoss_ * an.pending ) / n + exploration_ * std::sqrt( logCount / n );
       };
 
       auto bestIterator = begin++;
@@ -556,6 +1012,59 @@ namespace AIToolbox {
       exploration_ = exp;
     }
 
+    template <typename M>
+    void PAMCP<M>::setParallelism(Parallelism mode, size_t nThreads, double virtualLoss /* = -1.0 */) {
+      parallelism_ = mode;
+      nThreads_ = std::max<size_t>(nThreads, 1);
+      virtualLoss_ = ((virtualLoss < 0) ? exploration_ : virtualLoss);
+      if (!pool_ || pool_->size() != nThreads_)
+	pool_ = std::make_shared<Impl::ThreadPool>(nThreads_);
+      workerRand_.clear();
+      for (size_t w = 0; w < nThreads_; ++w)
+	workerRand_.emplace_back(Impl::Seeder::getSeed());
+      counters_.assign(nThreads_, Counters());
+      workerTrees_.clear();
+      if (parallelism_ == Parallelism::Root)
+	workerTrees_.resize(nThreads_ - 1, SearchTree(A, E));
+    }
+
+    template <typename M>
+    void PAMCP<M>::setSeed(unsigned seed) {
+      rand_.seed(seed);
+      std::seed_seq seq{seed, static_cast<unsigned>(workerRand_.size())};
+      std::vector<unsigned> seeds(workerRand_.size());
+      seq.generate(seeds.begin(), seeds.end());
+      for (size_t w = 0; w < workerRand_.size(); ++w)
+	workerRand_[w].seed(seeds[w]);
+    }
+
+    template <typename M>
+    void PAMCP<M>::setTimeBudget(std::chrono::microseconds budget) {
+      budget_ = budget;
+    }
+
+    template <typename M>
+    void PAMCP<M>::setDecisionLog(std::shared_ptr<DecisionLog> log) {
+      log_ = log;
+    }
+
+    template <typename M>
+    void PAMCP<M>::setMaxNodes(size_t maxNodes) {
+      maxNodes_ = maxNodes;
+    }
+
+    template <typename M>
+    void PAMCP<M>::setBeliefCacheSize(size_t entries) {
+      beliefCache_ = std::make_shared<BeliefCache>(E, entries);
+    }
+
+    template <typename M>
+    void PAMCP<M>::setPruneThreshold(double threshold) {
+      pruneThreshold_ = threshold;
+      // Cached updates were pruned with the previous threshold
+      beliefCache_ = std::make_shared<BeliefCache>(E, beliefCache_->getCapacity());
+    }
+
     template <typename M>
     const M& PAMCP<M>::getModel() const {
       return model_;
@@ -565,11 +1074,13 @@ namespace AIToolbox {
     const std::vector<double> PAMCP<M>::getEnvBelief() const {
       std::vector<double> scores(E);
       if (with_exact_belief) {
-	for (int i = 0; i < E; i++) {
-	  scores.at(i) = graph_.envbelief(i);
+	const uint32_t * envs = tree_.beliefEnvs(root_);
+	const double * eb = tree_.beliefProbs(root_);
+	for (size_t i = 0; i < tree_.support(root_); i++) {
+	  scores.at(envs[i]) = eb[i];
 	}
       } else {
-	for (auto it = begin(graph_.smplbelief); it != end(graph_.smplbelief); ++it) {
+	for (auto it = begin(rootParticles_); it != end(rootParticles_); ++it) {
 	  scores.at(model_.get_env(*it))++;
 	}
       }
@@ -577,8 +1088,42 @@ namespace AIToolbox {
     }
 
     template <typename M>
-    const typename PAMCP<M>::BeliefNode& PAMCP<M>::getGraph() const {
-      return graph_;
+    SparseEnvBelief PAMCP<M>::getSparseEnvBelief() const {
+      if (with_exact_belief)
+	return SparseEnvBelief(tree_.beliefEnvs(root_), tree_.beliefProbs(root_), tree_.support(root_));
+      std::vector<double> counts = getEnvBelief();
+      for (auto & c : counts) c /= rootParticles_.size();
+      return SparseEnvBelief(counts, E);
+    }
+
+    template <typename M>
+    const SearchTree& PAMCP<M>::getTree() const {
+      return tree_;
+    }
+
+    template <typename M>
+    typename PAMCP<M>::NodeId PAMCP<M>::getRoot() const {
+      return root_;
+    }
+
+    template <typename M>
+    const typename PAMCP<M>::ActionNode& PAMCP<M>::getRootAction(size_t a) const {
+      return tree_.action(root_, a);
+    }
+
+    template <typename M>
+    const BeliefCache& PAMCP<M>::getBeliefCache() const {
+      return *beliefCache_;
+    }
+
+    template <typename M>
+    std::chrono::microseconds PAMCP<M>::getTimeBudget() const {
+      return budget_;
+    }
+
+    template <typename M>
+    const DecisionStats& PAMCP<M>::getLastDecision() const {
+      return lastDecision_;
     }
 
     template <typename M>
@@ -586,6 +1131,11 @@ namespace AIToolbox {
       return beliefSize_;
     }
 
+    template <typename M>
+    double PAMCP<M>::getPruneThreshold() const {
+      return pruneThreshold_;
+    }
+
     template <typename M>
     unsigned PAMCP<M>::getIterations() const {
       return iterations_;
@@ -595,6 +1145,16 @@ namespace AIToolbox {
     double PAMCP<M>::getExploration() const {
       return exploration_;
     }
+
+    template <typename M>
+    typename PAMCP<M>::Parallelism PAMCP<M>::getParallelism() const {
+      return parallelism_;
+    }
+
+    template <typename M>
+    size_t PAMCP<M>::getThreads() const {
+      return nThreads_;
+    }
   }
 }
 
@@ -3,8 +3,14 @@
 
 #include <AIToolbox/POMDP/Types.hpp>
 #include <AIToolbox/POMDP/Utils.hpp>
+#include <AIToolbox/Impl/ThreadPool.hpp>
 #include "BeliefGenerator.hpp"
-#include "Projecter.hpp"
+#include "BlockProjecter.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <numeric>
 
 namespace AIToolbox {
   namespace POMDP {
@@ -41,6 +47,15 @@ namespace AIToolbox {
      */
     class PBVI {
     public:
+      /**
+       * @brief What to keep of the horizons older than the last two, which are not needed to go on.
+       */
+      enum class Memory {
+	Full,    // Every horizon, with its values
+	Graph,   // Only the actions and observation links, as a policy graph (see BlockVList::dropValues)
+	Last     // Nothing: older horizons are returned empty
+      };
+
       /**
        * @brief Basic constructor.
        *
@@ -100,37 +115,94 @@ namespace AIToolbox {
        * here), then the solution for h will not be optimal by
        * definition.
        *
+       * The ValueFunction is stored by observation blocks (see
+       * BlockVList), and only the beliefs concentrated on a single
+       * observation are kept as support beliefs, since these are the
+       * only ones reachable in a MEMDP.
+       *
+       * Memory grows with the horizon, unless the older horizons are
+       * reduced to their policy graph or dropped as they are no longer
+       * needed, in which case only the last two are ever fully stored.
+       *
        * @tparam M The type of POMDP model that needs to be solved.
        *
        * @param model The POMDP model that needs to be solved.
+       * @param threads The number of threads to use, including the calling one.
+       * @param memory What to keep of the older horizons.
        *
-       * @return True, and the computed ValueFunction up to the requested horizon, as well as the maximal timestep that allows convergence.
+       * @return True, and the computed BlockValueFunction up to the requested horizon, as well as the maximal timestep that allows convergence.
        */
       template <typename M, typename std::enable_if<is_model<M>::value, int>::type = 0>
-      std::tuple<bool, ValueFunction, int> operator()(const M & model);
+      std::tuple<bool, BlockValueFunction, int> operator()(const M & model, size_t threads = 1, Memory memory = Memory::Full);
 
     private:
+      // An alpha vector of the cross-sum of an action, built for a belief.
+      struct Candidate {
+	size_t action;
+	std::vector<std::uint32_t> choices;    // (observation, block) pairs, for the blocks other than the first one
+	std::vector<std::uint32_t> blockObs;   // Observations whose block depends on the choices, in increasing order
+	std::vector<double> blockValues;       // Their blocks. The others are those of the cross-sum of the first blocks
+      };
+
       /**
-       * @brief This function computes a VList composed the maximized cross-sums with respect to the provided beliefs.
-       *
-       * This function performs the job of accumulating the
-       * information required to obtain the final policy. It
-       * processes an action at a time.
+       * @brief This function computes the maximized cross-sums of an action with respect to a range of beliefs.
        *
-       * For each belief contained in the argument BeliefList, it
-       * will create the optimal VEntry by cherry picking the best
-       * projections for each observation. Finally it prunes the
-       * resulting VList by removing duplicates.
+       * For each belief, it picks the best projected block of each
+       * observation following the belief's one, and computes the
+       * blocks of the resulting alpha vector which differ from the
+       * cross-sum of the first blocks of w.
        *
-       * @param ProjectionsRow The type containing the projections to process.
-       * @param projs A 1d container containing O elements: each a VList of projections for the respective observation.
+       * @param model The model being solved.
+       * @param projecter The projecter of the model.
+       * @param w The list of the previous horizon.
        * @param a The action that this cross-sum is about.
-       * @param bl The beliefs for which we are trying to find VEntries.
+       * @param bObs The observation of each belief.
+       * @param bEnv The E probabilities of each belief.
+       * @param begin The first belief to process.
+       * @param end The end of the range of beliefs to process.
+       * @param result Where to write the Candidate of each belief, indexed as the beliefs.
+       */
+      template <typename M>
+      void crossSum(const M & model, const BlockProjecter<M> & projecter, const BlockVList & w, size_t a,
+		    const std::vector<size_t> & bObs, const std::vector<double> & bEnv, size_t begin, size_t end, Candidate * result) const;
+
+      /**
+       * @brief This function ranks the candidates in lexicographic order of their full vectors.
+       *
+       * Equal vectors get the same rank, so that ties between candidates
+       * can then be broken in constant time.
        *
-       * @return The optimal cross-sum list for the given projections and BeliefList.
+       * @param candidates The candidates to rank.
+       * @param defaults The blocks of the cross-sum of the first blocks, O for each action.
+       * @param E The number of environments.
+       *
+       * @return The rank of each candidate.
        */
-      template <typename ProjectionsRow, typename M>
-      VList crossSum(const ProjectionsRow & projs, size_t a, const std::vector<Belief> & bl, MDP::Values irw, const M & model_);
+      std::vector<size_t> rankCandidates(const std::vector<Candidate> & candidates, const std::vector<double> & defaults, size_t E) const;
+
+      /**
+       * @brief This function finds the best candidate at each belief.
+       *
+       * The beliefs on each observation are evaluated together, with a
+       * single product of their matrix and an AlphaMatrix of the distinct
+       * blocks of the candidates on that observation: the default block
+       * of each action, and the blocks owned by candidates. As in
+       * findBestAtBeliefs(), the blocks within rounding error of the best
+       * are evaluated again one by one, so that the result is the one of
+       * findBestAtBelief() on the full vectors, ties included.
+       *
+       * @param candidates The candidates to choose from.
+       * @param defaults The blocks of the cross-sum of the first blocks, O for each action.
+       * @param rank The rank of each candidate, see rankCandidates().
+       * @param E The number of environments.
+       * @param bObs The observation of each belief.
+       * @param bEnv The E probabilities of each belief.
+       * @param pool The pool to evaluate the beliefs with.
+       *
+       * @return The index of the best candidate of each belief.
+       */
+      std::vector<size_t> findBestCandidates(const std::vector<Candidate> & candidates, const std::vector<double> & defaults, const std::vector<size_t> & rank, size_t E,
+					     const std::vector<size_t> & bObs, const std::vector<double> & bEnv, Impl::ThreadPool & pool) const;
 
       size_t S, A, O, beliefSize_;
       unsigned horizon_;
@@ -140,11 +212,12 @@ namespace AIToolbox {
     };
 
     template <typename M, typename std::enable_if<is_model<M>::value, int>::type>
-    std::tuple<bool, ValueFunction, int> PBVI::operator()(const M & model) {
+    std::tuple<bool, BlockValueFunction, int> PBVI::operator()(const M & model, size_t threads, Memory memory) {
       // Initialize "global" variables
       S = model.getS();
       A = model.getA();
       O = model.getO();
+      size_t E = model.getE();
 
       // In this implementation we compute all beliefs in advance. This
       // is mostly due to the fact that I prefer counter parameters (how
@@ -153,14 +226,33 @@ namespace AIToolbox {
       // can be called multiple times to increase the size of the belief
       // vector.
 
-      BeliefGenerator<M> bGen(model);
-      auto beliefs = bGen(beliefSize_);
+      auto beliefs = BeliefGenerator<M>(model, threads)(beliefSize_);
+
+      // Keep the beliefs on a single observation, as an observation and a belief over environments.
+      std::vector<size_t> bObs;
+      std::vector<double> bEnv;
+      for ( auto & belief : beliefs ) {
+	size_t p = O;
+	bool single = true;
+	for ( size_t s = 0; s < S && single; ++s ) {
+	  if ( belief[s] > 0.0 ) {
+	    if ( p == O ) p = s % O;
+	    else single = (s % O == p);
+	  }
+	}
+	if ( !single || p == O ) continue;
+	bObs.push_back(p);
+	for ( size_t e = 0; e < E; ++e )
+	  bEnv.push_back(belief[e * O + p]);
+      }
+      std::cerr << "        " << bObs.size() << "/" << beliefs.size() << " support beliefs on a single observation\n";
 
-      ValueFunction v(1, VList(1, makeVEntry(S)));
+      BlockValueFunction v(1, BlockVList::zero(E, O));
 
       unsigned timestep = 0;
 
-      Projecter<M> projecter(model);
+      BlockProjecter<M> projecter(model);
+      Impl::ThreadPool pool(threads);
 
       // And off we go
       bool useEpsilon = checkDifferentSmall(epsilon_, 0.0);
@@ -168,104 +260,313 @@ namespace AIToolbox {
       while ( timestep < horizon_ && ( !useEpsilon || variation > epsilon_ ) ) {
 	std::cerr << "        Timestep " << timestep + 1 <<"/" << horizon_ << "\n";
 	++timestep;
+	const BlockVList & w = v[timestep-1];
 
-	// Compute all possible outcomes, from our previous results.
-	// This means that for each action-observation pair, we are going
-	// to obtain the same number of possible outcomes as the number
-	// of entries in our initial vector w.
-	auto projs = projecter(v[timestep-1]);
-
-	size_t finalWSize = 0;
-	// In this method we split the work by action, which will then
-	// be joined again at the end of the loop. This is not required,
-	// but there does not seem to be a speed boost by not doing
-	// so (not that I found one, if there is one I'd like to know!)
+	// The backup is split in (action, belief chunk) work items, which
+	// idle threads pick from the pool's queue. Each item writes its own
+	// candidates, so the result does not depend on the scheduling.
+	size_t N = bObs.size();
+	size_t chunks = std::max<size_t>(1, std::min(N, (pool.size() * 4 + A - 1) / A));
+	std::vector<Candidate> candidates(A * N);
+	std::vector<std::uint32_t> zeros(O, 0);
+	std::vector<double> defaults(A * O * E);
+	size_t done = 0, total = A * (chunks + 1);
+	std::mutex progress;
+	std::vector<Impl::ThreadPool::Task> tasks;
+	tasks.reserve(total);
 	for ( size_t a = 0; a < A; ++a ) {
-	  std::cerr << "\r          cross-sum " << a + 1 << "/" << A <<"                    ";
-	  projs[a][0] = crossSum( projs[a], a, beliefs, projecter.getImmediateRewards(a), model);
-	  finalWSize += projs[a][0].size();
+	  // Blocks of the cross-sum of the first blocks of w, shared by most candidates.
+	  tasks.emplace_back([this, a, E, &projecter, &w, &zeros, &defaults, &done, &total, &progress]() {
+	      std::vector<double> buffer(E);
+	      for ( size_t p = 0; p < O; ++p )
+		projecter.crossBlock(w, a, p, zeros.data(), defaults.data() + (a * O + p) * E, buffer.data());
+	      std::lock_guard<std::mutex> lock(progress);
+	      std::cerr << "\r          cross-sum " << ++done << "/" << total << "                    ";
+	    });
+	  for ( size_t c = 0; c < chunks; ++c ) {
+	    size_t begin = c * N / chunks, end = (c + 1) * N / chunks;
+	    tasks.emplace_back([this, a, N, begin, end, &model, &projecter, &w, &bObs, &bEnv, &candidates, &done, &total, &progress]() {
+		crossSum(model, projecter, w, a, bObs, bEnv, begin, end, candidates.data() + a * N);
+		std::lock_guard<std::mutex> lock(progress);
+		std::cerr << "\r          cross-sum " << ++done << "/" << total << "                    ";
+	      });
+	  }
 	}
+	pool.run(tasks);
 	std::cerr << "\n";
-	VList w;
-	w.reserve(finalWSize);
-	for ( size_t a = 0; a < A; ++a )
-	  std::move(std::begin(projs[a][0]), std::end(projs[a][0]), std::back_inserter(w));
-	auto begin = std::begin(w), bound = begin, end = std::end(w);
-	for ( auto & belief : beliefs )
-	  bound = extractWorstAtBelief(belief, begin, bound, end);
 
-	w.erase(bound, end);
+	auto defaultBlock = [&](size_t a, size_t p) -> const double * {
+	  return defaults.data() + (a * O + p) * E;
+	};
+	// Find the best candidate of each belief, breaking ties as
+	// findBestAtBelief does.
+	auto rank = rankCandidates(candidates, defaults, E);
+	auto best = findBestCandidates(candidates, defaults, rank, E, bObs, bEnv, pool);
 
-	// If you want to save as much memory as possible, do this.
-	// It make take some time more though since it needs to reallocate
-	// and copy stuff around.
-	// w.shrink_to_fit();
+	// Keep them in belief order.
+	std::vector<size_t> selected;
+	std::vector<char> isSelected(candidates.size(), 0);
+	for ( auto j : best ) {
+	  if ( !isSelected[j] ) {
+	    isSelected[j] = 1;
+	    selected.push_back(j);
+	  }
+	}
+	// Vectors are added from the lexicographically largest, so that
+	// the first best block of the list is the one findBestAtBelief
+	// would pick among the full vectors.
+	std::stable_sort(selected.begin(), selected.end(), [&](size_t lhs, size_t rhs) { return rank[lhs] > rank[rhs]; });
 
-	v.emplace_back(std::move(w));
+	// Without support beliefs, keep the cross-sum of the first blocks.
+	BlockVList nw(E, O);
+	std::vector<char> defaultAdded(A * O, 0);
+	std::vector<std::uint32_t> links(O);
+	if ( selected.empty() ) {
+	  nw.add(0, zeros.data());
+	  for ( size_t p = 0; p < O; ++p )
+	    nw.addBlock(p, defaultBlock(0, p));
+	}
+	for ( auto j : selected ) {
+	  const Candidate & c = candidates[j];
+	  std::fill(links.begin(), links.end(), 0);
+	  for ( size_t i = 0; i < c.choices.size(); i += 2 )
+	    links[c.choices[i]] = w.owner(c.choices[i], c.choices[i+1]);
+	  nw.add(c.action, links.data());
+	  size_t k = 0;
+	  for ( size_t p = 0; p < O; ++p ) {
+	    if ( k < c.blockObs.size() && c.blockObs[k] == p ) {
+	      nw.addBlock(p, c.blockValues.data() + k * E);
+	      ++k;
+	    }
+	    // Shared blocks are equal, so only the first one can be kept.
+	    else if ( !defaultAdded[c.action * O + p] ) {
+	      defaultAdded[c.action * O + p] = 1;
+	      nw.addBlock(p, defaultBlock(c.action, p));
+	    }
+	  }
+	}
+	std::cerr << "          " << nw.size() << " vectors, " << nw.blocks() << " blocks\n";
+
+	v.emplace_back(std::move(nw));
 
 	// Check convergence
 	if ( useEpsilon ) {
 	  variation = weakBoundDistance(v[timestep-1], v[timestep]);
 	}
+
+	// The next backup only reads v[timestep].
+	if ( timestep >= 2 ) {
+	  if ( memory == Memory::Graph ) v[timestep-2].dropValues();
+	  else if ( memory == Memory::Last ) v[timestep-2].clear();
+	}
       }
 
-      return std::make_tuple(!useEpsilon || variation < epsilon_, v, timestep);
+      return std::make_tuple(!useEpsilon || variation < epsilon_, std::move(v), timestep);
     }
 
-    template <typename ProjectionsRow, typename M>
-    VList PBVI::crossSum(const ProjectionsRow & projs, size_t a, const std::vector<Belief> & bl, MDP::Values irw, const M& model_) {
-
-      VList result;
-      result.reserve(bl.size());
-
-      for ( auto & b : bl ) {
-	// OPT: Initialize with constant term (immediate rewards)
-	MDP::Values v = model_.getO() * irw;
-	VObs obs(O);
-
-	// We compute the crossSum between each best vector for the belief.
-	for ( size_t o = 0; o < model_.getO(); ++o ) {
-	  const VList & projsO = projs[o];
-	  // OPT: Efficient bestMatch search by ignoring constant value in projs[a][o][i].Values
-	  // Build list of states of interest
-	  std::vector<size_t> aux = model_.previous_states(o);
-	  std::vector<size_t> int_states (aux.size() * model_.getE());
-	  for (int i = 0; i < aux.size(); i++) {
-	    for (int e = 0; e < model_.getE(); e++) {
-	      int_states.at(e * aux.size() + i) = e * model_.getO() + aux.at(i);
+    template <typename M>
+    void PBVI::crossSum(const M & model, const BlockProjecter<M> & projecter, const BlockVList & w, size_t a,
+			const std::vector<size_t> & bObs, const std::vector<double> & bEnv, size_t begin, size_t end, Candidate * result) const {
+      size_t E = model.getE();
+      std::vector<std::uint32_t> choice(O, 0);
+      std::vector<size_t> mark(O, bObs.size());
+      std::vector<double> buffer(E);
+
+      for ( size_t i = begin; i < end; ++i ) {
+	size_t p = bObs[i];
+	const double * b = bEnv.data() + i * E;
+	Candidate & c = result[i];
+	c.action = a;
+
+	// We pick the best projection for each observation which may
+	// follow p. The belief is zero on all others, where the first
+	// block is kept.
+	for ( auto o : projecter.successors(p) ) {
+	  size_t bestMatch = 0;
+	  double bestValue = projecter.value(w, 0, p, a, o, b, buffer.data());
+	  for ( size_t k = 1; k < w.blocks(o); ++k ) {
+	    double value = projecter.value(w, k, p, a, o, b, buffer.data());
+	    if ( value > bestValue ) {
+	      bestValue = value;
+	      bestMatch = k;
 	    }
 	  }
-	  // Init bestMatch at beginning
-	  auto bestMatch = std::begin(projsO);
-	  double bestvalue = 0.;
-	  for (auto it = int_states.begin(); it != int_states.end(); ++it) {
-	    bestvalue += std::get<VALUES>(*bestMatch)[*it] * b(*it);
-	  }
-	  // Find maximal value for specified velief
-	  for (auto it = std::begin(projsO) + 1; it != std::end(projsO); ++it) {
-	    double curvalue = 0.;
-	    for (auto jt = int_states.begin(); jt != int_states.end(); ++jt) {
-	      curvalue += std::get<VALUES>(*it)[*jt] * b(*jt);
+	  if ( !bestMatch ) continue;
+	  choice[o] = bestMatch;
+	  c.choices.push_back(o);
+	  c.choices.push_back(bestMatch);
+	  // Blocks of observations preceding o are affected by this choice.
+	  StateSpan prev = model.previous_observations(o);
+	  for ( auto it = prev.begin(); it != prev.end(); ++it ) {
+	    if ( mark[*it] != i ) {
+	      mark[*it] = i;
+	      c.blockObs.push_back(*it);
 	    }
-	    if (curvalue > bestvalue) {
-	      bestvalue = curvalue;
-	      bestMatch = it;
+	  }
+	}
+	std::sort(c.blockObs.begin(), c.blockObs.end());
+
+	c.blockValues.resize(c.blockObs.size() * E);
+	for ( size_t k = 0; k < c.blockObs.size(); ++k )
+	  projecter.crossBlock(w, a, c.blockObs[k], choice.data(), c.blockValues.data() + k * E, buffer.data());
+
+	for ( size_t k = 0; k < c.choices.size(); k += 2 )
+	  choice[c.choices[k]] = 0;
+      }
+    }
+
+    inline std::vector<size_t> PBVI::rankCandidates(const std::vector<Candidate> & candidates, const std::vector<double> & defaults, size_t E) const {
+      const size_t states = E * O, unknown = std::numeric_limits<size_t>::max();
+      auto defaultAt = [&](size_t a, size_t p, size_t e) { return defaults[(a * O + p) * E + e]; };
+      // The value of c at state e * O + p, k being the index of its first own block not before p.
+      auto valueAt = [&](const Candidate & c, size_t k, size_t e, size_t p) {
+	return ( k < c.blockObs.size() && c.blockObs[k] == p ) ? c.blockValues[k * E + e] : defaultAt(c.action, p, e);
+      };
+
+      // Compares two candidates on the states before to, only looking at
+      // the observations where one of them has its own block.
+      auto compareOwn = [&](const Candidate & lhs, const Candidate & rhs, size_t to) {
+	for ( size_t e = 0; e * O < to; ++e ) {
+	  size_t i = 0, j = 0;
+	  while ( i < lhs.blockObs.size() || j < rhs.blockObs.size() ) {
+	    size_t p = std::min<size_t>(i < lhs.blockObs.size() ? lhs.blockObs[i] : O, j < rhs.blockObs.size() ? rhs.blockObs[j] : O);
+	    if ( e * O + p >= to ) break;
+	    double l = valueAt(lhs, i, e, p), r = valueAt(rhs, j, e, p);
+	    if ( l < r ) return -1;
+	    if ( r < l ) return 1;
+	    if ( i < lhs.blockObs.size() && lhs.blockObs[i] == p ) ++i;
+	    if ( j < rhs.blockObs.size() && rhs.blockObs[j] == p ) ++j;
+	  }
+	}
+	return 0;
+      };
+
+      // The first state where the default blocks of two actions differ.
+      std::vector<size_t> firstDiff(A * A, unknown);
+      auto firstDefaultDiff = [&](size_t a, size_t b) {
+	size_t & d = firstDiff[a * A + b];
+	if ( d == unknown ) {
+	  d = 0;
+	  while ( d < states && defaultAt(a, d % O, d / O) == defaultAt(b, d % O, d / O) ) ++d;
+	  firstDiff[b * A + a] = d;
+	}
+	return d;
+      };
+
+      // Lexicographic order of the full vectors, states being e * O + o.
+      // Before the first state where the default blocks of their actions
+      // differ, two candidates can only differ on their own blocks.
+      auto lexLess = [&](size_t lhs, size_t rhs) {
+	const Candidate & l = candidates[lhs], & r = candidates[rhs];
+	size_t d = ( l.action == r.action ) ? states : firstDefaultDiff(l.action, r.action);
+	int order = compareOwn(l, r, d);
+	if ( order ) return order < 0;
+	for ( ; d < states; ++d ) {
+	  size_t e = d / O, p = d % O;
+	  double lv = valueAt(l, std::lower_bound(l.blockObs.begin(), l.blockObs.end(), p) - l.blockObs.begin(), e, p);
+	  double rv = valueAt(r, std::lower_bound(r.blockObs.begin(), r.blockObs.end(), p) - r.blockObs.begin(), e, p);
+	  if ( lv < rv ) return true;
+	  if ( rv < lv ) return false;
+	}
+	return false;
+      };
+
+      std::vector<size_t> order(candidates.size()), rank(candidates.size(), 0);
+      std::iota(order.begin(), order.end(), 0);
+      std::sort(order.begin(), order.end(), lexLess);
+      for ( size_t k = 1; k < order.size(); ++k )
+	rank[order[k]] = rank[order[k-1]] + lexLess(order[k-1], order[k]);
+      return rank;
+    }
+
+    inline std::vector<size_t> PBVI::findBestCandidates(const std::vector<Candidate> & candidates, const std::vector<double> & defaults, const std::vector<size_t> & rank, size_t E,
+							const std::vector<size_t> & bObs, const std::vector<double> & bEnv, Impl::ThreadPool & pool) const {
+      const size_t N = bObs.size(), C = candidates.size();
+      std::vector<size_t> best(N, 0);
+      if ( !N ) return best;
+
+      // The beliefs grouped by observation, and the candidates owning a block of each observation.
+      std::vector<size_t> beliefs(N);
+      std::iota(beliefs.begin(), beliefs.end(), 0);
+      std::stable_sort(beliefs.begin(), beliefs.end(), [&](size_t lhs, size_t rhs) { return bObs[lhs] < bObs[rhs]; });
+      std::vector<std::vector<std::uint32_t>> owners(O);
+      for ( size_t j = 0; j < C; ++j )
+	for ( auto p : candidates[j].blockObs )
+	  owners[p].push_back(j);
+
+      // The candidates of each action from the best to the worst tie-break:
+      // on each observation, the first one without its own block stands
+      // for all those using the default block.
+      std::vector<std::vector<std::uint32_t>> byRank(A);
+      for ( size_t j = 0; j < C; ++j )
+	byRank[candidates[j].action].push_back(j);
+      for ( auto & list : byRank )
+	std::sort(list.begin(), list.end(), [&](size_t lhs, size_t rhs) { return rank[lhs] != rank[rhs] ? rank[lhs] > rank[rhs] : lhs > rhs; });
+
+      auto evaluate = [&, E, N, C](size_t begin, size_t end) {
+	std::vector<char> owns(C, 0);
+	std::vector<const double *> blocks;
+	std::vector<size_t> reps;
+	while ( begin < end ) {
+	  size_t p = bObs[beliefs[begin]], last = begin;
+	  while ( last < end && bObs[beliefs[last]] == p ) ++last;
+
+	  blocks.clear();
+	  reps.clear();
+	  for ( auto j : owners[p] ) owns[j] = 1;
+	  for ( size_t a = 0; a < A; ++a ) {
+	    for ( auto j : byRank[a] ) {
+	      if ( owns[j] ) continue;
+	      blocks.push_back(defaults.data() + (a * O + p) * E);
+	      reps.push_back(j);
+	      break;
 	    }
 	  }
+	  for ( auto j : owners[p] ) {
+	    owns[j] = 0;
+	    const Candidate & c = candidates[j];
+	    blocks.push_back(c.blockValues.data() + (std::lower_bound(c.blockObs.begin(), c.blockObs.end(), p) - c.blockObs.begin()) * E);
+	    reps.push_back(j);
+	  }
+
+	  AlphaMatrix alphas(E, blocks.size());
+	  for ( size_t k = 0; k < blocks.size(); ++k )
+	    alphas.col(k) = Eigen::Map<const Vector>(blocks[k], E);
+	  Matrix2D envs(last - begin, E);
+	  for ( size_t r = 0; r < last - begin; ++r )
+	    envs.row(r) = Eigen::Map<const Vector>(bEnv.data() + beliefs[begin + r] * E, E).transpose();
+	  Matrix2D scores = envs * alphas;
+	  const double maxAbs = alphas.cwiseAbs().maxCoeff();
 
-	  // OPT: Only take into account the state with a discount term in projs[a][o][i].Values
-	  for (auto it = aux.begin(); it != aux.end(); ++it) {
-	    for (int e = 0; e < model_.getE(); e++) {
-	      size_t s = e * model_.getO() + *it;
-	      v[s] += std::get<VALUES>(*bestMatch)[s] - irw[s];
+	  for ( size_t r = 0; r < last - begin; ++r ) {
+	    size_t i = beliefs[begin + r];
+	    const double * b = bEnv.data() + i * E;
+	    double cutoff = scores.row(r).maxCoeff() - 2.0 * (E + 1) * std::numeric_limits<double>::epsilon() * envs.row(r).cwiseAbs().sum() * maxAbs;
+	    size_t bestMatch = C;
+	    double bestValue = 0.0;
+	    for ( size_t k = 0; k < blocks.size(); ++k ) {
+	      if ( scores(r, k) < cutoff ) continue;
+	      double value = Impl::BlockKernel::dot(blocks[k], b, E);
+	      size_t j = reps[k];
+	      if ( bestMatch == C || value > bestValue || ( value == bestValue && ( rank[j] > rank[bestMatch] || ( rank[j] == rank[bestMatch] && j > bestMatch ) ) ) ) {
+		bestValue = value;
+		bestMatch = j;
+	      }
 	    }
+	    best[i] = bestMatch;
 	  }
-	  obs[o] = std::get<OBS>(*bestMatch)[0];
+	  begin = last;
 	}
-	result.emplace_back(std::move(v), a, std::move(obs));
+      };
+
+      size_t chunks = std::min(N, pool.size() * 4);
+      std::vector<Impl::ThreadPool::Task> tasks;
+      for ( size_t c = 0; c < chunks; ++c ) {
+	size_t begin = c * N / chunks, end = (c + 1) * N / chunks;
+	tasks.emplace_back([begin, end, &evaluate]() { evaluate(begin, end); });
       }
-      result.erase(extractDominated(S, std::begin(result), std::end(result)), std::end(result));
-      return result;
+      pool.run(tasks);
+      return best;
     }
   }
 }
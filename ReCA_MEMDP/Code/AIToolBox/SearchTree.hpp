@@ -0,0 +1,396 @@
+#ifndef AI_TOOLBOX_POMDP_SEARCH_TREE_HEADER_FILE
+#define AI_TOOLBOX_POMDP_SEARCH_TREE_HEADER_FILE
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace AIToolbox {
+  namespace POMDP {
+
+    /**
+     * @brief This class is a pool of objects addressed by 32 bit indices.
+     *
+     * Objects are stored in fixed-size blocks which are never moved or
+     * freed until destruction, so that references to elements stay valid
+     * while the arena grows. The block directory is reserved up front,
+     * which allows reading existing elements while another thread
+     * (holding the allocation lock) appends new ones.
+     *
+     * clear() only rewinds the arena: memory is kept and reused by the
+     * following allocations.
+     */
+    template <typename T>
+    class Arena {
+    public:
+      using Id = std::uint32_t;
+
+      /**
+       * @brief Basic constructor.
+       *
+       * @param minContiguous The largest number of elements that will be requested in a single allocate() call.
+       */
+      Arena(size_t minContiguous = 1);
+
+      Arena(const Arena & other);
+      Arena & operator=(const Arena & other);
+      Arena(Arena &&) = default;
+      Arena & operator=(Arena &&) = default;
+
+      /**
+       * @brief This function allocates n contiguous default-initialized elements.
+       *
+       * @param n The number of elements, at most the minContiguous given at construction.
+       *
+       * @return The index of the first element.
+       */
+      Id allocate(size_t n = 1);
+
+      T & operator[](Id id) { return blocks_[id >> shift_][id & mask_]; }
+      const T & operator[](Id id) const { return blocks_[id >> shift_][id & mask_]; }
+
+      /**
+       * @brief This function returns a pointer to n contiguous elements allocated together.
+       */
+      T * data(Id id) { return &blocks_[id >> shift_][id & mask_]; }
+      const T * data(Id id) const { return &blocks_[id >> shift_][id & mask_]; }
+
+      /**
+       * @brief This function forgets all elements in O(1), keeping the memory for reuse.
+       */
+      void clear() { next_ = 0; }
+
+      /**
+       * @brief This function returns the number of slots in use.
+       */
+      size_t size() const { return next_; }
+
+      /**
+       * @brief This function returns the number of slots backed by memory.
+       */
+      size_t capacity() const { return blocks_.size() << shift_; }
+
+    private:
+      void copyFrom(const Arena & other);
+
+      unsigned shift_;
+      size_t mask_;
+      size_t next_;
+      std::vector<std::unique_ptr<T[]>> blocks_;
+    };
+
+    template <typename T>
+    Arena<T>::Arena(size_t minContiguous) : shift_(12), next_(0) {
+      while ((size_t(1) << shift_) < minContiguous) ++shift_;
+      mask_ = (size_t(1) << shift_) - 1;
+      // Enough block pointers to address the whole Id range: reserving
+      // only takes address space, but guarantees the directory never moves.
+      blocks_.reserve((size_t(std::numeric_limits<Id>::max()) >> shift_) + 1);
+    }
+
+    template <typename T>
+    Arena<T>::Arena(const Arena & other) : shift_(other.shift_), mask_(other.mask_), next_(0) {
+      blocks_.reserve((size_t(std::numeric_limits<Id>::max()) >> shift_) + 1);
+      copyFrom(other);
+    }
+
+    template <typename T>
+    Arena<T> & Arena<T>::operator=(const Arena & other) {
+      if (this != &other) {
+	if (shift_ != other.shift_) {
+	  shift_ = other.shift_;
+	  mask_ = other.mask_;
+	  blocks_.clear();
+	}
+	copyFrom(other);
+      }
+      return *this;
+    }
+
+    template <typename T>
+    void Arena<T>::copyFrom(const Arena & other) {
+      next_ = other.next_;
+      size_t used = (next_ + mask_) >> shift_;
+      while (blocks_.size() < used)
+	blocks_.emplace_back(new T[mask_ + 1]);
+      for (size_t i = 0; i < used; ++i)
+	std::copy(other.blocks_[i].get(), other.blocks_[i].get() + mask_ + 1, blocks_[i].get());
+    }
+
+    template <typename T>
+    typename Arena<T>::Id Arena<T>::allocate(size_t n) {
+      assert(n > 0 && n <= mask_ + 1);
+      // Contiguous ranges never straddle two blocks.
+      if ((next_ & mask_) + n > mask_ + 1)
+	next_ = (next_ | mask_) + 1;
+      if (next_ + n > size_t(std::numeric_limits<Id>::max()))
+	throw std::bad_alloc();
+      while (next_ + n > capacity())
+	blocks_.emplace_back(new T[mask_ + 1]);
+
+      Id id = static_cast<Id>(next_);
+      T * p = data(id);
+      for (size_t i = 0; i < n; ++i)
+	p[i] = T();
+      next_ += n;
+      return id;
+    }
+
+    /**
+     * @brief This class stores a PAMCP search tree in a few contiguous arenas.
+     *
+     * Belief nodes, action nodes, observation edges, environment beliefs
+     * and particles each live in their own pool, and refer to each other
+     * by index. The A action nodes of a belief node are allocated together,
+     * and so are the entries of an environment belief, which only stores
+     * its support (see SparseEnvBelief).
+     *
+     * The children of an action node are kept in a singly linked list of
+     * edges keyed by observation: in MEMDPs only a handful of observations
+     * can follow a given (belief, action) pair, so a linear scan over
+     * neighbouring edges is cheaper than hashing.
+     *
+     * Nodes are never freed individually: re-rooting simply changes the
+     * root index, and clear() drops the whole tree in O(1).
+     */
+    class SearchTree {
+    public:
+      using Id = std::uint32_t;
+      static constexpr Id None = std::numeric_limits<Id>::max();
+
+      struct ActionNode {
+	double V = 0.0;
+	unsigned N = 0;
+	unsigned pending = 0; // Simulations currently running through this node (tree parallelism)
+	Id edges = None;
+      };
+
+      struct BeliefNode {
+	size_t obs = 0;
+	unsigned N = 0;
+	Id actions = None;
+	Id belief = None;
+	unsigned support = 0;   // Number of environments in the belief
+	Id particles = None;
+	unsigned nParticles = 0;
+      };
+
+      struct Edge {
+	size_t obs = 0;
+	Id child = None;
+	Id next = None;
+      };
+
+      struct ParticleChunk {
+	static constexpr unsigned Size = 14;
+	size_t s[Size];
+	unsigned n = 0;
+	Id next = None;
+      };
+
+      /**
+       * @brief Basic constructor.
+       *
+       * @param A The number of actions of the model.
+       * @param E The number of environments of the model.
+       */
+      SearchTree(size_t A = 1, size_t E = 1) : A_(A), E_(E), actions_(A), beliefEnvs_(E), beliefProbs_(E) {}
+
+      /**
+       * @brief This function drops all nodes in O(1), keeping the memory for reuse.
+       */
+      void clear() {
+	nodes_.clear(); actions_.clear(); edges_.clear(); beliefEnvs_.clear(); beliefProbs_.clear(); particles_.clear();
+      }
+
+      /**
+       * @brief This function creates a new node with no children.
+       *
+       * @param obs The observation of the node.
+       *
+       * @return The index of the new node.
+       */
+      Id addNode(size_t obs) {
+	Id b = nodes_.allocate();
+	nodes_[b].obs = obs;
+	return b;
+      }
+
+      /**
+       * @brief This function creates the action nodes of b, if they do not already exist.
+       */
+      void expand(Id b) {
+	if (nodes_[b].actions == None)
+	  nodes_[b].actions = actions_.allocate(A_);
+      }
+
+      /**
+       * @brief This function returns whether the action nodes of b exist.
+       */
+      bool isExpanded(Id b) const { return nodes_[b].actions != None; }
+
+      /**
+       * @brief This function returns the child of b following action a and observation o, or None.
+       */
+      Id findChild(Id b, size_t a, size_t o) const {
+	for (Id e = action(b, a).edges; e != None; e = edges_[e].next)
+	  if (edges_[e].obs == o) return edges_[e].child;
+	return None;
+      }
+
+      /**
+       * @brief This function creates a new child of b following action a and observation o.
+       *
+       * The caller must ensure the child does not exist yet.
+       *
+       * @return The index of the new node.
+       */
+      Id addChild(Id b, size_t a, size_t o) {
+	return link(b, a, o, addNode(o));
+      }
+
+      /**
+       * @brief This function attaches an existing node as child of b following action a and observation o.
+       *
+       * @return The index of the child.
+       */
+      Id link(Id b, size_t a, size_t o, Id child) {
+	Id e = edges_.allocate();
+	auto & an = action(b, a);
+	edges_[e].obs = o;
+	edges_[e].child = child;
+	edges_[e].next = an.edges;
+	an.edges = e;
+	return child;
+      }
+
+      /**
+       * @brief This function calls f(o, child) for every child of b following action a.
+       */
+      template <typename F>
+      void forEachChild(Id b, size_t a, F f) const {
+	for (Id e = action(b, a).edges; e != None; e = edges_[e].next)
+	  f(edges_[e].obs, edges_[e].child);
+      }
+
+      BeliefNode & node(Id b) { return nodes_[b]; }
+      const BeliefNode & node(Id b) const { return nodes_[b]; }
+
+      ActionNode & action(Id b, size_t a) { return actions_[nodes_[b].actions + a]; }
+      const ActionNode & action(Id b, size_t a) const { return actions_[nodes_[b].actions + a]; }
+
+      /**
+       * @brief This function returns the A contiguous action nodes of an expanded node.
+       */
+      ActionNode * actions(Id b) { return actions_.data(nodes_[b].actions); }
+      const ActionNode * actions(Id b) const { return actions_.data(nodes_[b].actions); }
+
+      /**
+       * @brief This function allocates room for an environment belief of b with up to n environments.
+       *
+       * The caller fills beliefEnvs(b) and beliefProbs(b), then sets the
+       * actual size of the support with setSupport().
+       *
+       * @param n The largest possible support, at most E.
+       */
+      void allocateBelief(Id b, size_t n) {
+	Id id = beliefEnvs_.allocate(n);
+	beliefProbs_.allocate(n); // Both arenas grow in lockstep and return the same index
+	nodes_[b].belief = id;
+	nodes_[b].support = n;
+      }
+
+      /**
+       * @brief This function sets the environment belief of b to a copy of the given support.
+       */
+      void setBelief(Id b, const std::uint32_t * envs, const double * probs, size_t n) {
+	allocateBelief(b, n);
+	std::copy(envs, envs + n, beliefEnvs(b));
+	std::copy(probs, probs + n, beliefProbs(b));
+      }
+
+      /**
+       * @brief This function shrinks the support of the environment belief of b.
+       */
+      void setSupport(Id b, size_t n) { assert(n <= nodes_[b].support); nodes_[b].support = n; }
+
+      /**
+       * @brief This function returns whether b has a non-empty environment belief.
+       */
+      bool hasBelief(Id b) const { return nodes_[b].belief != None && nodes_[b].support; }
+
+      /**
+       * @brief This function returns the number of environments in the belief of b.
+       */
+      size_t support(Id b) const { return nodes_[b].support; }
+
+      /**
+       * @brief This function returns the environments in the belief of b, in increasing order.
+       */
+      std::uint32_t * beliefEnvs(Id b) { return beliefEnvs_.data(nodes_[b].belief); }
+      const std::uint32_t * beliefEnvs(Id b) const { return beliefEnvs_.data(nodes_[b].belief); }
+
+      /**
+       * @brief This function returns the probabilities of the environments in the belief of b.
+       */
+      double * beliefProbs(Id b) { return beliefProbs_.data(nodes_[b].belief); }
+      const double * beliefProbs(Id b) const { return beliefProbs_.data(nodes_[b].belief); }
+
+      /**
+       * @brief This function adds a particle to the sampled belief of b.
+       */
+      void addParticle(Id b, size_t s) {
+	auto & bn = nodes_[b];
+	if (bn.particles == None || particles_[bn.particles].n == ParticleChunk::Size) {
+	  Id c = particles_.allocate();
+	  particles_[c].next = bn.particles;
+	  bn.particles = c;
+	}
+	auto & chunk = particles_[bn.particles];
+	chunk.s[chunk.n++] = s;
+	bn.nParticles++;
+      }
+
+      /**
+       * @brief This function copies the sampled belief of b into out.
+       */
+      void getParticles(Id b, std::vector<size_t> & out) const {
+	out.clear();
+	out.reserve(nodes_[b].nParticles);
+	for (Id c = nodes_[b].particles; c != None; c = particles_[c].next)
+	  out.insert(out.end(), particles_[c].s, particles_[c].s + particles_[c].n);
+      }
+
+      /**
+       * @brief This function returns the number of belief nodes allocated since the last clear().
+       */
+      size_t size() const { return nodes_.size(); }
+
+      /**
+       * @brief This function returns the approximate number of bytes in use by the tree.
+       */
+      size_t memoryUsage() const {
+	return nodes_.size() * sizeof(BeliefNode) + actions_.size() * sizeof(ActionNode) + edges_.size() * sizeof(Edge)
+	  + beliefEnvs_.size() * sizeof(std::uint32_t) + beliefProbs_.size() * sizeof(double) + particles_.size() * sizeof(ParticleChunk);
+      }
+
+      size_t getA() const { return A_; }
+      size_t getE() const { return E_; }
+
+    private:
+      size_t A_, E_;
+      Arena<BeliefNode> nodes_;
+      Arena<ActionNode> actions_;
+      Arena<Edge> edges_;
+      Arena<std::uint32_t> beliefEnvs_;
+      Arena<double> beliefProbs_;
+      Arena<ParticleChunk> particles_;
+    };
+  }
+}
+
+#endif
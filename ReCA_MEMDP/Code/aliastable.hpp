@@ -0,0 +1,144 @@
+#ifndef ALIASTABLE_H_INCLUDED
+#define ALIASTABLE_H_INCLUDED
+
+/* ---------------------------------------------------------------------------
+** aliastable.hpp
+** Walker alias tables for O(1) sampling from many fixed-width discrete
+** distributions, e.g. the rows of a transition matrix.
+**
+** Author: Amelie Royer
+** Email: amelie.royer@ist.ac.at
+** -------------------------------------------------------------------------*/
+
+#include <vector>
+#include <random>
+#include <cstdint>
+
+
+class AliasTable {
+public:
+  /*! \brief Default constructor (no rows).
+   */
+  AliasTable() : width(0), view_prob(nullptr), view_alias(nullptr) {};
+
+  /*! \brief Builds the tables of n_rows distributions, using Vose's method.
+   *
+   * \param weights n_rows * width non-negative weights, row after row. Rows need not be normalized.
+   * \param n_rows number of distributions.
+   * \param width number of outcomes of each distribution.
+   */
+  void build(const double* weights, size_t n_rows, size_t width_);
+
+  /*! \brief Samples an outcome of the given row in O(1), without allocating.
+   * Rows with only zero weights are sampled uniformly.
+   *
+   * \param row index of the distribution.
+   * \param generator random engine to draw from.
+   *
+   * \return an outcome in [0, width - 1].
+   */
+  template <typename G>
+  size_t sample(size_t row, G& generator) const {
+    std::uniform_real_distribution<double> distribution(0., (double) width);
+    double u = distribution(generator);
+    size_t i = (size_t) u;
+    if (i >= width) {
+      i = width - 1;
+    }
+    size_t k = row * width + i;
+    return ((u - i < probabilities()[k]) ? i : aliases()[k]);
+  };
+
+  /*! \brief Uses tables stored elsewhere (e.g. in a mapped model file) instead of building them.
+   * The memory must outlive the table and all of its copies.
+   *
+   * \param prob_ n_rows * width probabilities, as returned by probabilities().
+   * \param alias_ n_rows * width outcomes, as returned by aliases().
+   * \param width_ number of outcomes of each distribution.
+   */
+  void attach(const double* prob_, const uint32_t* alias_, size_t width_) {
+    width = width_;
+    prob.clear();
+    alias.clear();
+    view_prob = prob_;
+    view_alias = alias_;
+  };
+
+  /*! \brief Returns the number of outcomes of each distribution.
+   */
+  size_t get_width() const { return width; };
+
+  /*! \brief Raw tables, row after row.
+   */
+  const double* probabilities() const { return (view_prob ? view_prob : prob.data()); };
+  const uint32_t* aliases() const { return (view_alias ? view_alias : alias.data()); };
+
+private:
+  size_t width;                  /*!< Number of outcomes per row */
+  std::vector<double> prob;      /*!< Probability of keeping each outcome */
+  std::vector<uint32_t> alias;   /*!< Outcome to return otherwise */
+  const double* view_prob;       /*!< Attached tables, if any */
+  const uint32_t* view_alias;
+};
+
+
+/**
+ * BUILD
+ */
+inline void AliasTable::build(const double* weights, size_t n_rows, size_t width_) {
+  width = width_;
+  view_prob = nullptr;
+  view_alias = nullptr;
+  prob.assign(n_rows * width, 1.0);
+  alias.resize(n_rows * width);
+  std::vector<double> scaled(width);
+  std::vector<uint32_t> small, large;
+  small.reserve(width);
+  large.reserve(width);
+
+  for (size_t r = 0; r < n_rows; r++) {
+    const double* w = weights + r * width;
+    double* p = &prob[r * width];
+    uint32_t* al = &alias[r * width];
+    double nrm = 0.;
+    for (size_t i = 0; i < width; i++) {
+      nrm += w[i];
+      al[i] = i;
+    }
+    // Empty rows: uniform
+    if (nrm <= 0) {
+      continue;
+    }
+    small.clear();
+    large.clear();
+    for (size_t i = 0; i < width; i++) {
+      scaled[i] = w[i] * width / nrm;
+      if (scaled[i] < 1.0) {
+	small.push_back(i);
+      } else {
+	large.push_back(i);
+      }
+    }
+    // Pair each under-full outcome with an over-full one
+    while (!small.empty() && !large.empty()) {
+      uint32_t s = small.back(); small.pop_back();
+      uint32_t l = large.back();
+      p[s] = scaled[s];
+      al[s] = l;
+      scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+      if (scaled[l] < 1.0) {
+	large.pop_back();
+	small.push_back(l);
+      }
+    }
+    // Leftovers are full up to rounding errors
+    for (auto it = large.begin(); it != large.end(); ++it) {
+      p[*it] = 1.0;
+    }
+    for (auto it = small.begin(); it != small.end(); ++it) {
+      p[*it] = 1.0;
+    }
+  }
+}
+
+#endif
@@ -15,15 +15,18 @@
 #include "recomodel.hpp"
 
 #include <AIToolbox/POMDP/IO.hpp>
+#include <AIToolbox/Impl/Seeder.hpp>
 #include "AIToolBox/PBVI.hpp"
 
 
 template <typename M>
-void mainMEMDP(M model, std::string datafile_base, std::string algo, int horizon, int steps, float epsilon, int beliefSize, float exp, bool precision, bool verbose, bool has_test) {
+void mainMEMDP(M model, std::string datafile_base, std::string algo, int horizon, int steps, float epsilon, int beliefSize, float exp, bool precision, bool verbose, bool has_test, size_t threads, std::string parallel, std::string decision_log, double budget, double prune, std::string memory) {
   // Training
   double training_time, testing_time;
   auto start = std::chrono::high_resolution_clock::now();
   std::cout << "\n" << current_time_str() << " - Starting " << algo << " solver...!\n" <<std::flush;
+  // Threads evaluate sessions in parallel, unless used by a parallel PAMCP search
+  size_t eval_threads = threads;
 
   // Evaluation
   // POMCP
@@ -35,9 +38,9 @@ void mainMEMDP(M model, std::string datafile_base, std::string algo, int horizon
     std::cout << std::flush;
     std::cerr << std::flush;
     if (has_test) {
-      evaluate_from_file(datafile_base + ".test", model, solver, horizon, verbose);
+      evaluate_from_file(datafile_base + ".test", model, solver, horizon, verbose, true, eval_threads);
     } else {
-      evaluate_interactive(5000, model, solver, horizon, verbose);
+      evaluate_interactive(5000, model, solver, horizon, verbose, false, 400, eval_threads);
     }
     testing_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000000.;
   }
@@ -46,24 +49,58 @@ void mainMEMDP(M model, std::string datafile_base, std::string algo, int horizon
     bool with_tree = !(algo.compare("pamcp") && algo.compare("pamcpex"));
     bool with_exact_belief = !(algo.compare("pamcpex") && algo.compare("pomcpex"));
     AIToolbox::POMDP::PAMCP<decltype(model)> solver( model, beliefSize, steps, exp, with_tree, with_exact_belief);
+    if (threads > 1 && parallel.compare("sessions")) {
+      eval_threads = 1;
+      std::cout << current_time_str() << " - Running " << parallel << "-parallel search on " << threads << " threads\n" << std::flush;
+      solver.setParallelism((parallel.compare("tree") ? AIToolbox::POMDP::PAMCP<decltype(model)>::Parallelism::Root : AIToolbox::POMDP::PAMCP<decltype(model)>::Parallelism::Tree), threads);
+    }
+    if (budget > 0) {
+      std::cout << current_time_str() << " - Planning for " << budget << "ms per decision\n" << std::flush;
+      solver.setTimeBudget(std::chrono::microseconds((long long)(budget * 1000)));
+    }
+    if (prune > 0 && with_exact_belief) {
+      std::cout << current_time_str() << " - Pruning environments below " << prune << " from the beliefs\n" << std::flush;
+      solver.setPruneThreshold(prune);
+    }
+    if (!decision_log.empty() && decision_log.compare("none")) {
+      // One line per decision: CSV for a .csv file, JSON otherwise
+      bool csv = (decision_log.size() > 4 && !decision_log.compare(decision_log.size() - 4, 4, ".csv"));
+      auto log = std::make_shared<AIToolbox::POMDP::DecisionLog>(decision_log, (csv ? AIToolbox::POMDP::DecisionLog::Format::CSV : AIToolbox::POMDP::DecisionLog::Format::JSON));
+      assert(("Could not open the decision log", log->good()));
+      std::cout << current_time_str() << " - Logging decisions to " << decision_log << "\n" << std::flush;
+      solver.setDecisionLog(log);
+    }
     training_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000000.;
     start = std::chrono::high_resolution_clock::now();
     std::cout << current_time_str() << " - Starting evaluation!\n" << std::flush;
     std::cout << std::flush;
     std::cerr << std::flush;
     if (has_test) {
-      evaluate_from_file(datafile_base + ".test", model, solver, horizon, verbose);
+      evaluate_from_file(datafile_base + ".test", model, solver, horizon, verbose, true, eval_threads);
     } else {
-      evaluate_interactive(1200, model, solver, horizon, verbose);
+      evaluate_interactive(1200, model, solver, horizon, verbose, false, 400, eval_threads);
     }
     std::cout << current_time_str() << " - 996 evaluations done\n" << std::flush;
+    if (with_exact_belief) {
+      auto & cache = solver.getBeliefCache();
+      std::cout << current_time_str() << " - Belief cache: " << cache.getHits() << " hits, " << cache.getMisses() << " misses (" << 100 * cache.getHitRate() << "%)\n" << std::flush;
+    }
     testing_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000000.;
   }
   // PBVI
   else if (!algo.compare("pbvi")) {
     AIToolbox::POMDP::PBVI solver(beliefSize, horizon, epsilon);
+    if (threads > 1) {
+      std::cout << current_time_str() << " - Running parallel backups on " << threads << " threads\n" << std::flush;
+    }
+    if (memory.compare("full")) {
+      std::cout << current_time_str() << " - Keeping the values of the last two horizons only (" << memory << ")\n" << std::flush;
+    }
     if (!verbose) {std::cerr.setstate(std::ios_base::failbit);}
-    auto solution = solver(model);
+    // The threads share the backups of each timestep, then evaluate sessions
+    // Older horizons are only followed as a policy graph, or not at all
+    auto memory_mode = (!memory.compare("graph") ? AIToolbox::POMDP::PBVI::Memory::Graph : (!memory.compare("last") ? AIToolbox::POMDP::PBVI::Memory::Last : AIToolbox::POMDP::PBVI::Memory::Full));
+    auto solution = solver(model, threads, memory_mode);
     if (!verbose) {std::cerr.clear();}
     std::cout << "\n" << current_time_str() << " - Convergence criterion reached: " << std::boolalpha << std::get<0>(solution) << "\n" << std::flush;
     int horizon_reached = std::get<2>(solution);
@@ -74,13 +111,13 @@ void mainMEMDP(M model, std::string datafile_base, std::string algo, int horizon
     // Build and Evaluate Policy
     start = std::chrono::high_resolution_clock::now();
     std::cout << "\n" << current_time_str() << " - Starting evaluation!\n" << std::flush;
-    AIToolbox::POMDP::Policy policy(model.getS(), model.getA(), model.getO(), std::get<1>(solution));
+    AIToolbox::POMDP::BlockPolicy policy(model.getA(), std::move(std::get<1>(solution)));
     std::cout << std::flush;
     std::cerr << std::flush;
     if (has_test) {
-      evaluate_from_file(datafile_base + ".test", model, policy, horizon_reached, verbose);
+      evaluate_from_file(datafile_base + ".test", model, policy, horizon_reached, verbose, true, eval_threads);
     } else {
-      evaluate_interactive(5000, model, policy, horizon_reached, verbose);
+      evaluate_interactive(5000, model, policy, horizon_reached, verbose, false, 400, eval_threads);
     }
     testing_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000000.;
   }
@@ -97,8 +134,31 @@ void mainMEMDP(M model, std::string datafile_base, std::string algo, int horizon
  */
 int main(int argc, char* argv[]) {
 
+  // Options which may appear anywhere: --threads N (or --threads=N) overrides the positional number of threads,
+  // --memory MODE (or --memory=MODE) sets what PBVI keeps of the older horizons (full, graph or last)
+  int threads_option = 0;
+  std::string memory = "full";
+  std::vector<char*> args;
+  for (int i = 0; i < argc; i++) {
+    std::string arg = argv[i];
+    if (!arg.compare(0, 10, "--threads=")) {
+      threads_option = std::atoi(arg.c_str() + 10);
+    } else if (!arg.compare("--threads") && i + 1 < argc) {
+      threads_option = std::atoi(argv[++i]);
+    } else if (!arg.compare(0, 9, "--memory=")) {
+      memory = arg.substr(9);
+    } else if (!arg.compare("--memory") && i + 1 < argc) {
+      memory = argv[++i];
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  argc = args.size();
+  argv = args.data();
+
   // Parse input arguments
-  assert(("Usage: ./main file_basename data_mode [solver] [discount] [nsteps] [precision]", argc >= 3));
+  assert(("Usage: ./main file_basename data_mode [solver] [discount] [nsteps] [horizon] [epsilon] [exploration] [beliefsize] [precision] [verbose] [threads] [parallel] [seed] [decision_log] [budget_ms] [prune] [--threads N] [--memory full|graph|last]", argc >= 3));
+  assert(("Unvalid memory mode", !(memory.compare("full") && memory.compare("graph") && memory.compare("last"))));
   std::string data = argv[2];
   assert(("Unvalid data mode", !(data.compare("reco") && data.compare("maze"))));
   std::string algo = ((argc > 3) ? argv[3] : "pbvi");
@@ -118,24 +178,55 @@ int main(int argc, char* argv[]) {
   assert(("Unvalid belief size", beliefSize >= 0));
   bool precision = ((argc > 10) ? (atoi(argv[10]) == 1) : false);
   bool verbose = ((argc > 11) ? (atoi(argv[11]) == 1) : false);
+  int threads = ((threads_option > 0) ? threads_option : ((argc > 12) ? std::atoi(argv[12]) : 1));
+  assert(("Unvalid number of threads", threads > 0));
+  std::string parallel = ((argc > 13) ? argv[13] : "root");
+  std::transform(parallel.begin(), parallel.end(), parallel.begin(), ::tolower);
+  assert(("Unvalid parallel mode", !(parallel.compare("root") && parallel.compare("tree") && parallel.compare("sessions"))));
+  // Master seed for all random engines (0 = seed from the current time)
+  unsigned seed = ((argc > 14) ? std::strtoul(argv[14], NULL, 10) : 0);
+  if (seed) {
+    std::cout << current_time_str() << " - Using master seed " << seed << "\n";
+    Model::set_master_seed(seed);
+    AIToolbox::Impl::Seeder::setRootSeed(seed);
+  }
+
+  // Per-decision PAMCP measurements (none = disabled)
+  std::string decision_log = ((argc > 15) ? argv[15] : "none");
+  // PAMCP wall-clock budget per decision, replacing the number of steps (0 = disabled)
+  double budget = ((argc > 16) ? std::atof(argv[16]) : 0);
+  assert(("Unvalid time budget", budget >= 0));
+  // PAMCP exact beliefs: probability below which environments are dropped (0 = only impossible ones)
+  double prune = ((argc > 17) ? std::atof(argv[17]) : 0);
+  assert(("Unvalid pruning threshold", prune >= 0 && prune < 1));
 
   // Create model
   std::string datafile_base = std::string(argv[1]);
   std::cout << "\n" << current_time_str() << " - Loading appropriate model\n";
   if (!data.compare("reco")) {
     Recomodel model (datafile_base + ".summary", discount, false);
-    model.load_rewards(datafile_base + ".rewards");
-    model.load_transitions(datafile_base + ".transitions", precision, precision, datafile_base + ".profiles");
-    mainMEMDP(model, datafile_base, algo, horizon, steps, epsilon, beliefSize, exp, precision, verbose, true);
+    if (ModelFile::is_model_file(datafile_base + ".bin")) {
+      std::cout << current_time_str() << " - Mapping binary model " << datafile_base << ".bin\n";
+      model.load_binary(datafile_base + ".bin");
+    } else {
+      model.load_rewards(datafile_base + ".rewards");
+      model.load_transitions(datafile_base + ".transitions", precision, precision, datafile_base + ".profiles");
+    }
+    mainMEMDP(model, datafile_base, algo, horizon, steps, epsilon, beliefSize, exp, precision, verbose, true, threads, parallel, decision_log, budget, prune, memory);
   } else if (!data.compare("maze")) {
     if (discount < 1) {
       std::cout << "Setting undiscounted model";
       discount = 1.;
     }
     Mazemodel model(datafile_base + ".summary", discount);
-    model.load_rewards(datafile_base + ".rewards");
-    model.load_transitions(datafile_base + ".transitions", precision, precision, verbose);
-    mainMEMDP(model, datafile_base, algo, horizon, steps, epsilon, beliefSize, exp, precision, verbose, false);
+    if (ModelFile::is_model_file(datafile_base + ".bin")) {
+      std::cout << current_time_str() << " - Mapping binary model " << datafile_base << ".bin\n";
+      model.load_binary(datafile_base + ".bin");
+    } else {
+      model.load_rewards(datafile_base + ".rewards");
+      model.load_transitions(datafile_base + ".transitions", precision, precision, verbose);
+    }
+    mainMEMDP(model, datafile_base, algo, horizon, steps, epsilon, beliefSize, exp, precision, verbose, false, threads, parallel, decision_log, budget, prune, memory);
   }
   return 0;
 
@@ -0,0 +1,108 @@
+/* ---------------------------------------------------------------------------
+** main_bench.cpp
+** Microbenchmark of the models' transition sampling: compares the alias
+** table sampler (sampleSR) to the std::discrete_distribution reference
+** (sampleSR_discrete), in samples per second.
+**
+** Author: Amelie Royer
+** Email: amelie.royer@ist.ac.at
+** -------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <tuple>
+#include <chrono>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <map>
+#include "mazemodel.hpp"
+#include "recomodel.hpp"
+
+
+/*! \brief Times n calls of a sampler over a fixed list of (state, action) queries.
+ *
+ * \return samples per second, and a checksum of the sampled states to keep the loop alive.
+ */
+template <typename F>
+std::pair<double, size_t> time_sampler(F sampler, const std::vector<std::pair<size_t, size_t> > &queries, size_t n) {
+  size_t checksum = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < n; i++) {
+    auto &q = queries[i % queries.size()];
+    checksum += std::get<0>(sampler(q.first, q.second));
+  }
+  double t = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000000.;
+  return std::make_pair(n / t, checksum);
+}
+
+
+/*! \brief Compares both samplers on the given model: speed, then total variation
+ * between their empirical distributions on a few transition rows.
+ */
+template <typename M>
+void bench(const M& model, size_t n) {
+  // Random queries on non-terminal transition rows (skip unreachable walls with empty rows)
+  std::default_random_engine generator(42);
+  std::uniform_int_distribution<size_t> states(0, model.getS() - 1), actions(0, model.getA() - 1);
+  std::vector<std::pair<size_t, size_t> > queries;
+  while (queries.size() < 4096) {
+    size_t s = states(generator), a = actions(generator);
+    if (model.isTerminal(s) || model.isInitial(s)) {
+      continue;
+    }
+    double mass = 0.;
+    std::vector<size_t> next = model.reachable_states(s);
+    for (auto it = next.begin(); it != next.end(); ++it) {
+      mass += model.getTransitionProbability(s, a, *it);
+    }
+    if (mass > 0) {
+      queries.push_back(std::make_pair(s, a));
+    }
+  }
+
+  auto reference = time_sampler([&model](size_t s, size_t a) { return model.sampleSR_discrete(s, a, Model::thread_generator()); }, queries, n);
+  auto alias = time_sampler([&model](size_t s, size_t a) { return model.sampleSR(s, a, Model::thread_generator()); }, queries, n);
+  std::cout << "   > discrete_distribution : " << reference.first << " samples/s\n";
+  std::cout << "   > alias table           : " << alias.first << " samples/s\n";
+  std::cout << "   > speedup               : " << alias.first / reference.first << "x\n";
+
+  // Sanity check of the sampled distributions
+  double tv = 0.;
+  size_t rows = 16, per_row = 100000;
+  for (size_t q = 0; q < rows; q++) {
+    std::map<size_t, double> freq;
+    for (size_t i = 0; i < per_row; i++) {
+      freq[std::get<0>(model.sampleSR_discrete(queries[q].first, queries[q].second, generator))] += 1.0 / per_row;
+      freq[std::get<0>(model.sampleSR(queries[q].first, queries[q].second, generator))] -= 1.0 / per_row;
+    }
+    for (auto it = freq.begin(); it != freq.end(); ++it) {
+      tv += std::abs(it->second) / (2 * rows);
+    }
+  }
+  std::cout << "   > mean total variation  : " << tv << " over " << rows << " rows\n";
+}
+
+
+/**
+ * MAIN ROUTINE
+ */
+int main(int argc, char* argv[]) {
+  assert(("Usage: ./mainBench file_basename data_mode [nsamples]", argc >= 3));
+  std::string datafile_base = std::string(argv[1]);
+  std::string data = argv[2];
+  assert(("Unvalid data mode", !(data.compare("reco") && data.compare("maze"))));
+  size_t n = ((argc > 3) ? std::atol(argv[3]) : 10000000);
+
+  if (!data.compare("reco")) {
+    Recomodel model (datafile_base + ".summary", 0.95, false);
+    model.load_rewards(datafile_base + ".rewards");
+    model.load_transitions(datafile_base + ".transitions", false, false, datafile_base + ".profiles");
+    bench(model, n);
+  } else {
+    Mazemodel model(datafile_base + ".summary", 1.0);
+    model.load_rewards(datafile_base + ".rewards");
+    model.load_transitions(datafile_base + ".transitions", false, false, false);
+    bench(model, n);
+  }
+  return 0;
+}
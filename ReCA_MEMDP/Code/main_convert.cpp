@@ -0,0 +1,66 @@
+/* ---------------------------------------------------------------------------
+** main_convert.cpp
+** One-off conversion of a text model (.summary, .rewards, .transitions(.gz))
+** to the binary model format of modelfile.hpp. mainMEMDP maps the resulting
+** file_basename.bin instead of parsing the text files when it exists.
+**
+** Author: Amelie Royer
+** Email: amelie.royer@ist.ac.at
+** -------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <chrono>
+#include <cassert>
+#include "mazemodel.hpp"
+#include "recomodel.hpp"
+
+
+/*! \brief Saves the loaded model, then maps it back into an empty model built from the same summary to check the round trip.
+ */
+template <typename M>
+void convert(const M& model, M& mapped, std::string bfile) {
+  model.save_binary(bfile);
+  std::cout << "   -> Wrote " << bfile << "\n";
+
+  auto start = std::chrono::steady_clock::now();
+  mapped.load_binary(bfile);
+  double t = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.;
+  for (size_t s = 0; s < model.getS(); s++) {
+    for (size_t a = 0; a < model.getA(); a++) {
+      std::vector<size_t> next = model.reachable_states(s);
+      for (auto it = next.begin(); it != next.end(); ++it) {
+	assert(("Binary model differs from the text model",
+		model.getTransitionProbability(s, a, *it) == mapped.getTransitionProbability(s, a, *it) &&
+		model.getExpectedReward(s, a, *it) == mapped.getExpectedReward(s, a, *it)));
+      }
+    }
+  }
+  std::cout << "   -> Checked, mapped in " << t << "ms\n";
+}
+
+
+/**
+ * MAIN ROUTINE
+ */
+int main(int argc, char* argv[]) {
+  assert(("Usage: ./mainConvert file_basename data_mode [precision]", argc >= 3));
+  std::string datafile_base = std::string(argv[1]);
+  std::string data = argv[2];
+  assert(("Unvalid data mode", !(data.compare("reco") && data.compare("maze"))));
+  bool precision = ((argc > 3) ? std::atoi(argv[3]) == 1 : false);
+
+  if (!data.compare("reco")) {
+    Recomodel model (datafile_base + ".summary", 0.95, false);
+    model.load_rewards(datafile_base + ".rewards");
+    model.load_transitions(datafile_base + ".transitions", precision, precision, datafile_base + ".profiles");
+    Recomodel mapped (datafile_base + ".summary", 0.95, false);
+    convert(model, mapped, datafile_base + ".bin");
+  } else {
+    Mazemodel model(datafile_base + ".summary", 1.0);
+    model.load_rewards(datafile_base + ".rewards");
+    model.load_transitions(datafile_base + ".transitions", precision, precision, false);
+    Mazemodel mapped(datafile_base + ".summary", 1.0);
+    convert(model, mapped, datafile_base + ".bin");
+  }
+  return 0;
+}
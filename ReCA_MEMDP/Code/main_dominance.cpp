@@ -0,0 +1,118 @@
+/* ---------------------------------------------------------------------------
+** main_dominance.cpp
+** Microbenchmark of the dominance pruning of alpha vectors: compares the
+** sorted bitset filter (extractDominated) to the pairwise reference
+** (extractDominatedPairwise) on random VLists, and checks that both keep
+** the same vectors in the same order.
+**
+** Author: Amelie Royer
+** Email: amelie.royer@ist.ac.at
+** -------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <tuple>
+#include <chrono>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <string>
+#include <AIToolbox/POMDP/Types.hpp>
+#include <AIToolbox/POMDP/Utils.hpp>
+#include <AIToolbox/Impl/ThreadPool.hpp>
+
+using namespace AIToolbox;
+
+
+/*! \brief Generates a VList of n alpha vectors over S states.
+ *
+ * "uniform" draws each value independently, "clustered" perturbs a few
+ * coordinates of a handful of base vectors, as the cross-sums of a
+ * solver do, and both copy earlier vectors to create duplicates.
+ */
+POMDP::VList generate(const std::string &kind, size_t n, size_t S, std::default_random_engine &generator) {
+  std::uniform_real_distribution<double> uniform(0., 1.);
+  std::vector<MDP::Values> bases(32, MDP::Values(S));
+  for (auto &base : bases) {
+    for (size_t s = 0; s < S; s++) {
+      base[s] = uniform(generator);
+    }
+  }
+  POMDP::VList w;
+  w.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    MDP::Values v(S);
+    if (i > 0 && generator() % 10 == 0) {
+      v = std::get<POMDP::VALUES>(w[generator() % i]);
+    } else if (!kind.compare("uniform")) {
+      for (size_t s = 0; s < S; s++) {
+        v[s] = uniform(generator);
+      }
+    } else {
+      v = bases[generator() % bases.size()];
+      for (size_t k = 0; k < 4; k++) {
+        v[generator() % S] += (uniform(generator) - 0.8) * 0.1;
+      }
+    }
+    w.emplace_back(v, i % 4, POMDP::VObs(1, i));
+  }
+  return w;
+}
+
+
+/*! \brief Times an in-place pruning of a copy of w.
+ *
+ * \return the time in seconds, and the vectors kept.
+ */
+template <typename F>
+std::pair<double, POMDP::VList> time_pruning(F prune, const POMDP::VList &w) {
+  POMDP::VList copy = w;
+  auto start = std::chrono::high_resolution_clock::now();
+  copy.erase(prune(copy), copy.end());
+  double t = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000000.;
+  return std::make_pair(t, std::move(copy));
+}
+
+
+/*! \brief Returns true if both lists hold the same vectors, in the same order.
+ */
+bool same(const POMDP::VList &lhs, const POMDP::VList &rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < lhs.size(); i++) {
+    if (std::get<POMDP::OBS>(lhs[i]) != std::get<POMDP::OBS>(rhs[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+/**
+ * MAIN ROUTINE
+ */
+int main(int argc, char* argv[]) {
+  assert(("Usage: ./mainDominance [nvectors] [nthreads]", argc >= 1));
+  size_t n = ((argc > 1) ? std::atol(argv[1]) : 10000);
+  size_t threads = ((argc > 2) ? std::atol(argv[2]) : 1);
+  Impl::ThreadPool pool(threads);
+  std::default_random_engine generator(42);
+
+  for (auto kind : {"uniform", "clustered"}) {
+    for (size_t S : {8, 64, 512}) {
+      POMDP::VList w = generate(kind, n, S, generator);
+      auto reference = time_pruning([S](POMDP::VList &v) { return POMDP::extractDominatedPairwise(S, v.begin(), v.end()); }, w);
+      auto sorted = time_pruning([S](POMDP::VList &v) { return POMDP::extractDominated(S, v.begin(), v.end()); }, w);
+      auto parallel = time_pruning([S, &pool](POMDP::VList &v) { return POMDP::extractDominated(S, v.begin(), v.end(), &pool); }, w);
+      std::cout << "   > " << kind << ", " << n << " vectors, S = " << S << ": " << reference.second.size() << " kept\n";
+      std::cout << "     pairwise             : " << reference.first << "s\n";
+      std::cout << "     sorted               : " << sorted.first << "s (" << reference.first / sorted.first << "x)\n";
+      std::cout << "     sorted, " << threads << " thread(s) : " << parallel.first << "s (" << reference.first / parallel.first << "x)\n";
+      if (!same(reference.second, sorted.second) || !same(reference.second, parallel.second)) {
+        std::cerr << "Mismatch with the pairwise pruning!\n";
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
@@ -14,11 +14,7 @@
 #include <algorithm>
 #include <ctime>
 #include <cmath>
-
-/**
- * RANDOM ENGINE
- */
-std::default_random_engine Mazemodel::generator(time(NULL));
+#include <numeric>
 
 /**
  * INDEX
@@ -28,6 +24,13 @@ int Mazemodel::index(size_t env, size_t s, size_t a, size_t link) const {
   return link + n_links * (a + n_actions * (s - 3 + (n_observations - 3) * env));
 }
 
+/**
+ * LINK_INDEX
+ */
+size_t Mazemodel::link_index(size_t s, size_t link) const {
+  return link + n_links * (get_rep(s) - 3 + (n_observations - 3) * get_env(s));
+}
+
 /**
  * STATE_TO_ID
  */
@@ -86,29 +89,21 @@ std::string Mazemodel::state_to_string(size_t s) const{
  * ISGOAL
  */
 bool Mazemodel::isGoal(size_t state) const{
-  int env = get_env(state);
-  return std::find(goal_states.at(env).begin(), goal_states.at(env).end(), state) != goal_states.at(env).end();
+  return goal_set[state];
 }
 
 /**
  * ISSTARTING
  */
 bool Mazemodel::isStarting(size_t state) const {
-  int env = get_env(state);
-  return std::find(starting_states.at(env).begin(), starting_states.at(env).end(), state) != starting_states.at(env).end();
+  return start_set[state];
 }
 
 /**
  * ISTRAP
  */
 bool Mazemodel::isTrap(size_t state) const {
-  int env = get_env(state);
-  for (int a = 0; a < n_actions; a++) {
-    if (transition_matrix[index(env, get_rep(state), a, trap_link)] > 0) {
-      return true;
-    }
-  }
-  return false;
+  return trap_set[state];
 }
 
 /**
@@ -253,6 +248,11 @@ size_t Mazemodel::next_state(size_t s, size_t link) const {
 	y = ((y > min_y) ? y - 1 : min_y);
       }
     }
+    // Drifts, matching is_connected
+    else {
+      x = ((link == 3 || link == 4) ? ((x < max_x) ? x + 1 : max_x) : ((x > min_x) ? x - 1 : min_x));
+      y = ((link == 3 || link == 5) ? ((y < max_y) ? y + 1 : max_y) : ((y > min_y) ? y - 1 : min_y));
+    }
     return get_env(s) * n_observations + state_to_id(x, y, orientation);
   }
 }
@@ -302,7 +302,10 @@ Mazemodel::Mazemodel(std::string sfile, double discount_) {
   n_actions = 3;  // Left, Right, Forward
   n_observations = 3 + (max_x - min_x + 1) * (max_y - min_y + 1) * 4;
   n_states = n_environments * n_observations;
-  transition_matrix = new double[n_environments * (n_observations - 3) * n_actions * n_links]();
+  transition_matrix = nullptr; // allocated by load_transitions, or mapped by load_binary
+  goal_set.assign(n_states, false);
+  start_set.assign(n_states, false);
+  trap_set.assign(n_states, false);
 
 
   //********** Summary of model parameters
@@ -442,12 +445,17 @@ void Mazemodel::load_rewards(std::string rfile) {
     // Add state to the list of goal states
     if (!isGoal(sg)) {
       goal_states.at(env).push_back(sg);
+      goal_set[sg] = true;
       std::vector <double> aux2 (n_actions, 0);
       goal_rewards[sg] = aux2;
     }
     goal_rewards.at(sg).at(string_to_action(a)) = v;
   }
   infile.close();
+  // Goal transitions changed
+  if (topology_ready) {
+    compile_topology();
+  }
 }
 
 /**
@@ -461,6 +469,7 @@ void Mazemodel::load_transitions(std::string tfile, bool precision /* =false */,
   int x, y, env = 0;
   char o;
   double v;
+  transition_matrix = new double[n_environments * (n_observations - 3) * n_actions * n_links]();
 
   // Load transitions
   infile.open(tfile, std::ios::in);
@@ -498,6 +507,7 @@ void Mazemodel::load_transitions(std::string tfile, bool precision /* =false */,
       // Add state to the list of starting states
       if (! isStarting(s)) {
 	starting_states.at(env).push_back(s);
+	start_set[s] = true;
       }
       continue;
     }
@@ -561,6 +571,7 @@ void Mazemodel::load_transitions(std::string tfile, bool precision /* =false */,
       }
     }
   }
+  compile_topology();
   // Print the resulting maze for debugging purposes
   if (verbose) {
     print_maze();
@@ -568,10 +579,248 @@ void Mazemodel::load_transitions(std::string tfile, bool precision /* =false */,
 }
 
 
+/**
+ * COMPILE_TOPOLOGY
+ */
+void Mazemodel::compile_topology() {
+  size_t n_inner = n_environments * (n_observations - 3);
+  // Trap states and link targets
+  trap_set.assign(n_states, false);
+  link_targets.resize(n_inner * n_links);
+  for (size_t env = 0; env < n_environments; env++) {
+    for (size_t o = 3; o < n_observations; o++) {
+      size_t s = env * n_observations + o;
+      for (size_t a = 0; a < n_actions; a++) {
+	if (transition_matrix[index(env, o, a, trap_link)] > 0) {
+	  trap_set[s] = true;
+	}
+      }
+      for (size_t link = 0; link < n_links; link++) {
+	link_targets[link_index(s, link)] = next_state(s, link);
+      }
+    }
+  }
+  transition_alias.build(transition_matrix, n_inner * n_actions, n_links);
+
+  // Successors of each (state, action)
+  succ_offsets.assign(n_states * n_actions + 1, 0);
+  succ_states.clear();
+  succ_probs.clear();
+  for (size_t s = 0; s < n_states; s++) {
+    size_t env = get_env(s), o = get_rep(s);
+    for (size_t a = 0; a < n_actions; a++) {
+      size_t first = succ_states.size();
+      if (o == S) {
+	if (env < starting_states.size()) {
+	  for (auto it = starting_states.at(env).begin(); it != starting_states.at(env).end(); ++it) {
+	    succ_states.push_back(*it);
+	    succ_probs.push_back(1.0 / starting_states.at(env).size());
+	  }
+	}
+      } else if (o == G || o == T) {
+	succ_states.push_back(s);
+	succ_probs.push_back(1.0);
+      } else {
+	for (size_t link = 0; link < n_links; link++) {
+	  if (transition_matrix[index(env, o, a, link)] <= 0) {
+	    continue;
+	  }
+	  // Several links may lead to the same state (e.g. moving into a border)
+	  size_t s2 = link_targets[link_index(s, link)];
+	  if (std::find(succ_states.begin() + first, succ_states.end(), s2) != succ_states.end()) {
+	    continue;
+	  }
+	  double p = link_transition_probability(s, a, s2);
+	  if (p > 0) {
+	    succ_states.push_back(s2);
+	    succ_probs.push_back(p);
+	  }
+	}
+      }
+      succ_offsets[s * n_actions + a + 1] = succ_states.size();
+    }
+  }
+
+  // Predecessors of each (state, action), by inverting the successors
+  pred_offsets.assign(n_states * n_actions + 1, 0);
+  for (size_t s = 0; s < n_states; s++) {
+    for (size_t a = 0; a < n_actions; a++) {
+      for (size_t i = succ_offsets[s * n_actions + a]; i < succ_offsets[s * n_actions + a + 1]; i++) {
+	pred_offsets[succ_states[i] * n_actions + a + 1]++;
+      }
+    }
+  }
+  std::partial_sum(pred_offsets.begin(), pred_offsets.end(), pred_offsets.begin());
+  pred_states.resize(succ_states.size());
+  pred_probs.resize(succ_states.size());
+  std::vector<size_t> fill(pred_offsets.begin(), pred_offsets.end() - 1);
+  for (size_t s = 0; s < n_states; s++) {
+    for (size_t a = 0; a < n_actions; a++) {
+      for (size_t i = succ_offsets[s * n_actions + a]; i < succ_offsets[s * n_actions + a + 1]; i++) {
+	size_t j = fill[succ_states[i] * n_actions + a]++;
+	pred_states[j] = s;
+	pred_probs[j] = succ_probs[i];
+      }
+    }
+  }
+
+  // Successors of each state for any action
+  reach_offsets.assign(1, 0);
+  reach_states.clear();
+  for (size_t s = 0; s < n_states; s++) {
+    size_t first = reach_states.size();
+    reach_states.insert(reach_states.end(), succ_states.begin() + succ_offsets[s * n_actions], succ_states.begin() + succ_offsets[(s + 1) * n_actions]);
+    std::sort(reach_states.begin() + first, reach_states.end());
+    reach_states.erase(std::unique(reach_states.begin() + first, reach_states.end()), reach_states.end());
+    reach_offsets.push_back(reach_states.size());
+  }
+
+  // Predecessors of each observation in any environment
+  prevobs_offsets.assign(1, 0);
+  prevobs.clear();
+  for (size_t o = 0; o < n_observations; o++) {
+    size_t first = prevobs.size();
+    for (size_t env = 0; env < n_environments; env++) {
+      size_t s = env * n_observations + o;
+      for (size_t i = pred_offsets[s * n_actions]; i < pred_offsets[(s + 1) * n_actions]; i++) {
+	prevobs.push_back(get_rep(pred_states[i]));
+      }
+    }
+    std::sort(prevobs.begin() + first, prevobs.end());
+    prevobs.erase(std::unique(prevobs.begin() + first, prevobs.end()), prevobs.end());
+    prevobs_offsets.push_back(prevobs.size());
+  }
+  topology_ready = true;
+}
+
+namespace {
+  /*! \brief Flattens per-environment lists of states as (offsets, states).
+   */
+  void flatten(const std::vector<std::vector<size_t> >& lists, std::vector<uint64_t>& offsets, std::vector<uint64_t>& states) {
+    offsets.assign(1, 0);
+    for (auto it = lists.begin(); it != lists.end(); ++it) {
+      states.insert(states.end(), it->begin(), it->end());
+      offsets.push_back(states.size());
+    }
+  }
+
+  std::vector<std::vector<size_t> > unflatten(const ModelFile& file, ModelSection offsets_id, ModelSection states_id) {
+    std::vector<size_t> offsets = file.copy<size_t, uint64_t>(offsets_id), states = file.copy<size_t, uint64_t>(states_id);
+    std::vector<std::vector<size_t> > lists;
+    for (size_t i = 0; i + 1 < offsets.size(); i++) {
+      lists.push_back(std::vector<size_t>(states.begin() + offsets[i], states.begin() + offsets[i + 1]));
+    }
+    return lists;
+  }
+}
+
+/**
+ * LOAD_BINARY
+ */
+void Mazemodel::load_binary(std::string bfile) {
+  mapping = std::make_shared<const ModelFile>(bfile, MODEL_MAZE);
+  const ModelFile& file = *mapping;
+  const int64_t* dims = file.get<int64_t>(SECTION_DIMS, 5);
+  assert(("Binary model does not match the .summary file",
+	  dims[0] == min_x && dims[1] == max_x && dims[2] == min_y && dims[3] == max_y && dims[4] == n_environments));
+  size_t n_inner = n_environments * (n_observations - 3);
+
+  // Large arrays are used in place
+  transition_matrix = const_cast<double*>(file.get<double>(SECTION_TRANSITIONS, n_inner * n_actions * n_links));
+  transition_alias.attach(file.get<double>(SECTION_ALIAS_PROB, n_inner * n_actions * n_links),
+			  file.get<uint32_t>(SECTION_ALIAS_INDEX, n_inner * n_actions * n_links), n_links);
+
+  // Rewards and special states
+  goal_states = unflatten(file, SECTION_GOAL_OFFSETS, SECTION_GOAL_STATES);
+  starting_states = unflatten(file, SECTION_START_OFFSETS, SECTION_START_STATES);
+  const double* goal_values = file.get<double>(SECTION_GOAL_REWARDS, file.count(SECTION_GOAL_STATES) * n_actions);
+  goal_rewards.clear();
+  for (auto it = goal_states.begin(); it != goal_states.end(); ++it) {
+    for (auto sg = it->begin(); sg != it->end(); ++sg, goal_values += n_actions) {
+      goal_rewards[*sg] = std::vector<double>(goal_values, goal_values + n_actions);
+    }
+  }
+  goal_set = file.copy<bool, uint8_t>(SECTION_GOAL_SET);
+  start_set = file.copy<bool, uint8_t>(SECTION_START_SET);
+  trap_set = file.copy<bool, uint8_t>(SECTION_TRAP_SET);
+  assert(("Binary model does not match the .summary file", goal_set.size() == n_states));
+
+  // Compiled topology
+  link_targets = file.copy<size_t, uint64_t>(SECTION_LINK_TARGETS);
+  succ_offsets = file.copy<size_t, uint64_t>(SECTION_SUCC_OFFSETS);
+  succ_states = file.copy<size_t, uint64_t>(SECTION_SUCC_STATES);
+  succ_probs = file.copy<double>(SECTION_SUCC_PROBS);
+  pred_offsets = file.copy<size_t, uint64_t>(SECTION_PRED_OFFSETS);
+  pred_states = file.copy<size_t, uint64_t>(SECTION_PRED_STATES);
+  pred_probs = file.copy<double>(SECTION_PRED_PROBS);
+  reach_offsets = file.copy<size_t, uint64_t>(SECTION_REACH_OFFSETS);
+  reach_states = file.copy<size_t, uint64_t>(SECTION_REACH_STATES);
+  prevobs_offsets = file.copy<size_t, uint64_t>(SECTION_PREVOBS_OFFSETS);
+  prevobs = file.copy<size_t, uint64_t>(SECTION_PREVOBS);
+  topology_ready = true;
+}
+
+/**
+ * SAVE_BINARY
+ */
+void Mazemodel::save_binary(std::string bfile) const {
+  assert(("Transitions must be loaded before saving", topology_ready));
+  static_assert(sizeof(size_t) == sizeof(uint64_t), "model files store 64 bits indices");
+  size_t n_inner = n_environments * (n_observations - 3);
+  std::vector<int64_t> dims = {min_x, max_x, min_y, max_y, (int64_t) n_environments};
+  std::vector<uint64_t> goal_offsets, goal_list, start_offsets, start_list;
+  flatten(goal_states, goal_offsets, goal_list);
+  flatten(starting_states, start_offsets, start_list);
+  std::vector<double> goal_values;
+  for (auto it = goal_list.begin(); it != goal_list.end(); ++it) {
+    goal_values.insert(goal_values.end(), goal_rewards.at(*it).begin(), goal_rewards.at(*it).end());
+  }
+  std::vector<uint8_t> goals(goal_set.begin(), goal_set.end()), starts(start_set.begin(), start_set.end()), traps(trap_set.begin(), trap_set.end());
+
+  ModelFileWriter writer(MODEL_MAZE);
+  writer.add(SECTION_DIMS, dims);
+  writer.add(SECTION_TRANSITIONS, transition_matrix, n_inner * n_actions * n_links);
+  writer.add(SECTION_ALIAS_PROB, transition_alias.probabilities(), n_inner * n_actions * n_links);
+  writer.add(SECTION_ALIAS_INDEX, transition_alias.aliases(), n_inner * n_actions * n_links);
+  writer.add(SECTION_GOAL_OFFSETS, goal_offsets);
+  writer.add(SECTION_GOAL_STATES, goal_list);
+  writer.add(SECTION_GOAL_REWARDS, goal_values);
+  writer.add(SECTION_START_OFFSETS, start_offsets);
+  writer.add(SECTION_START_STATES, start_list);
+  writer.add(SECTION_GOAL_SET, goals);
+  writer.add(SECTION_START_SET, starts);
+  writer.add(SECTION_TRAP_SET, traps);
+  writer.add(SECTION_LINK_TARGETS, reinterpret_cast<const uint64_t*>(link_targets.data()), link_targets.size());
+  writer.add(SECTION_SUCC_OFFSETS, reinterpret_cast<const uint64_t*>(succ_offsets.data()), succ_offsets.size());
+  writer.add(SECTION_SUCC_STATES, reinterpret_cast<const uint64_t*>(succ_states.data()), succ_states.size());
+  writer.add(SECTION_SUCC_PROBS, succ_probs);
+  writer.add(SECTION_PRED_OFFSETS, reinterpret_cast<const uint64_t*>(pred_offsets.data()), pred_offsets.size());
+  writer.add(SECTION_PRED_STATES, reinterpret_cast<const uint64_t*>(pred_states.data()), pred_states.size());
+  writer.add(SECTION_PRED_PROBS, pred_probs);
+  writer.add(SECTION_REACH_OFFSETS, reinterpret_cast<const uint64_t*>(reach_offsets.data()), reach_offsets.size());
+  writer.add(SECTION_REACH_STATES, reinterpret_cast<const uint64_t*>(reach_states.data()), reach_states.size());
+  writer.add(SECTION_PREVOBS_OFFSETS, reinterpret_cast<const uint64_t*>(prevobs_offsets.data()), prevobs_offsets.size());
+  writer.add(SECTION_PREVOBS, reinterpret_cast<const uint64_t*>(prevobs.data()), prevobs.size());
+  writer.write(bfile);
+}
+
 /**
  * GET_TRANSITION_PROBABILITY
  */
 double Mazemodel::getTransitionProbability(size_t s1, size_t a, size_t s2) const {
+  StateSpan succ = successors(s1, a);
+  for (size_t i = 0; i < succ.size(); i++) {
+    if (succ[i] == s2) {
+      return succ_probs[succ_offsets[s1 * n_actions + a] + i];
+    }
+  }
+  return 0.;
+}
+
+/**
+ * LINK_TRANSITION_PROBABILITY
+ */
+double Mazemodel::link_transition_probability(size_t s1, size_t a, size_t s2) const {
   // -> S
   if (get_rep(s2) == S) {
     return 0.;
@@ -610,8 +859,8 @@ double Mazemodel::getExpectedReward(size_t s1, size_t a, size_t s2) const {
   }
   // Step (slightly encourage the model to change case rather than changing orientation)
   else if (!(get_rep(s2) == G && isGoal(s1))) {
-    if (is_connected(s1, s2) == 2 || is_connected(s1, s2) == 3 || is_connected(s1, s2) == 4 
-      || is_connected(s1, s2) == 5|| is_connected(s1, s2) == 6) {
+    size_t link = is_connected(s1, s2);
+    if (link >= 2 && link <= 6) {
       return -1.0;
     } else {
       return -2.5;
@@ -626,11 +875,12 @@ double Mazemodel::getExpectedReward(size_t s1, size_t a, size_t s2) const {
 /**
  * SAMPLESR
  */
-std::tuple<size_t, double> Mazemodel::sampleSR(size_t s, size_t a) const {
+std::tuple<size_t, double> Mazemodel::sampleSR(size_t s, size_t a, std::default_random_engine& generator) const {
   // Start state
   if (get_rep(s) == S) {
     int env = get_env(s);
-    size_t s2 = starting_states.at(env).at(rand() % starting_states.at(env).size());
+    std::uniform_int_distribution<size_t> distribution(0, starting_states.at(env).size() - 1);
+    size_t s2 = starting_states.at(env).at(distribution(generator));
     double r = getExpectedReward(s, a, s2);
     return std::make_tuple(s2, r);
   }
@@ -642,14 +892,27 @@ std::tuple<size_t, double> Mazemodel::sampleSR(size_t s, size_t a) const {
   // Others
   else {
     // Sample random transition
-    std::discrete_distribution<int> distribution (&transition_matrix[index(get_env(s), get_rep(s), a, 0)], &transition_matrix[index(get_env(s), get_rep(s), a, n_links)]);
-    size_t link = distribution(generator);
-    size_t s2 = next_state(s, link);
+    size_t link = transition_alias.sample(index(get_env(s), get_rep(s), a, 0) / n_links, generator);
+    size_t s2 = link_targets[link_index(s, link)];
     double r = getExpectedReward(s, a, s2);
     return std::make_tuple(s2, r);
   }
 }
 
+/**
+ * SAMPLESR_DISCRETE
+ */
+std::tuple<size_t, double> Mazemodel::sampleSR_discrete(size_t s, size_t a, std::default_random_engine& generator) const {
+  if (get_rep(s) == S || get_rep(s) == G || get_rep(s) == T) {
+    return sampleSR(s, a, generator);
+  }
+  std::discrete_distribution<int> distribution (&transition_matrix[index(get_env(s), get_rep(s), a, 0)], &transition_matrix[index(get_env(s), get_rep(s), a, n_links)]);
+  size_t link = distribution(generator);
+  size_t s2 = link_targets[link_index(s, link)];
+  double r = getExpectedReward(s, a, s2);
+  return std::make_tuple(s2, r);
+}
+
 /**
  * ISTERMINAL
  */
@@ -668,86 +931,54 @@ bool Mazemodel::isInitial(size_t s) const {
  * PREVIOUS_STATES
  */
 std::vector<size_t> Mazemodel::previous_states(size_t state) const {
-  // Initial state
-  if (get_rep(state) == S) {
-    std::vector<size_t> aux;
-    return aux;
-  } // Goal state
-  else if (get_rep(state) == G) {
-    std::vector<size_t> aux = goal_states.at(get_env(state));
-    aux.push_back(state);
-    return aux;
-  } // Trap state
-  else if (get_rep(state) == T) {
-    int env = get_env(state);
-    std::vector<size_t> aux;
-    aux.push_back(state);
-    for (size_t s = 3; s < n_observations; s++) {
-      if (isTrap(env * n_observations + s)) {
-	aux.push_back(env * n_observations + s);
-      }
-    }
-    return aux;
-  }
-  // Others
-  else {
-    int x, y, o;
-    std::tie(x, y, o) = id_to_state(state);
-    std::vector<size_t> aux;
-    // Left;
-    aux.push_back(state_to_id(x, y, (o + 1) % 4));
-    // Right;
-    aux.push_back(state_to_id(x, y, (o + 3) % 4));
-    // Forward, if possible;
-    if (o == 0 && x < max_x) {
-      aux.push_back(state_to_id(x + 1, y, o));
-    } else if (o == 1 && y > min_y) {
-      aux.push_back(state_to_id(x, y - 1, o));
-    } else if (o == 2 && x > min_x) {
-      aux.push_back(state_to_id(x - 1, y, o));
-    } else if (o == 3 && y < max_y) {
-      aux.push_back(state_to_id(x, y + 1, o));
-    }
-    // No Move
-    aux.push_back(state);
-    // Starting state if applicable
-    if (isStarting(state)) {
-      aux.push_back(get_env(state) * n_observations + S);
-    }
-    return aux;
-  }
+  std::vector<size_t> aux(pred_states.begin() + pred_offsets[state * n_actions], pred_states.begin() + pred_offsets[(state + 1) * n_actions]);
+  std::sort(aux.begin(), aux.end());
+  aux.erase(std::unique(aux.begin(), aux.end()), aux.end());
+  return aux;
 }
 
 /**
  * REACHABLE_STATES
  */
 std::vector<size_t> Mazemodel::reachable_states(size_t state) const {
-  // Start state
-  if (get_rep(state) == S) {
-    return starting_states.at(get_env(state));
-  } //Absorbing states
-  else if (get_rep(state) == G || get_rep(state == T)) {
-    std::vector<size_t> result(1);
-    result.at(0) = state;
-    return result;
-  } // Final state
-  else if (isGoal(state)) {
-    std::vector<size_t> result(1);
-    result.at(0) = get_env(state) * n_observations + G;
-    return result;
-  } // Others
-  else {
-    std::vector<size_t> aux (n_actions);
-    for (int a = 0; a < n_actions; a++) {
-      aux.at(a) = next_state(state, a);
-    }
-    aux.push_back(state);
-    if (isTrap(state)) {
-      aux.push_back(get_env(state) * n_observations + T);
-    }
-    return aux;
-  }
+  StateSpan aux = reachable(state);
+  return std::vector<size_t>(aux.begin(), aux.end());
+}
+
+/**
+ * PREVIOUS_OBSERVATIONS
+ */
+StateSpan Mazemodel::previous_observations(size_t o) const {
+  return StateSpan{prevobs.data() + prevobs_offsets[o], prevobs.data() + prevobs_offsets[o + 1]};
+}
+
+/**
+ * SUCCESSORS
+ */
+StateSpan Mazemodel::successors(size_t s, size_t a) const {
+  return StateSpan{succ_states.data() + succ_offsets[s * n_actions + a], succ_states.data() + succ_offsets[s * n_actions + a + 1]};
+}
 
+const double* Mazemodel::successor_probabilities(size_t s, size_t a) const {
+  return succ_probs.data() + succ_offsets[s * n_actions + a];
+}
+
+/**
+ * PREDECESSORS
+ */
+StateSpan Mazemodel::predecessors(size_t s, size_t a) const {
+  return StateSpan{pred_states.data() + pred_offsets[s * n_actions + a], pred_states.data() + pred_offsets[s * n_actions + a + 1]};
+}
+
+const double* Mazemodel::predecessor_probabilities(size_t s, size_t a) const {
+  return pred_probs.data() + pred_offsets[s * n_actions + a];
+}
+
+/**
+ * REACHABLE
+ */
+StateSpan Mazemodel::reachable(size_t s) const {
+  return StateSpan{reach_states.data() + reach_offsets[s], reach_states.data() + reach_offsets[s + 1]};
 }
 
   bool Mazemodel::wall_infront(size_t state)  const{
@@ -10,7 +10,10 @@
 ** -------------------------------------------------------------------------*/
 
 #include "model.hpp"
+#include "aliastable.hpp"
+#include "modelfile.hpp"
 #include <iostream>
+#include <memory>
 #include <tuple>
 #include <random>
 #include <string>
@@ -33,16 +36,48 @@ private:
   size_t G = 1;
   size_t T = 2;
   double* transition_matrix;         /*!< Transition matrix. Ignore S-> and absorbing transitions */
+  AliasTable transition_alias;       /*!< Alias tables of each (state, action) link distribution, for sampling */
   std::vector<std::vector <size_t> > goal_states;  /*!< List of states leading to G for each environment */
   std::vector<std::vector <size_t> > starting_states;  /*!< List of states reachable from S for each environment */
   std::map<size_t, std::vector <double> > goal_rewards;  /*!< Associate a (goal state, input action) to the corresponding reward */
-  static std::default_random_engine generator;
+
+  /* Compiled topology, built by compile_topology once transitions are loaded */
+  bool topology_ready = false;
+  std::vector<bool> goal_set;          /*!< goal_set[s] iff s -> G */
+  std::vector<bool> start_set;         /*!< start_set[s] iff S -> s */
+  std::vector<bool> trap_set;          /*!< trap_set[s] iff s -> T */
+  std::vector<size_t> link_targets;    /*!< Arrival state of each (non-special state, link) */
+  std::vector<size_t> succ_offsets;    /*!< CSR offsets into succ_* for each (state, action) */
+  std::vector<size_t> succ_states;     /*!< Successors with non-zero probability */
+  std::vector<double> succ_probs;      /*!< Matching transition probabilities */
+  std::vector<size_t> pred_offsets;    /*!< CSR offsets into pred_* for each (state, action) */
+  std::vector<size_t> pred_states;     /*!< Predecessors with non-zero probability */
+  std::vector<double> pred_probs;      /*!< Matching transition probabilities */
+  std::vector<size_t> reach_offsets;   /*!< CSR offsets into reach_states for each state */
+  std::vector<size_t> reach_states;    /*!< Successors of each state for any action */
+  std::vector<size_t> prevobs_offsets; /*!< CSR offsets into prevobs for each observation */
+  std::vector<size_t> prevobs;         /*!< Predecessors of each observation in any environment */
+  std::shared_ptr<const ModelFile> mapping; /*!< Mapped model file backing the transitions, if any */
 
   /*! \brief Given an environment e, state s1, action a and state s2 (suffix),
    * returns the corresponding index in an 1D array.
    */
   int index(size_t env, size_t s1, size_t a, size_t s2_link) const;
 
+  /*! \brief Given a non-special state s and a link, returns the corresponding index in link_targets.
+   */
+  size_t link_index(size_t s, size_t link) const;
+
+  /*! \brief Returns P( s2 | s1 -a-> ) directly from the link transition matrix.
+   * Used to compile the topology index.
+   */
+  double link_transition_probability(size_t s1, size_t a, size_t s2) const;
+
+  /*! \brief Builds the successor/predecessor tables, trap bitset and link targets
+   * from the loaded transitions. Called at the end of load_transitions.
+   */
+  void compile_topology();
+
   /*! \brief Returns the index of the observation corresponding to a given position and orientation.
    *
    * \param x line index of the state.
@@ -143,6 +178,19 @@ public:
    */
   void load_transitions(std::string tfile, bool precision=false, bool normalization=false, bool verbose=false);
 
+  /*! \brief Load rewards, transitions and the compiled topology from a binary model file written by save_binary.
+   * The transition tensor and sampling tables are used in place from the mapped file.
+   *
+   * \param bfile Binary model file.
+   */
+  void load_binary(std::string bfile);
+
+  /*! \brief Write the loaded rewards, transitions and compiled topology as a binary model file.
+   *
+   * \param bfile Binary model file.
+   */
+  void save_binary(std::string bfile) const;
+
   /*! \brief Returns a given transition probability.
    *
    * \param s1 origin statte.
@@ -167,10 +215,23 @@ public:
    *
    * \param s origin state.
    * \param a chosen action.
+   * \param generator random engine of the calling thread.
    *
    * \return s2 such that s -a-> s2, and the associated reward R(s, a, s2).
    */
-  std::tuple<size_t, double> sampleSR(size_t s,size_t a) const;
+  std::tuple<size_t, double> sampleSR(size_t s, size_t a, std::default_random_engine& generator) const;
+  using Model::sampleSR;
+
+  /*! \brief Reference implementation of sampleSR, building a std::discrete_distribution
+   * over the transition row at every call. Kept for validation and benchmarking.
+   *
+   * \param s origin state.
+   * \param a chosen action.
+   * \param generator random engine of the calling thread.
+   *
+   * \return s2 such that s -a-> s2, and the associated reward R(s, a, s2).
+   */
+  std::tuple<size_t, double> sampleSR_discrete(size_t s, size_t a, std::default_random_engine& generator) const;
 
   /*! \brief Rwturns whether a state is terminal or not.
    *
@@ -204,6 +265,48 @@ public:
    */
   std::vector<size_t> reachable_states(size_t state) const;
 
+  /*! \brief Given an observation, returns all its possible predecessors. Does not allocate.
+   *
+   * \param o observation index.
+   *
+   * \return previous_observations the observations from which o can be reached in at least one environment.
+   */
+  StateSpan previous_observations(size_t o) const;
+
+  /*! \brief Returns the states reachable with non-zero probability from s when choosing a. Does not allocate.
+   *
+   * \param s origin state.
+   * \param a chosen action.
+   *
+   * \return successors the possible arrival states, matching successor_probabilities(s, a).
+   */
+  StateSpan successors(size_t s, size_t a) const;
+
+  /*! \brief Returns the transition probabilities of successors(s, a).
+   */
+  const double* successor_probabilities(size_t s, size_t a) const;
+
+  /*! \brief Returns the states from which s is reached with non-zero probability when choosing a. Does not allocate.
+   *
+   * \param s arrival state.
+   * \param a chosen action.
+   *
+   * \return predecessors the possible origin states, matching predecessor_probabilities(s, a).
+   */
+  StateSpan predecessors(size_t s, size_t a) const;
+
+  /*! \brief Returns the transition probabilities from each of predecessors(s, a) to s.
+   */
+  const double* predecessor_probabilities(size_t s, size_t a) const;
+
+  /*! \brief Returns the states reachable from s for any action. Does not allocate.
+   *
+   * \param s origin state.
+   *
+   * \return reachable the possible arrival states, sorted.
+   */
+  StateSpan reachable(size_t s) const;
+
   /*! \brief Given two states s1 and s2, return the link L such that s2 = s1.L if it exists,
    * or the value ``n_links`` otherwise.
    *
@@ -10,8 +10,34 @@
 ** -------------------------------------------------------------------------*/
 
 #include <vector>
+#include <cstdint>
 #include <iostream>
 #include <tuple>
+#include <random>
+#include <atomic>
+#include <ctime>
+
+/*! \brief Read-only view over a contiguous range of state or observation indices,
+ * returned by the models' zero-allocation topology accessors.
+ */
+struct StateSpan {
+  const size_t* first;
+  const size_t* last;
+  const size_t* begin() const { return first; }
+  const size_t* end() const { return last; }
+  size_t size() const { return last - first; }
+  bool empty() const { return first == last; }
+  size_t operator[](size_t i) const { return first[i]; }
+};
+
+/*! \brief Atomic counter which can be copied along with the model.
+ */
+struct AtomicCounter {
+  std::atomic<int> n;
+  AtomicCounter(int v = 0) : n(v) {};
+  AtomicCounter(const AtomicCounter& other) : n(other.n.load()) {};
+  AtomicCounter& operator=(const AtomicCounter& other) { n = other.n.load(); return *this; };
+};
 
 class Model {
 public:
@@ -83,6 +109,41 @@ public:
    */
   virtual double getTransitionProbability( size_t s1, size_t a, size_t s2 ) const = 0;
 
+  /*! \brief Returns P( o2 | o1 -a-> ) in each environment, as n_environments contiguous values.
+   * Used by the vectorized environment belief updates. Models may return a pointer to
+   * their own storage; the default fills and returns the buffer.
+   *
+   * \param o1 origin observation.
+   * \param a chosen action.
+   * \param o2 arrival observation.
+   * \param buffer room for n_environments values.
+   *
+   * \return pointer to the n_environments probabilities.
+   */
+  virtual const double* environment_transitions(size_t o1, size_t a, size_t o2, double* buffer) const {
+    for (size_t e = 0; e < n_environments; e++) {
+      buffer[e] = getTransitionProbability(e * n_observations + o1, a, e * n_observations + o2);
+    }
+    return buffer;
+  }
+
+  /*! \brief Returns P( o2 | o1 -a-> ) in the given environments only.
+   * Used by the sparse environment belief updates, whose cost should only depend on the
+   * number of environments still in the support of the belief.
+   *
+   * \param o1 origin observation.
+   * \param a chosen action.
+   * \param o2 arrival observation.
+   * \param envs n environment indices.
+   * \param n number of environments.
+   * \param buffer room for n values, filled in the order of envs.
+   */
+  virtual void environment_transitions(size_t o1, size_t a, size_t o2, const uint32_t* envs, size_t n, double* buffer) const {
+    for (size_t i = 0; i < n; i++) {
+      buffer[i] = getTransitionProbability(envs[i] * n_observations + o1, a, envs[i] * n_observations + o2);
+    }
+  }
+
   /*! \brief Returns a given observation probability.
    * @AIToolBox Model interface
    *
@@ -108,29 +169,90 @@ public:
   virtual double getExpectedReward( size_t s1, size_t a, size_t s2 ) const = 0;
 
   /*! \brief Sample a state and reward given an origin state and chosen action.
+   * Only uses the given random engine, so it can be called concurrently
+   * from threads owning different engines.
    *
    * \param s origin state.
    * \param a chosen action.
+   * \param generator random engine of the calling thread.
    *
    * \return s2 such that s -a-> s2, and the associated reward R(s, a, s2).
    */
-  virtual std::tuple<size_t, double> sampleSR(size_t s,size_t a) const = 0;
+  virtual std::tuple<size_t, double> sampleSR(size_t s, size_t a, std::default_random_engine& generator) const = 0;
 
-  /*! \brief Sample a state, observation and reward given an origin state and chosen acion.
+  /*! \brief Sample a state and reward, using the calling thread's own random engine.
    * @AIToolBox Model interface
+   */
+  std::tuple<size_t, double> sampleSR(size_t s, size_t a) const { return sampleSR(s, a, thread_generator()); };
+
+  /*! \brief Sample a state, observation and reward given an origin state and chosen acion.
    *
    * \param s origin state.
    * \param a chosen action.
+   * \param generator random engine of the calling thread.
    *
    * \return s2 such that s -a-> s2, and the associated observation and reward R(s, a, s2).
    */
-  virtual std::tuple<size_t, size_t, double> sampleSOR(size_t s, size_t a) const {
+  virtual std::tuple<size_t, size_t, double> sampleSOR(size_t s, size_t a, std::default_random_engine& generator) const {
     size_t s2;
     double reward;
-    std::tie(s2, reward) = sampleSR(s, a);
+    std::tie(s2, reward) = sampleSR(s, a, generator);
     return std::make_tuple(s2, get_rep(s2), reward);
   };
 
+  /*! \brief Sample a state, observation and reward, using the calling thread's own random engine.
+   * @AIToolBox Model interface
+   */
+  std::tuple<size_t, size_t, double> sampleSOR(size_t s, size_t a) const { return sampleSOR(s, a, thread_generator()); };
+
+  /*! \brief Sets the master seed from which the engines of thread_generator() are seeded.
+   * Must be called before any thread draws from its engine to make runs reproducible.
+   *
+   * \param seed master seed.
+   */
+  static void set_master_seed(unsigned seed) { master_seed() = seed; };
+
+  /*! \brief Returns a new seed, deterministically derived from the master seed
+   * and the number of seeds drawn so far.
+   */
+  static unsigned next_seed() {
+    static std::atomic<unsigned> counter(0);
+    std::seed_seq seq{master_seed().load(), counter++};
+    unsigned seed;
+    seq.generate(&seed, &seed + 1);
+    return seed;
+  };
+
+  /*! \brief Returns the random engine of the calling thread.
+   * This is the engine installed by a ScopedGenerator on this thread if
+   * any, otherwise an engine owned by the thread, seeded with next_seed()
+   * on first use.
+   */
+  static std::default_random_engine& thread_generator() {
+    if (scoped_generator()) {
+      return *scoped_generator();
+    }
+    thread_local std::default_random_engine generator(next_seed());
+    return generator;
+  };
+
+  /*! \brief Makes thread_generator() return a given engine on the calling
+   * thread, for as long as this object lives.
+   * This lets a unit of work (e.g. an evaluation session) draw from an
+   * engine seeded for it, independently of the thread it runs on.
+   */
+  class ScopedGenerator {
+  public:
+    explicit ScopedGenerator(std::default_random_engine& generator) : previous_(scoped_generator()) {
+      scoped_generator() = &generator;
+    };
+    ~ScopedGenerator() { scoped_generator() = previous_; };
+    ScopedGenerator(const ScopedGenerator&) = delete;
+    ScopedGenerator& operator=(const ScopedGenerator&) = delete;
+  private:
+    std::default_random_engine* previous_;
+  };
+
   /*! \brief Rwturns whether a state is terminal or not.
    * @AIToolBox Model interface
    *
@@ -173,8 +295,8 @@ public:
    *
    * \return number of calls to the sampleSR function.
    */
-  int get_bottleneck_calls() const { return n_bottleneck_calls; };
-  int bottleneck_call() const { n_bottleneck_calls ++; }
+  int get_bottleneck_calls() const { return n_bottleneck_calls.n; };
+  void bottleneck_call() const { n_bottleneck_calls.n.fetch_add(1, std::memory_order_relaxed); }
 
   /*! \brief Given a state, returns all its possible predecessors.
    *
@@ -192,6 +314,15 @@ public:
    */
   virtual std::vector<size_t> reachable_states(size_t state) const = 0;
 
+  /*! \brief Given an observation, returns all observations from which it can be reached
+   * in at least one environment. Does not allocate.
+   *
+   * \param o observation index.
+   *
+   * \return previous_observations the observation's possible predecessors.
+   */
+  virtual StateSpan previous_observations(size_t o) const = 0;
+
   /*! \brief Given two states s1 and s2, return the action a such that s2 = s1.a if it exists,
    * or the value ``n_actions`` otherwise.
    *
@@ -211,8 +342,19 @@ protected:
   size_t n_actions;  /*!< Number of actions in the model */
   size_t n_observations;  /*!< Number of observations in the model */
   size_t n_environments;  /*!< Number of environments */
-  mutable int n_bottleneck_calls = 0;    /*!<Number of times the transition sampling function has been called. Used for POMCP and PAMCP comparison*/
+  mutable AtomicCounter n_bottleneck_calls;    /*!<Number of times the transition sampling function has been called. Used for POMCP and PAMCP comparison*/
   double discount; /*!< Discount factor */
+
+private:
+  static std::atomic<unsigned>& master_seed() {
+    static std::atomic<unsigned> seed(time(NULL));
+    return seed;
+  };
+
+  static std::default_random_engine*& scoped_generator() {
+    thread_local std::default_random_engine* generator = nullptr;
+    return generator;
+  };
 };
 
 #endif
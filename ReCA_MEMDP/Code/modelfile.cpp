@@ -0,0 +1,124 @@
+/* ---------------------------------------------------------------------------
+** modelfile.cpp
+** see modelfile.hpp
+**
+** Author: Amelie Royer
+** Email: amelie.royer@ist.ac.at
+** -------------------------------------------------------------------------*/
+
+#include "modelfile.hpp"
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+  const char MAGIC[8] = {'M', 'E', 'M', 'D', 'P', 'B', 'I', 'N'};
+  const size_t ALIGNMENT = 64;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;
+    uint64_t n_sections;
+  };
+
+  size_t align(size_t offset) {
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  }
+}
+
+/**
+ * CONSTRUCTOR
+ */
+ModelFile::ModelFile(std::string filename, ModelKind kind) : base(nullptr), length(0) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  assert(("model file not found", fd >= 0));
+  struct stat st;
+  fstat(fd, &st);
+  length = st.st_size;
+  assert(("truncated model file", length >= sizeof(Header)));
+  // Shared read-only mapping: pages are loaded lazily, once for all processes
+  void* data = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  assert(("could not map model file", data != MAP_FAILED));
+  base = static_cast<const char*>(data);
+
+  //********** Check header
+  Header header;
+  std::memcpy(&header, base, sizeof(Header));
+  assert(("not a model file", !std::memcmp(header.magic, MAGIC, sizeof(MAGIC))));
+  assert(("unsupported model file version, convert the model again", header.version == VERSION));
+  assert(("model file holds another kind of model", header.kind == kind));
+  assert(("truncated model file", sizeof(Header) + header.n_sections * sizeof(Section) <= length));
+
+  //********** Read section directory
+  for (size_t i = 0; i < header.n_sections; i++) {
+    Section sec;
+    std::memcpy(&sec, base + sizeof(Header) + i * sizeof(Section), sizeof(Section));
+    assert(("truncated model file", sec.offset + sec.count * sec.elem_size <= length));
+    sections[sec.id] = sec;
+  }
+}
+
+/**
+ * DESTRUCTOR
+ */
+ModelFile::~ModelFile() {
+  if (base) {
+    munmap(const_cast<char*>(base), length);
+  }
+}
+
+/**
+ * COUNT
+ */
+size_t ModelFile::count(ModelSection id) const {
+  auto it = sections.find(id);
+  assert(("Missing section in model file", it != sections.end()));
+  return it->second.count;
+}
+
+/**
+ * IS_MODEL_FILE
+ */
+bool ModelFile::is_model_file(std::string filename) {
+  std::ifstream infile(filename, std::ios::in | std::ios::binary);
+  char magic[sizeof(MAGIC)];
+  return (infile.read(magic, sizeof(MAGIC)) && !std::memcmp(magic, MAGIC, sizeof(MAGIC)));
+}
+
+/**
+ * WRITE
+ */
+void ModelFileWriter::write(std::string filename) const {
+  Header header;
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = ModelFile::VERSION;
+  header.kind = kind;
+  header.n_sections = chunks.size();
+
+  // Lay out sections after the directory
+  std::vector<ModelFile::Section> directory;
+  size_t offset = align(sizeof(Header) + chunks.size() * sizeof(ModelFile::Section));
+  for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+    directory.push_back(ModelFile::Section{it->id, it->elem_size, offset, it->count});
+    offset = align(offset + it->count * it->elem_size);
+  }
+
+  std::ofstream outfile(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+  assert(("could not open model file for writing", outfile.is_open()));
+  outfile.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+  outfile.write(reinterpret_cast<const char*>(directory.data()), directory.size() * sizeof(ModelFile::Section));
+  size_t written = sizeof(Header) + directory.size() * sizeof(ModelFile::Section);
+  const char padding[ALIGNMENT] = {0};
+  for (size_t i = 0; i < chunks.size(); i++) {
+    outfile.write(padding, directory[i].offset - written);
+    outfile.write(chunks[i].data, chunks[i].count * chunks[i].elem_size);
+    written = directory[i].offset + chunks[i].count * chunks[i].elem_size;
+  }
+  outfile.write(padding, offset - written);
+  assert(("error while writing model file", outfile.good()));
+}
@@ -0,0 +1,165 @@
+#ifndef MODELFILE_H_INCLUDED
+#define MODELFILE_H_INCLUDED
+
+/* ---------------------------------------------------------------------------
+** modelfile.hpp
+** Versioned binary format for compiled models: the rewards, transition
+** tensor, sampling tables and topology indices of a loaded model, stored
+** as aligned arrays which can be memory-mapped and used in place.
+**
+** Layout: a header (magic, version, model kind, number of sections),
+** a directory of sections (id, element size, offset, count), then the
+** data of each section, aligned on 64 bytes.
+**
+** Author: Amelie Royer
+** Email: amelie.royer@ist.ac.at
+** -------------------------------------------------------------------------*/
+
+#include <cstdint>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <map>
+
+/*! \brief Identifiers of the sections of a model file.
+ */
+enum ModelSection : uint32_t {
+  SECTION_DIMS = 1,            /*!< Model dimensions, checked against the .summary file */
+  SECTION_REWARDS,
+  SECTION_TRANSITIONS,         /*!< Transition tensor, in the layout of the model's index(). Recomodel: pool of distinct rows */
+  SECTION_ALIAS_PROB,          /*!< Alias tables of the transition rows */
+  SECTION_ALIAS_INDEX,
+  SECTION_GOAL_SET,            /*!< Mazemodel: one byte per state */
+  SECTION_START_SET,
+  SECTION_TRAP_SET,
+  SECTION_GOAL_OFFSETS,        /*!< Mazemodel: goal states of each environment */
+  SECTION_GOAL_STATES,
+  SECTION_GOAL_REWARDS,        /*!< Mazemodel: n_actions rewards per goal state, in GOAL_STATES order */
+  SECTION_START_OFFSETS,       /*!< Mazemodel: starting states of each environment */
+  SECTION_START_STATES,
+  SECTION_LINK_TARGETS,
+  SECTION_SUCC_OFFSETS,
+  SECTION_SUCC_STATES,
+  SECTION_SUCC_PROBS,
+  SECTION_PRED_OFFSETS,
+  SECTION_PRED_STATES,
+  SECTION_PRED_PROBS,
+  SECTION_REACH_OFFSETS,
+  SECTION_REACH_STATES,
+  SECTION_PREVOBS_OFFSETS,
+  SECTION_PREVOBS,
+  SECTION_ROW_INDEX            /*!< Recomodel: pool row of each (observation, action, environment) */
+};
+
+/*! \brief Kind of model stored in a model file.
+ */
+enum ModelKind : uint32_t {
+  MODEL_RECO = 1,
+  MODEL_MAZE = 2
+};
+
+
+/*! \brief Read-only memory mapping of a model file.
+ * Pages are shared with every other process mapping the same file.
+ */
+class ModelFile {
+public:
+  static const uint32_t VERSION = 3;
+
+  /*! \brief Maps the given file and checks its header.
+   *
+   * \param filename path to the model file.
+   * \param kind expected kind of model.
+   */
+  ModelFile(std::string filename, ModelKind kind);
+
+  /*! \brief Unmaps the file.
+   */
+  ~ModelFile();
+
+  ModelFile(const ModelFile&) = delete;
+  ModelFile& operator=(const ModelFile&) = delete;
+
+  /*! \brief Returns a pointer to the data of a section, inside the mapping.
+   *
+   * \param id section identifier.
+   * \param count expected number of elements, or -1 to accept any.
+   *
+   * \return pointer to the first element, valid as long as this object.
+   */
+  template <typename T>
+  const T* get(ModelSection id, size_t count = (size_t) -1) const {
+    auto it = sections.find(id);
+    assert(("Missing section in model file", it != sections.end()));
+    assert(("Unexpected element type in model file", it->second.elem_size == sizeof(T)));
+    assert(("Unexpected section size in model file", count == (size_t) -1 || it->second.count == count));
+    return reinterpret_cast<const T*>(base + it->second.offset);
+  };
+
+  /*! \brief Returns the number of elements of a section.
+   */
+  size_t count(ModelSection id) const;
+
+  /*! \brief Copies a section into a vector, converting the elements to T.
+   */
+  template <typename T, typename S = T>
+  std::vector<T> copy(ModelSection id) const {
+    const S* data = get<S>(id);
+    return std::vector<T>(data, data + count(id));
+  };
+
+  /*! \brief Returns true iff the given file exists and starts with the model file magic.
+   */
+  static bool is_model_file(std::string filename);
+
+  struct Section {
+    uint32_t id;
+    uint32_t elem_size;
+    uint64_t offset;
+    uint64_t count;
+  };
+
+private:
+  const char* base;   /*!< Start of the mapping */
+  size_t length;      /*!< Size of the mapping */
+  std::map<uint32_t, Section> sections;
+};
+
+
+/*! \brief Collects arrays and writes them as a model file.
+ * The arrays are not copied: they must outlive the call to write.
+ */
+class ModelFileWriter {
+public:
+  ModelFileWriter(ModelKind kind_) : kind(kind_) {};
+
+  /*! \brief Adds a section of count elements.
+   */
+  template <typename T>
+  void add(ModelSection id, const T* data, size_t count) {
+    chunks.push_back(Chunk{id, sizeof(T), count, reinterpret_cast<const char*>(data)});
+  };
+
+  template <typename T>
+  void add(ModelSection id, const std::vector<T>& data) {
+    add(id, data.data(), data.size());
+  };
+
+  /*! \brief Writes the file.
+   *
+   * \param filename path to the model file, overwritten if it exists.
+   */
+  void write(std::string filename) const;
+
+private:
+  struct Chunk {
+    uint32_t id;
+    uint32_t elem_size;
+    size_t count;
+    const char* data;
+  };
+  ModelKind kind;
+  std::vector<Chunk> chunks;
+};
+
+#endif
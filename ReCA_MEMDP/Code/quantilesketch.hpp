@@ -0,0 +1,119 @@
+#ifndef QUANTILESKETCH_H_INCLUDED
+#define QUANTILESKETCH_H_INCLUDED
+
+/* ---------------------------------------------------------------------------
+** quantilesketch.hpp
+** Streaming, mergeable quantile sketch with bounded relative error
+** (logarithmic buckets, as in DDSketch).
+**
+** Author: Amelie Royer
+** Email: amelie.royer@ist.ac.at
+** -------------------------------------------------------------------------*/
+
+#include <map>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+
+class QuantileSketch {
+public:
+  /*! \brief Builds an empty sketch.
+   *
+   * \param accuracy relative accuracy of the returned quantiles. Defaults to 1%.
+   */
+  QuantileSketch(double accuracy = 0.01) : gamma((1 + accuracy) / (1 - accuracy)), log_gamma(std::log(gamma)), zeros(0), n(0),
+    lowest(std::numeric_limits<double>::infinity()), highest(-std::numeric_limits<double>::infinity()) {};
+
+  /*! \brief Adds a value to the sketch, in O(log(#buckets)).
+   * Values whose magnitude is below 1e-9 count as zero.
+   */
+  void add(double v) {
+    n++;
+    lowest = std::min(lowest, v);
+    highest = std::max(highest, v);
+    if (std::abs(v) < min_value) {
+      zeros++;
+    } else {
+      (v > 0 ? positive : negative)[index(std::abs(v))]++;
+    }
+  };
+
+  /*! \brief Adds all values of another sketch with the same accuracy.
+   */
+  void merge(const QuantileSketch &other) {
+    assert(("merging sketches of different accuracies", gamma == other.gamma));
+    for (auto it = other.positive.begin(); it != other.positive.end(); ++it) {
+      positive[it->first] += it->second;
+    }
+    for (auto it = other.negative.begin(); it != other.negative.end(); ++it) {
+      negative[it->first] += it->second;
+    }
+    zeros += other.zeros;
+    n += other.n;
+    lowest = std::min(lowest, other.lowest);
+    highest = std::max(highest, other.highest);
+  };
+
+  /*! \brief Returns the q-quantile of the values added so far, or 0 if there are none.
+   *
+   * \param q quantile in [0, 1], e.g. 0.95 for the 95th percentile.
+   */
+  double quantile(double q) const {
+    if (!n) {
+      return 0.;
+    }
+    // Bucket representatives are clamped to the exact extreme values
+    return std::min(highest, std::max(lowest, bucket_quantile(q)));
+  };
+
+  /*! \brief Returns the number of values added so far.
+   */
+  size_t count() const { return n; };
+
+private:
+  static constexpr double min_value = 1e-9;
+
+  /*! \brief Returns the representative of the bucket holding the q-quantile.
+   */
+  double bucket_quantile(double q) const {
+    size_t rank = (size_t) (q * (n - 1));
+    size_t seen = 0;
+    // Ascending order: negatives from the largest magnitude, zeros, positives
+    for (auto it = negative.rbegin(); it != negative.rend(); ++it) {
+      seen += it->second;
+      if (seen > rank) {
+	return -value(it->first);
+      }
+    }
+    seen += zeros;
+    if (seen > rank) {
+      return 0.;
+    }
+    for (auto it = positive.begin(); it != positive.end(); ++it) {
+      seen += it->second;
+      if (seen > rank) {
+	return value(it->first);
+      }
+    }
+    return highest;
+  };
+
+  /*! \brief Bucket i holds the magnitudes in (gamma^(i-1), gamma^i].
+   */
+  int index(double v) const { return (int) std::ceil(std::log(v) / log_gamma); };
+
+  /*! \brief Representative of bucket i, within the relative accuracy of all its values.
+   */
+  double value(int i) const { return 2 * std::pow(gamma, i) / (gamma + 1); };
+
+  double gamma, log_gamma;
+  std::map<int, size_t> positive;  /*!< Bucket counts of positive values */
+  std::map<int, size_t> negative;  /*!< Bucket counts of the magnitude of negative values */
+  size_t zeros;                    /*!< Number of values counted as zero */
+  size_t n;                        /*!< Total number of values */
+  double lowest, highest;          /*!< Exact extreme values */
+};
+
+#endif
@@ -13,14 +13,18 @@
 #include <fstream>
 #include <cassert>
 #include <algorithm>
+#include <numeric>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstring>
+#include <unordered_map>
 #include <boost/iostreams/filtering_streambuf.hpp>
 #include <boost/iostreams/copy.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
-
-/**
- * RANDOM ENGINE
- */
-std::default_random_engine Recomodel::generator(time(NULL));
+#include <AIToolbox/Impl/ThreadPool.hpp>
 
 /**
  * INDEX
@@ -158,11 +162,9 @@ Recomodel::Recomodel(std::string sfile, double discount_, bool is_mdp_) {
   is_mdp = is_mdp_;
   n_states = (is_mdp ? n_observations : n_environments * n_observations);
   rewards = new double[n_actions]();
-  if (is_mdp) {
-    transition_matrix = new double[n_observations * n_actions * n_actions]();
-  } else {
-    transition_matrix = new double[n_environments * n_observations * n_actions * n_actions]();
-  }
+  transition_matrix = nullptr; // interned by load_transitions, or mapped by load_binary
+  row_index = nullptr;
+  n_pool_rows = 0;
 
   //********** Summary of model parameters
   if (is_mdp) { // MDP
@@ -184,6 +186,15 @@ Recomodel::Recomodel(std::string sfile, double discount_, bool is_mdp_) {
     pows[i] = pows[i + 1] * n_actions;
     acpows[i] = acpows[i + 1] + pows[i];
   }
+
+  //********** Precompute predecessors of each observation
+  prevobs_offsets.reserve(n_observations + 1);
+  prevobs_offsets.push_back(0);
+  for (size_t o = 0; o < n_observations; o++) {
+    std::vector<size_t> aux = previous_states(o);
+    prevobs.insert(prevobs.end(), aux.begin(), aux.end());
+    prevobs_offsets.push_back(prevobs.size());
+  }
 }
 
 /**
@@ -222,18 +233,216 @@ void Recomodel::load_rewards(std::string rfile) {
 }
 
 
+namespace {
+  const size_t CHUNK_BYTES = 1 << 22;   /*!< Target size of the text chunks handed to the parser threads */
+
+  /*! \brief Parses a non-negative integer at p, skipping leading blanks.
+   *
+   * \return false if there is no digit at p.
+   */
+  inline bool parse_size(const char*& p, size_t& out) {
+    while (*p == ' ' || *p == '\t') { p++; }
+    if (*p < '0' || *p > '9') { return false; }
+    out = 0;
+    for (; *p >= '0' && *p <= '9'; p++) {
+      out = out * 10 + (*p - '0');
+    }
+    return true;
+  }
+
+  /*! \brief Parses a floating point number at p, skipping leading blanks.
+   * Numbers with at most 15 significant digits and a small exponent are exact in
+   * double precision, and are converted directly. Others fall back to strtod.
+   *
+   * \return false if there is no number at p.
+   */
+  inline bool parse_double(const char*& p, double& out) {
+    static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+				   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    while (*p == ' ' || *p == '\t') { p++; }
+    const char* start = p;
+    bool negative = (*p == '-');
+    if (*p == '-' || *p == '+') { p++; }
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any = false;
+    for (; *p >= '0' && *p <= '9'; p++, any = true) {
+      mantissa = mantissa * 10 + (*p - '0');
+      digits += (mantissa > 0);
+    }
+    if (*p == '.') {
+      for (p++; *p >= '0' && *p <= '9'; p++, any = true) {
+	mantissa = mantissa * 10 + (*p - '0');
+	digits += (mantissa > 0);
+	exponent--;
+      }
+    }
+    if (!any) {
+      p = start;
+      return false;
+    }
+    if (*p == 'e' || *p == 'E') {
+      const char* e = p + 1;
+      bool eneg = (*e == '-');
+      if (*e == '-' || *e == '+') { e++; }
+      int value = 0;
+      for (p = e; *p >= '0' && *p <= '9' && value < 10000; p++) {
+	value = value * 10 + (*p - '0');
+      }
+      exponent += (eneg ? -value : value);
+    }
+    if (digits > 15 || exponent < -22 || exponent > 22) {
+      char* e;
+      out = std::strtod(start, &e);
+      p = e;
+      return true;
+    }
+    out = (exponent < 0 ? mantissa / pow10[-exponent] : mantissa * pow10[exponent]);
+    out = (negative ? -out : out);
+    return true;
+  }
+
+  /*! \brief Returns true iff the line [p, end) separates two environments,
+   * i.e. it does not start with a number.
+   */
+  inline bool is_separator(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) { p++; }
+    return (p == end || *p < '0' || *p > '9');
+  }
+
+  /*! \brief Complete lines of one environment block, parsed independently of the others.
+   */
+  struct Chunk {
+    std::string text;
+    size_t env;
+  };
+
+  /*! \brief Bounded queue of chunks, from the reader to the parser threads.
+   */
+  class ChunkQueue {
+  public:
+    ChunkQueue(size_t capacity_) : capacity(capacity_), closed(false) {};
+
+    /*! \brief Queues a chunk. Returns false without queuing if the queue is full.
+     */
+    bool try_push(Chunk& chunk) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (chunks.size() >= capacity) { return false; }
+      chunks.push_back(std::move(chunk));
+      available.notify_one();
+      return true;
+    }
+
+    /*! \brief Waits for a chunk. Returns false once the queue is closed and empty.
+     */
+    bool pop(Chunk& chunk, bool wait = true) {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (wait) {
+	available.wait(lock, [this]{ return closed || !chunks.empty(); });
+      }
+      if (chunks.empty()) { return false; }
+      chunk = std::move(chunks.front());
+      chunks.pop_front();
+      return true;
+    }
+
+    void close() {
+      std::lock_guard<std::mutex> lock(mutex);
+      closed = true;
+      available.notify_all();
+    }
+
+  private:
+    size_t capacity;
+    bool closed;
+    std::deque<Chunk> chunks;
+    std::mutex mutex;
+    std::condition_variable available;
+  };
+
+  /*! \brief Counts the chunks queued and parsed for each environment block,
+   * to tell when a block has been fully parsed.
+   * For each block, exactly one call of parsed_chunk or close returns true.
+   */
+  class BlockTracker {
+  public:
+    BlockTracker(size_t n_blocks) : queued(n_blocks, 0), parsed(n_blocks, 0), closed(n_blocks, false) {};
+
+    /*! \brief Records that a chunk of block b was queued.
+     */
+    void queued_chunk(size_t b) {
+      std::lock_guard<std::mutex> lock(mutex);
+      queued[b]++;
+    }
+
+    /*! \brief Records that a chunk of block b was parsed.
+     *
+     * \return true iff the block is now complete.
+     */
+    bool parsed_chunk(size_t b) {
+      std::lock_guard<std::mutex> lock(mutex);
+      parsed[b]++;
+      return closed[b] && parsed[b] == queued[b];
+    }
+
+    /*! \brief Records that all chunks of block b were queued.
+     *
+     * \return true iff the block is already complete.
+     */
+    bool close(size_t b) {
+      std::lock_guard<std::mutex> lock(mutex);
+      closed[b] = true;
+      return parsed[b] == queued[b];
+    }
+
+  private:
+    std::vector<size_t> queued, parsed;
+    std::vector<bool> closed;
+    std::mutex mutex;
+  };
+
+  /*! \brief Distinct transition rows. Rows are compared bitwise, hashed first.
+   */
+  class RowPool {
+  public:
+    RowPool(size_t width_) : width(width_) {};
+
+    /*! \brief Returns the index of a row in the pool, adding the row if it is new.
+     */
+    uint32_t intern(const double* values) {
+      uint64_t h = 14695981039346656037ull;
+      for (size_t i = 0; i < width; i++) {
+	uint64_t bits;
+	std::memcpy(&bits, values + i, sizeof(bits));
+	h = (h ^ bits) * 1099511628211ull;
+      }
+      auto range = seen.equal_range(h);
+      for (auto it = range.first; it != range.second; ++it) {
+	if (!std::memcmp(rows.data() + it->second * width, values, width * sizeof(double))) {
+	  return it->second;
+	}
+      }
+      uint32_t id = rows.size() / width;
+      rows.insert(rows.end(), values, values + width);
+      seen.insert(std::make_pair(h, id));
+      return id;
+    }
+
+    std::vector<double> rows; /*!< Distinct rows, width values each */
+
+  private:
+    size_t width;
+    std::unordered_multimap<uint64_t, uint32_t> seen; /*!< Rows by hash */
+  };
+}
+
 /**
  * LOAD_TRANSITIONS
  */
-void Recomodel::load_transitions(std::string tfile, bool precision /* =false */, bool normalization /* =false */, std::string pfile /* ="" */) {
-  //std::fstream infile;
-  std::string line;
+void Recomodel::load_transitions(std::string tfile, bool precision /* =false */, bool normalization /* =false */, std::string pfile /* ="" */, size_t threads /* =0 */) {
   std::ifstream file, gzfile;
-  std::istringstream iss;
-  double v;
-  size_t s1, a, s2, link, p;
-  int transitions_found = 0, profiles_found = -1;
   boost::iostreams::filtering_streambuf<boost::iostreams::input> in;
+  threads = (threads ? threads : std::max(1u, std::thread::hardware_concurrency()));
 
   // Load transitions
   std::istream infile(nullptr);
@@ -249,31 +458,184 @@ void Recomodel::load_transitions(std::string tfile, bool precision /* =false */,
     infile.rdbuf(file.rdbuf());
   }
   assert((".transitions(.gz) file not found", file.is_open() || gzfile.is_open()));
-  while (std::getline(infile, line)) {
-    std::istringstream iss(line);
-    // Change of environment
-    if (!(iss >> s1 >> a >> s2 >> v)) {
-      std::cerr << "\r env " << profiles_found + 1 << " / " << n_environments;
-      profiles_found += 1;
-      assert(("Incomplete transition function in current profile in .transitions",
-	      transitions_found == n_observations * n_actions * n_actions));
-      assert(("Too many profiles found in .transitions file",
-	      profiles_found <= n_environments));
-      transitions_found = 0;
-      if (is_mdp) { break; } else { continue; }
+
+  // Normalizes the rows of an environment block
+  auto normalize = [this, precision](double* block) {
+    for (size_t s1 = 0; s1 < n_observations; s1++) {
+      for (size_t a = 0; a < n_actions; a++) {
+	double* row = block + index(0, s1, a, 0);
+	double nrm = 0.0;
+	// If asking for precision, use kahan summation [slightly slower]
+	if (precision) {
+	  double kahan_correction = 0.0;
+	  for (size_t s2 = 0; s2 < n_actions; s2++) {
+	    double val = row[s2] - kahan_correction;
+	    double aux = nrm + val;
+	    kahan_correction = (aux - nrm) - val;
+	    nrm = aux;
+	  }
+	}
+	// Else basic sum
+	else{
+	  nrm = std::accumulate(row, row + n_actions, 0.);
+	}
+	// Normalize
+	std::transform(row, row + n_actions, row, [nrm](const double t){ return t / nrm; });
+      }
+    }
+  };
+
+  // Each environment block is parsed into its own staging buffer, which is
+  // interned and released as soon as the block is complete, so that the
+  // dense transition matrix is never allocated.
+  size_t n_blocks = (is_mdp ? 1 : n_environments), block_size = n_observations * n_actions * n_actions;
+  std::vector<std::vector<double> > staged(n_blocks);
+  RowPool rows(n_actions);
+  std::vector<uint32_t> table(n_rows());
+
+  // Parses the lines of a chunk into the staging buffer of its block
+  auto parse = [this, &staged](const Chunk& chunk) {
+    double* block = staged[chunk.env].data();
+    const char* p = chunk.text.c_str();
+    size_t s1, a, s2;
+    double v;
+    while (*p) {
+      bool valid = parse_size(p, s1) && parse_size(p, a) && parse_size(p, s2) && parse_double(p, v);
+      assert(("Unvalid transition entry in .transitions", valid && a >= 1 && a <= n_actions));
+      size_t link = is_connected(s1, s2);
+      assert(("Unfeasible transition with >0 probability", link < n_actions));
+      block[index(0, s1, a - 1, link)] = v;
+      while (*p && *p++ != '\n');
+    }
+  };
+
+  // Environment blocks are finished by whichever thread parses their last chunk
+  // Blocks are interned in order, so that the pool does not depend on the schedule.
+  BlockTracker blocks(n_blocks);
+  std::mutex intern_mutex;
+  std::vector<bool> ready(n_blocks, false);
+  size_t next_block = 0;
+  auto complete = [&](size_t env) {
+    staged[env].resize(block_size, 0.);
+    if (normalization) {
+      normalize(staged[env].data());
+    }
+    std::lock_guard<std::mutex> lock(intern_mutex);
+    ready[env] = true;
+    for (; next_block < n_blocks && ready[next_block]; next_block++) {
+      const double* block = staged[next_block].data();
+      for (size_t s1 = 0; s1 < n_observations; s1++) {
+	for (size_t a = 0; a < n_actions; a++) {
+	  table[row_slot(next_block, s1, a)] = rows.intern(block + index(0, s1, a, 0));
+	}
+      }
+      std::vector<double>().swap(staged[next_block]);
+    }
+  };
+  auto parse_chunk = [&](const Chunk& chunk) {
+    parse(chunk);
+    if (blocks.parsed_chunk(chunk.env)) {
+      complete(chunk.env);
     }
-    // Set transition probability
-    link = is_connected(s1, s2);
-    assert(("Unfeasible transition with >0 probability", link < n_actions));
-    if (is_mdp) {
-      transition_matrix[index(0, s1, a - 1, link)] = v;
-    } else if (profiles_found >= 0) {
-      transition_matrix[index(profiles_found, s1, a - 1, link)] = v;
+  };
+
+  // The calling thread decompresses and splits the input at environment separators,
+  // the other threads parse the chunks as they come. The first block (before the
+  // first separator) is the MDP transition function, and is only parsed in MDP mode.
+  if (normalization) {
+    std::cout << "Normalization\n";
+  }
+  ChunkQueue queue(2 * threads);
+  auto read = [&]() {
+    std::vector<char> buffer(CHUNK_BYTES);
+    std::string data;
+    int profiles_found = -1;
+    size_t transitions_found = 0;
+    bool done = false;
+    // Environment of the current block, or -1 if it is skipped
+    auto current = [&]() {
+      if (is_mdp ? profiles_found >= 0 : (profiles_found < 0 || profiles_found >= n_environments)) {
+	return -1;
+      }
+      return (is_mdp ? 0 : profiles_found);
+    };
+    auto flush = [&](size_t from, size_t to) {
+      if (from == to || current() < 0) {
+	return;
+      }
+      Chunk chunk{data.substr(from, to - from), (size_t) current()};
+      if (staged[chunk.env].empty()) {
+	staged[chunk.env].assign(block_size, 0.);
+      }
+      blocks.queued_chunk(chunk.env);
+      // Help the parsers rather than wait when they fall behind
+      while (!queue.try_push(chunk)) {
+	Chunk other;
+	if (queue.pop(other, false)) { parse_chunk(other); }
+      }
+    };
+    auto close = [&]() {
+      if (current() >= 0 && blocks.close(current())) {
+	complete(current());
+      }
+    };
+    while (!done) {
+      infile.read(buffer.data(), buffer.size());
+      size_t n = infile.gcount();
+      data.append(buffer.data(), n);
+      if (n < buffer.size() && !data.empty() && data.back() != '\n') {
+	data.push_back('\n');
+      }
+      size_t pos = 0, chunk_start = 0, nl;
+      while (!done && (nl = data.find('\n', pos)) != std::string::npos) {
+	if (is_separator(data.data() + pos, data.data() + nl)) {
+	  // Change of environment
+	  flush(chunk_start, pos);
+	  close();
+	  chunk_start = nl + 1;
+	  profiles_found += 1;
+	  std::cerr << "\r env " << profiles_found << " / " << n_environments;
+	  assert(("Incomplete transition function in current profile in .transitions",
+		  transitions_found == n_observations * n_actions * n_actions));
+	  assert(("Too many profiles found in .transitions file",
+		  profiles_found <= n_environments));
+	  transitions_found = 0;
+	  done = is_mdp;
+	} else {
+	  transitions_found++;
+	}
+	pos = nl + 1;
+	if (pos - chunk_start >= CHUNK_BYTES) {
+	  flush(chunk_start, pos);
+	  chunk_start = pos;
+	}
+      }
+      flush(chunk_start, pos);
+      data.erase(0, pos);
+      done = done || (n < buffer.size());
+    }
+    close();
+    if (!is_mdp) {
+      assert(("Missing profiles in .transitions file", profiles_found == n_environments));
     }
-    transitions_found++;
+    queue.close();
+  };
+
+  std::vector<AIToolbox::Impl::ThreadPool::Task> tasks(1, read);
+  for (size_t t = 1; t < threads; t++) {
+    tasks.push_back([&queue, &parse_chunk]() {
+	Chunk chunk;
+	while (queue.pop(chunk)) {
+	  parse_chunk(chunk);
+	}
+      });
   }
-  if (!is_mdp) {
-    assert(("Missing profiles in .transitions file", profiles_found == n_environments));
+  AIToolbox::Impl::ThreadPool pool(threads);
+  pool.run(tasks);
+  // Single-threaded: everything left is parsed by the caller
+  Chunk chunk;
+  while (queue.pop(chunk, false)) {
+    parse_chunk(chunk);
   }
   if (file.is_open()) {
     file.close();
@@ -281,42 +643,82 @@ void Recomodel::load_transitions(std::string tfile, bool precision /* =false */,
   if (gzfile.is_open()) {
     gzfile.close();
   }
-
-  //Normalization
-  if ((normalization)) {
-    std::cout << "Normalization\n";
-    double nrm;
-    int env_loop = (is_mdp ? 1 : n_environments);
-    for (int p = 0; p < env_loop; p++) {
-      std::cerr << "\r env " << p + 1 << " / " << env_loop;
-      for (s1 = 0; s1 < n_observations; s1++) {
-	for (a = 0; a < n_actions; a++) {
-	  nrm = 0.0;
-	  // If asking for precision, use kahan summation [slightly slower]
-	  if (precision) {
-	    double kahan_correction = 0.0;
-	    for (s2 = 0; s2 < n_actions; s2++) {
-	      double val = transition_matrix[index(p, s1, a, s2)] - kahan_correction;
-	      double aux = nrm + val;
-	      kahan_correction = (aux - nrm) - val;
-	      nrm = aux;
-	    }
-	  }
-	  // Else basic sum
-	  else{
-	    nrm = std::accumulate(&transition_matrix[index(p, s1, a, 0)],
-				  &transition_matrix[index(p, s1, a, n_actions)], 0.);
-	  }
-	  // Normalize
-	  std::transform(&transition_matrix[index(p, s1, a, 0)],
-			 &transition_matrix[index(p, s1, a, n_actions)],
-			 &transition_matrix[index(p, s1, a, 0)],
-			 [nrm](const double t){ return t / nrm; }
-			 );
-	}
-      }
+  // Environments missing from the file are left to zero
+  for (size_t env = 0; env < n_blocks; env++) {
+    if (!ready[env]) {
+      complete(env);
     }
   }
+
+  // Shared rows and their sampling tables
+  set_rows(std::move(rows.rows), std::move(table));
+  std::cout << "\n   -> " << n_pool_rows << " distinct transition rows out of " << n_rows() << "\n";
+}
+
+/**
+ * N_ROWS
+ */
+size_t Recomodel::n_rows() const {
+  return (is_mdp ? 1 : n_environments) * n_observations * n_actions;
+}
+
+/**
+ * ROW_SLOT
+ */
+size_t Recomodel::row_slot(size_t env, size_t s1, size_t a) const {
+  return env + (is_mdp ? 1 : n_environments) * (a + n_actions * s1);
+}
+
+/**
+ * ROW
+ */
+size_t Recomodel::row(size_t env, size_t s1, size_t a) const {
+  return row_index[row_slot(env, s1, a)];
+}
+
+/**
+ * SET_ROWS
+ */
+void Recomodel::set_rows(std::vector<double> pool, std::vector<uint32_t> table) {
+  pool.shrink_to_fit();
+  row_pool = std::make_shared<const std::vector<double> >(std::move(pool));
+  row_table = std::make_shared<const std::vector<uint32_t> >(std::move(table));
+  transition_matrix = row_pool->data();
+  row_index = row_table->data();
+  n_pool_rows = row_pool->size() / n_actions;
+  transition_alias.build(transition_matrix, n_pool_rows, n_actions);
+}
+
+/**
+ * LOAD_BINARY
+ */
+void Recomodel::load_binary(std::string bfile) {
+  mapping = std::make_shared<const ModelFile>(bfile, MODEL_RECO);
+  const uint64_t* dims = mapping->get<uint64_t>(SECTION_DIMS, 5);
+  assert(("Binary model does not match the .summary file",
+	  dims[0] == n_observations && dims[1] == n_actions && dims[2] == n_environments && dims[3] == hlength && dims[4] == is_mdp));
+  std::copy(mapping->get<double>(SECTION_REWARDS, n_actions), mapping->get<double>(SECTION_REWARDS) + n_actions, rewards);
+  row_index = mapping->get<uint32_t>(SECTION_ROW_INDEX, n_rows());
+  n_pool_rows = mapping->count(SECTION_TRANSITIONS) / n_actions;
+  transition_matrix = mapping->get<double>(SECTION_TRANSITIONS, n_pool_rows * n_actions);
+  transition_alias.attach(mapping->get<double>(SECTION_ALIAS_PROB, n_pool_rows * n_actions),
+			  mapping->get<uint32_t>(SECTION_ALIAS_INDEX, n_pool_rows * n_actions), n_actions);
+}
+
+/**
+ * SAVE_BINARY
+ */
+void Recomodel::save_binary(std::string bfile) const {
+  assert(("Transitions must be loaded before saving", transition_matrix != nullptr));
+  std::vector<uint64_t> dims = {n_observations, n_actions, n_environments, (uint64_t) hlength, is_mdp};
+  ModelFileWriter writer(MODEL_RECO);
+  writer.add(SECTION_DIMS, dims);
+  writer.add(SECTION_REWARDS, rewards, n_actions);
+  writer.add(SECTION_TRANSITIONS, transition_matrix, n_pool_rows * n_actions);
+  writer.add(SECTION_ROW_INDEX, row_index, n_rows());
+  writer.add(SECTION_ALIAS_PROB, transition_alias.probabilities(), n_pool_rows * n_actions);
+  writer.add(SECTION_ALIAS_INDEX, transition_alias.aliases(), n_pool_rows * n_actions);
+  writer.write(bfile);
 }
 
 /**
@@ -327,7 +729,35 @@ double Recomodel::getTransitionProbability(size_t s1, size_t a, size_t s2) const
   if (link >= n_actions) {
     return 0.;
   } else {
-    return (is_mdp ? transition_matrix[index(0, s1, a, link)] : transition_matrix[index(get_env(s1), get_rep(s1), a, link)]);
+    return (is_mdp ? transition_matrix[row(0, s1, a) * n_actions + link] : transition_matrix[row(get_env(s1), get_rep(s1), a) * n_actions + link]);
+  }
+}
+
+/**
+ * ENVIRONMENT_TRANSITIONS
+ */
+const double* Recomodel::environment_transitions(size_t o1, size_t a, size_t o2, double* buffer) const {
+  size_t link = is_connected(o1, o2);
+  if (link >= n_actions || is_mdp) {
+    return Model::environment_transitions(o1, a, o2, buffer);
+  }
+  const uint32_t* rows = row_index + row_slot(0, o1, a);
+  for (size_t e = 0; e < n_environments; e++) {
+    buffer[e] = transition_matrix[rows[e] * n_actions + link];
+  }
+  return buffer;
+}
+
+
+void Recomodel::environment_transitions(size_t o1, size_t a, size_t o2, const uint32_t* envs, size_t n, double* buffer) const {
+  size_t link = is_connected(o1, o2);
+  if (link >= n_actions || is_mdp) {
+    Model::environment_transitions(o1, a, o2, envs, n, buffer);
+    return;
+  }
+  const uint32_t* rows = row_index + row_slot(0, o1, a);
+  for (size_t i = 0; i < n; i++) {
+    buffer[i] = transition_matrix[rows[envs[i]] * n_actions + link];
   }
 }
 
@@ -342,9 +772,20 @@ double Recomodel::getExpectedReward(size_t s1, size_t a, size_t s2) const {
 /**
  * SAMPLESR
  */
-std::tuple<size_t, double> Recomodel::sampleSR(size_t s,size_t a) const {
+std::tuple<size_t, double> Recomodel::sampleSR(size_t s, size_t a, std::default_random_engine& generator) const {
   // Sample next state according to transition function
-  std::discrete_distribution<int> distribution (&transition_matrix[index(get_env(s), get_rep(s), a, 0)], &transition_matrix[index(get_env(s), get_rep(s), a, n_actions)]);
+  size_t s2_link = transition_alias.sample(row(get_env(s), get_rep(s), a), generator);
+  // Return sampled state and rewards
+  size_t s2 = get_env(s) * n_observations + next_state(get_rep(s), s2_link);
+  return std::make_tuple(s2, ((s2_link == a) ? rewards[a] : 0));
+}
+
+/**
+ * SAMPLESR_DISCRETE
+ */
+std::tuple<size_t, double> Recomodel::sampleSR_discrete(size_t s, size_t a, std::default_random_engine& generator) const {
+  const double* values = transition_matrix + row(get_env(s), get_rep(s), a) * n_actions;
+  std::discrete_distribution<int> distribution (values, values + n_actions);
   size_t s2_link = distribution(generator);
   // Return sampled state and rewards
   size_t s2 = get_env(s) * n_observations + next_state(get_rep(s), s2_link);
@@ -404,6 +845,13 @@ std::vector<size_t> Recomodel::reachable_states(size_t state) const {
   return aux;
 }
 
+/**
+ * PREVIOUS_OBSERVATIONS
+ */
+StateSpan Recomodel::previous_observations(size_t o) const {
+  return StateSpan{prevobs.data() + prevobs_offsets[o], prevobs.data() + prevobs_offsets[o + 1]};
+}
+
 bool Recomodel::wall_infront(size_t state) const{
   return 0;
 }
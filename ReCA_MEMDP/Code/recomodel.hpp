@@ -10,7 +10,11 @@
 ** -------------------------------------------------------------------------*/
 
 #include "model.hpp"
+#include "aliastable.hpp"
+#include "modelfile.hpp"
 #include <iostream>
+#include <memory>
+#include <vector>
 #include <random>
 #include <string>
 #include <ctime>
@@ -19,12 +23,40 @@
 class Recomodel: public Model {
 
 private:
-  double* transition_matrix; /*!< Transition matrix */
+  const double* transition_matrix; /*!< Pool of distinct transition rows, n_actions links each */
+  const uint32_t* row_index;       /*!< Pool row of each (observation, action, environment), environments contiguous */
+  size_t n_pool_rows;              /*!< Number of distinct transition rows */
+  std::shared_ptr<const std::vector<double> > row_pool;    /*!< Storage of the row pool, shared by copies */
+  std::shared_ptr<const std::vector<uint32_t> > row_table; /*!< Storage of the row index, shared by copies */
+  AliasTable transition_alias; /*!< Alias tables of each pool row, for sampling */
   double* rewards;           /*!< Rewards matrix */
   int hlength;               /*!< History length */
   int* pows;                 /*!< Precomputed exponents for conversion to base n_items */
   int* acpows;               /*!< Cumulative exponents for conversion from base n_items */
-  static std::default_random_engine generator;
+  std::vector<size_t> prevobs_offsets; /*!< CSR offsets into prevobs for each observation */
+  std::vector<size_t> prevobs;         /*!< Predecessors of each observation */
+  std::shared_ptr<const ModelFile> mapping; /*!< Mapped model file backing the transitions, if any */
+
+  /*! \brief Number of transition rows, (environment, observation, action).
+   */
+  size_t n_rows() const;
+
+  /*! \brief Returns the position in the row index of a given environment, observation and action.
+   */
+  size_t row_slot(size_t env, size_t s1, size_t a) const;
+
+  /*! \brief Returns the pool row holding the transitions of a given environment, observation and action.
+   */
+  size_t row(size_t env, size_t s1, size_t a) const;
+
+  /*! \brief Installs the row pool and the row index, and builds the sampling tables of the pool rows.
+   * Environments mostly share the same rows, so the pool is up to n_environments times smaller
+   * than the dense transition matrix.
+   *
+   * \param pool distinct transition rows, n_actions values each.
+   * \param table pool row of each (environment, observation, action), at its row_slot().
+   */
+  void set_rows(std::vector<double> pool, std::vector<uint32_t> table);
 
   /*! \brief Given an environment e, state s1, action a and state s2 (suffix item),
    * returns the corresponding index in the 1D transition matrix.
@@ -88,8 +120,22 @@ public:
    * \param tfile Transition file.
    * \param pfile Profiles distribution file.
    * \param precision If true, precise normalization is enabled.
+   * \param threads Number of threads parsing and normalizing the environments, 0 for all hardware threads.
+   */
+  void load_transitions(std::string tfile, bool precision=false, bool normalization=false, std::string pfile="", size_t threads=0);
+
+  /*! \brief Load rewards and transitions from a binary model file written by save_binary.
+   * The transition tensor and sampling tables are used in place from the mapped file.
+   *
+   * \param bfile Binary model file.
+   */
+  void load_binary(std::string bfile);
+
+  /*! \brief Write the loaded rewards and transitions as a binary model file.
+   *
+   * \param bfile Binary model file.
    */
-  void load_transitions(std::string tfile, bool precision=false, bool normalization=false, std::string pfile="");
+  void save_binary(std::string bfile) const;
 
   /*! \brief Returns a given transition probability.
    *
@@ -101,6 +147,15 @@ public:
    */
   double getTransitionProbability(size_t s1, size_t a, size_t s2) const ;
 
+  /*! \brief Returns P( o2 | o1 -a-> ) in each environment, gathered from the pool rows of (o1, a),
+   * which are contiguous in the row index.
+   */
+  const double* environment_transitions(size_t o1, size_t a, size_t o2, double* buffer) const;
+
+  /*! \brief Returns P( o2 | o1 -a-> ) in the given environments, gathered from the pool rows of (o1, a).
+   */
+  void environment_transitions(size_t o1, size_t a, size_t o2, const uint32_t* envs, size_t n, double* buffer) const;
+
   /*! \brief Returns a given reward.
    *
    * \param s1 origin state.
@@ -115,10 +170,23 @@ public:
    *
    * \param s origin state.
    * \param a chosen action.
+   * \param generator random engine of the calling thread.
    *
    * \return s2 such that s -a-> s2, and the associated reward R(s, a, s2).
    */
-  std::tuple<size_t, double> sampleSR(size_t s,size_t a) const;
+  std::tuple<size_t, double> sampleSR(size_t s, size_t a, std::default_random_engine& generator) const;
+  using Model::sampleSR;
+
+  /*! \brief Reference implementation of sampleSR, building a std::discrete_distribution
+   * over the transition row at every call. Kept for validation and benchmarking.
+   *
+   * \param s origin state.
+   * \param a chosen action.
+   * \param generator random engine of the calling thread.
+   *
+   * \return s2 such that s -a-> s2, and the associated reward R(s, a, s2).
+   */
+  std::tuple<size_t, double> sampleSR_discrete(size_t s, size_t a, std::default_random_engine& generator) const;
 
   /*! \brief Returns whether a state is terminal or not.
    *
@@ -152,6 +220,14 @@ public:
    */
   std::vector<size_t> reachable_states(size_t state) const;
 
+  /*! \brief Given an observation, returns all its possible predecessors. Does not allocate.
+   *
+   * \param o observation index.
+   *
+   * \return previous_observations the observation's possible predecessors.
+   */
+  StateSpan previous_observations(size_t o) const;
+
   /*! \brief Given two states s1 and s2, return the action a such that s2 = s1.a if it exists,
    * or the value ``n_actions`` otherwise.
    *
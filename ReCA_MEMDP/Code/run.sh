@@ -23,10 +23,16 @@ VERBOSE="0"
 BELIEFSIZE="500"
 EXPLORATION="10000"
 HORIZON="2"
+THREADS="1"
+PARALLEL="root"
+SEED="0"
+DECISIONLOG="none"
+BUDGET="0"
+PRUNE="0"
 COMPILE=false
 
 # SET  ARGUMENTS FROM CMD LINE
-while getopts "m:d:n:k:u:g:s:h:e:x:b:cpv" opt; do
+while getopts "m:d:n:k:u:g:s:h:e:x:b:t:P:r:l:B:z:cpv" opt; do
   case $opt in
     m)
       MODE=$OPTARG
@@ -67,6 +73,24 @@ while getopts "m:d:n:k:u:g:s:h:e:x:b:cpv" opt; do
     x)
       EXPLORATION=$OPTARG
       ;;
+    t)
+      THREADS=$OPTARG
+      ;;
+    P)
+      PARALLEL=$OPTARG
+      ;;
+    r)
+      SEED=$OPTARG
+      ;;
+    l)
+      DECISIONLOG=$OPTARG
+      ;;
+    B)
+      BUDGET=$OPTARG
+      ;;
+    z)
+      PRUNE=$OPTARG
+      ;;
     c)
       COMPILE=true
       ;;
@@ -116,7 +140,7 @@ if [ $MODE = "mdp" ]; then
 	echo
 	echo "Compiling mainMDP"
 	
-	$GCC -O3 -Wl,-rpath,$STDLIB -DNITEMSPRM=$NITEMS -DHISTPRM=$HIST -DNPROFILESPRM=$PROFILES -std=c++11 mazemodel.cpp recomodel.cpp utils.cpp main_MDP.cpp -o mainMDP -I $AIINCLUDE -I $EIGEN -L $AIBUILD -l AIToolboxMDP -l AIToolboxPOMDP -l lpsolve55 -lz -lboost_iostreams
+	$GCC -O3 -Wl,-rpath,$STDLIB -DNITEMSPRM=$NITEMS -DHISTPRM=$HIST -DNPROFILESPRM=$PROFILES -std=c++11 -pthread mazemodel.cpp recomodel.cpp modelfile.cpp utils.cpp main_MDP.cpp -o mainMDP -I $AIINCLUDE -I $EIGEN -L $AIBUILD -l AIToolboxMDP -l AIToolboxPOMDP -l lpsolve55 -lz -lboost_iostreams
 	if [ $? -ne 0 ]; then
 	    echo "Compilation failed!"
 	    echo "exit"
@@ -129,14 +153,71 @@ if [ $MODE = "mdp" ]; then
     echo "Running mainMDP on $BASE"
     ./mainMDP $BASE $DATA $DISCOUNT $STEPS $EPSILON $PRECISION $VERBOSE
     echo
+# Sampling microbenchmark
+elif [ $MODE = "bench" ]; then
+# COMPILE
+    if [ "$COMPILE" = true ]; then
+	echo
+	echo "Compiling mainBench"
+	$GCC -O3 -Wl,-rpath,$STDLIB -std=c++11 -pthread mazemodel.cpp recomodel.cpp modelfile.cpp main_bench.cpp -o mainBench -I $AIINCLUDE -lz -lboost_iostreams
+	if [ $? -ne 0 ]; then
+	    echo "Compilation failed!"
+	    echo "exit"
+	    exit 1
+	fi
+    fi
+
+# RUN
+    echo
+    echo "Running mainBench on $BASE"
+    ./mainBench $BASE $DATA
+    echo
+# Dominance pruning microbenchmark
+elif [ $MODE = "dominance" ]; then
+# COMPILE
+    if [ "$COMPILE" = true ]; then
+	echo
+	echo "Compiling mainDominance"
+	$GCC -O3 -Wl,-rpath,$STDLIB -std=c++11 -pthread main_dominance.cpp -o mainDominance -I $AIINCLUDE -I $EIGEN -L $LPSOLVE -L $AIBUILD -l AIToolboxMDP -l AIToolboxPOMDP -l lpsolve55
+	if [ $? -ne 0 ]; then
+	    echo "Compilation failed!"
+	    echo "exit"
+	    exit 1
+	fi
+    fi
+
+# RUN
+    echo
+    echo "Running mainDominance"
+    ./mainDominance 10000 $THREADS
+    echo
+# Conversion to the binary model format, mapped by mainMEMDP
+elif [ $MODE = "convert" ]; then
+# COMPILE
+    if [ "$COMPILE" = true ]; then
+	echo
+	echo "Compiling mainConvert"
+	$GCC -O3 -Wl,-rpath,$STDLIB -std=c++11 -pthread mazemodel.cpp recomodel.cpp modelfile.cpp main_convert.cpp -o mainConvert -I $AIINCLUDE -lz -lboost_iostreams
+	if [ $? -ne 0 ]; then
+	    echo "Compilation failed!"
+	    echo "exit"
+	    exit 1
+	fi
+    fi
+
+# RUN
+    echo
+    echo "Converting $BASE to $BASE.bin"
+    ./mainConvert $BASE $DATA $PRECISION
+    echo
 # POMDPs
 else
 # COMPILE
     if [ "$COMPILE" = true ]; then
 	echo
 	echo "Compiling mainMEMDP"
-	echo "$GCC -O3 -Wl,-rpath,$STDLIB -DNITEMSPRM=$NITEMS -DHISTPRM=$HIST -DNPROFILESPRM=$PROFILES -std=c++11 mazemodel.cpp recomodel.cpp utils.cpp main_MEMDP.cpp -o mainMEMDP -I $AIINCLUDE -I $EIGEN -L $LPSOLVE -L $AIBUILD -l AIToolboxMDP -l AIToolboxPOMDP -l lpsolve55 -lz -lboost_iostreams"
-	$GCC -O3 -Wl,-rpath,$STDLIB -DNITEMSPRM=$NITEMS -DHISTPRM=$HIST -DNPROFILESPRM=$PROFILES -std=c++11 mazemodel.cpp recomodel.cpp utils.cpp main_MEMDP.cpp -o mainMEMDP -I $AIINCLUDE -I $EIGEN -L $LPSOLVE -L $AIBUILD -l AIToolboxMDP -l AIToolboxPOMDP -l lpsolve55 -lz -lboost_iostreams
+	echo "$GCC -O3 -Wl,-rpath,$STDLIB -DNITEMSPRM=$NITEMS -DHISTPRM=$HIST -DNPROFILESPRM=$PROFILES -std=c++11 -pthread mazemodel.cpp recomodel.cpp modelfile.cpp utils.cpp main_MEMDP.cpp -o mainMEMDP -I $AIINCLUDE -I $EIGEN -L $LPSOLVE -L $AIBUILD -l AIToolboxMDP -l AIToolboxPOMDP -l lpsolve55 -lz -lboost_iostreams"
+	$GCC -O3 -Wl,-rpath,$STDLIB -DNITEMSPRM=$NITEMS -DHISTPRM=$HIST -DNPROFILESPRM=$PROFILES -std=c++11 -pthread mazemodel.cpp recomodel.cpp modelfile.cpp utils.cpp main_MEMDP.cpp -o mainMEMDP -I $AIINCLUDE -I $EIGEN -L $LPSOLVE -L $AIBUILD -l AIToolboxMDP -l AIToolboxPOMDP -l lpsolve55 -lz -lboost_iostreams
 	if [ $? -ne 0 ]
 	then
 	    echo "Compilation failed!"
@@ -148,8 +229,8 @@ else
 # RUN
     echo
     echo "Running mainMEMDP on $BASE with $MODE solver"
-    echo "./mainMEMDP $BASE $DATA $MODE $DISCOUNT $STEPS $HORIZON $EPSILON $EXPLORATION $BELIEFSIZE $PRECISION $VERBOSE"
-    ./mainMEMDP $BASE $DATA $MODE $DISCOUNT $STEPS $HORIZON $EPSILON $EXPLORATION $BELIEFSIZE $PRECISION $VERBOSE
+    echo "./mainMEMDP $BASE $DATA $MODE $DISCOUNT $STEPS $HORIZON $EPSILON $EXPLORATION $BELIEFSIZE $PRECISION $VERBOSE $THREADS $PARALLEL $SEED $DECISIONLOG $BUDGET $PRUNE"
+    ./mainMEMDP $BASE $DATA $MODE $DISCOUNT $STEPS $HORIZON $EPSILON $EXPLORATION $BELIEFSIZE $PRECISION $VERBOSE $THREADS $PARALLEL $SEED $DECISIONLOG $BUDGET $PRUNE
     echo
 fi
 
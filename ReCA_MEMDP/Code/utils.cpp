@@ -21,68 +21,106 @@ std::string current_time_str() {
   return std::string(buffer);
 }
 
+/**
+ * ELAPSED_MS
+ */
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
 /**
  * STATS
  */
-Stats::Stats(int s) {
-    size = s;
-    acc_mean = new double[size]();
-    acc_var = new double[size]();
-    lengths = new double[size]();
-  }
+void Stats::Moments::add(double v) {
+  n += 1;
+  double delta = v - mean;
+  mean += delta / n;
+  m2 += delta * (v - mean);
+}
 
 
-Stats::~Stats() {
-  //delete []acc_mean;
-  //delete []acc_var;
-  //delete []lengths;
+void Stats::Moments::merge(const Moments &other) {
+  if (other.n == 0) {
+    return;
   }
+  double total = n + other.n;
+  double delta = other.mean - mean;
+  mean += delta * other.n / total;
+  m2 += other.m2 + delta * delta * n * other.n / total;
+  n = total;
+}
+
+
+Stats::Stats(int s) : moments(s), sketches(s) {}
 
 
 void Stats::update(int cluster, double v) {
-    assert(("overflow error", cluster < size));
-    acc_mean[cluster] += v;
-    acc_var[cluster] += v * v;
-    lengths[cluster] += 1;
+  assert(("overflow error", cluster < (int)moments.size()));
+  moments[cluster].add(v);
+  sketches[cluster].add(v);
+}
+
+
+void Stats::merge(const Stats &other) {
+  assert(("merging statistics over different clusters", moments.size() == other.moments.size()));
+  for (size_t i = 0; i < moments.size(); i++) {
+    moments[i].merge(other.moments[i]);
+    sketches[i].merge(other.sketches[i]);
   }
+}
 
-double Stats::get_mean(int cluster) {
-    if (cluster >= 0) {
-      if (lengths[cluster] > 0) {
-	return acc_mean[cluster] / lengths[cluster];
-      } else {
-	return 0.;
-      }
-    } else {
-      double v, l = 0;
-      for (int i = 0; i < size; i++) {
-	v += acc_mean[i];
-	l += lengths[i];
-      }
-      return v / l;
-    }
+
+Stats::Moments Stats::get_moments(int cluster) const {
+  if (cluster >= 0) {
+    return moments[cluster];
   }
+  Moments all;
+  for (auto it = moments.begin(); it != moments.end(); ++it) {
+    all.merge(*it);
+  }
+  return all;
+}
 
-double Stats::get_var(int cluster) {
-    if (cluster >= 0) {
-      if (lengths[cluster] > 0) {
-	double mean = get_mean(cluster);
-	return acc_var[cluster] / lengths[cluster] - mean * mean;
-      } else {
-	return 0.;
-      }
-    } else {
-      double v = 0;
-      for (int i = 0; i < size; i++) {
-	v += get_var(i);
-      }
-      return v / size;
-    }
+
+double Stats::get_count(int cluster) const {
+  return get_moments(cluster).n;
+}
+
+
+double Stats::get_mean(int cluster) const {
+  return get_moments(cluster).mean;
+}
+
+
+double Stats::get_var(int cluster) const {
+  if (cluster >= 0) {
+    const Moments &m = moments[cluster];
+    return ((m.n > 0) ? m.m2 / m.n : 0.);
+  }
+  // Overall: average of the clusters' variances
+  double v = 0;
+  for (size_t i = 0; i < moments.size(); i++) {
+    v += get_var(i);
   }
+  return v / moments.size();
+}
+
 
-double Stats::get_std(int cluster) {
-    return sqrt(get_var(cluster));
+double Stats::get_std(int cluster) const {
+  return sqrt(get_var(cluster));
+}
+
+
+double Stats::get_quantile(int cluster, double q) const {
+  if (cluster >= 0) {
+    return sketches[cluster].quantile(q);
   }
+  QuantileSketch all;
+  for (auto it = sketches.begin(); it != sketches.end(); ++it) {
+    all.merge(*it);
+  }
+  return all.quantile(q);
+}
 
 
 /**
@@ -144,6 +182,15 @@ double avprecision_score(std::vector<double> action_scores, size_t action) {
   return 1.0 / rank;
 }
 
+/**
+ * QUANTILES_STR
+ */
+static std::string quantiles_str(const Stats &stats, int cluster) {
+  std::ostringstream out;
+  out << "  [p50 " << stats.get_quantile(cluster, 0.5) << ", p95 " << stats.get_quantile(cluster, 0.95) << ", p99 " << stats.get_quantile(cluster, 0.99) << "]";
+  return out.str();
+}
+
 /**
  * PRINT_EVALUATION_RESULT
  */
@@ -159,7 +206,7 @@ void print_evaluation_result(int n_environments,
   for (int i = 0; i < n_environments; i++) {
     if (verbose) { std::cout << "   cluster " << i;}
     for (int j = 0; j < n_results; j++) {
-      if (verbose) { std::cout << "\n      > " << titles[j] << ": " << results.at(j).get_mean(i) << " +/- " << results.at(j).get_std(i);}
+      if (verbose) { std::cout << "\n      > " << titles[j] << ": " << results.at(j).get_mean(i) << " +/- " << results.at(j).get_std(i) << quantiles_str(results.at(j), i);}
     }
     if (verbose) {std::cout << "\n\n";}
   }
@@ -167,7 +214,7 @@ void print_evaluation_result(int n_environments,
   // Global
   std::cout << "> Global results ----------------";
   for (int j = 0; j < n_results; j++) {
-    std::cout << "\n      > " << titles[j] << ": " << results.at(j).get_mean(-1) << " +/- " << results.at(j).get_std(-1);
+    std::cout << "\n      > " << titles[j] << ": " << results.at(j).get_mean(-1) << " +/- " << results.at(j).get_std(-1) << quantiles_str(results.at(j), -1);
   }
 }
 
@@ -183,6 +230,18 @@ std::pair<AIToolbox::POMDP::Belief, size_t> make_initial_prediction(const Model&
   return std::make_pair(belief, prediction);
 };
 
+/**
+ * MAKE_INITIAL_PREDICTION (POMDP policy by observation blocks)
+ */
+std::pair<AIToolbox::POMDP::Belief, size_t> make_initial_prediction(const Model& model, AIToolbox::POMDP::BlockPolicy &policy, int horizon, std::vector<double> &action_scores) {
+  size_t init_observation = 0;
+  AIToolbox::POMDP::Belief belief = build_belief(init_observation, model.getS(), model.getO(), model.getE());
+  size_t id, prediction;
+  std::tie(prediction, id) = policy.startRun(belief, init_observation, horizon);
+
+  return std::make_pair(belief, prediction);
+};
+
 /**
  * MAKE_INITIAL_PREDICTION (MDP policy)
  */
@@ -206,6 +265,16 @@ std::pair<bool, size_t> make_prediction(const Model& model, AIToolbox::POMDP::Po
   return std::make_pair(false, prediction);
 }
 
+/**
+ * MAKE_PREDICTION (POMDP policy by observation blocks)
+ */
+std::pair<bool, size_t> make_prediction(const Model& model, AIToolbox::POMDP::BlockPolicy &policy, AIToolbox::POMDP::Belief &b, size_t o, size_t a, int horizon, std::vector<double> &action_scores) {
+  b = update_belief(b, a, o, model);
+  size_t id, prediction;
+  std::tie(prediction, id) = policy.continueRun(b, a, o, horizon);
+  return std::make_pair(false, prediction);
+}
+
 /**
  * MAKE_PREDICTION (MDP policy)
  */
@@ -233,6 +302,25 @@ std::pair<double, double> identification_score(const Model& model, AIToolbox::PO
   return std::make_pair(accuracy, 1.0 / rank);
 }
 
+/**
+ * IDENTIFICATION_SCORE (POMDP policy by observation blocks)
+ */
+std::pair<double, double> identification_score(const Model& model, const AIToolbox::POMDP::BlockPolicy &policy, const AIToolbox::POMDP::Belief &b, size_t o, int cluster) {
+  std::vector<double> scores(model.getE());
+  for (int e = 0; e < model.getE(); e++) {
+    scores.at(e) = b(e * model.getO() + o);
+  }
+  double accuracy = (((std::max_element(scores.begin(), scores.end()) - scores.begin()) == cluster) ? 1.0 : 0.0);
+  int rank = 1.;
+  double value = scores.at(cluster);
+  for (auto it = begin(scores); it != end(scores); ++it) {
+    if ( *it > value) {
+      rank += 1.;
+    }
+  }
+  return std::make_pair(accuracy, 1.0 / rank);
+}
+
 /**
  * IDENTIFICATION_SCORE (MDP policy)
  */
@@ -256,18 +344,18 @@ AIToolbox::POMDP::Belief build_belief(size_t o, size_t n_states, size_t n_observ
  */
 AIToolbox::POMDP::Belief update_belief(AIToolbox::POMDP::Belief b, size_t a, size_t o, const Model& model) {
   AIToolbox::POMDP::Belief bp =  AIToolbox::POMDP::Belief::Zero(model.getS());
-  double normalization = 0.;
+  size_t E = model.getE(), O = model.getO();
+  std::vector<double> env_belief(E, 0.), buffer(E);
 
   // Belief is non-zero only for states with observation o
-  std::vector<size_t> prev = model.previous_states(o);
-  for (int e = 0; e < model.getE(); e++) {
-    size_t s = e * model.getO() + o;
-    for (auto it = prev.begin(); it != prev.end(); ++it) {
-      size_t pres = e * model.getO() + *it;
-      bp(s) += model.getTransitionProbability(pres, a, s) * b(pres);
-    }
-    normalization += bp(s);
+  StateSpan prev = model.previous_observations(o);
+  for (auto it = prev.begin(); it != prev.end(); ++it) {
+    const double* probs = model.environment_transitions(*it, a, o, buffer.data());
+    AIToolbox::Impl::BeliefKernel::accumulateStrided(probs, b.data() + *it, O, env_belief.data(), E);
+  }
+  AIToolbox::Impl::BeliefKernel::normalize(env_belief.data(), E);
+  for (size_t e = 0; e < E; e++) {
+    bp(e * O + o) = env_belief[e];
   }
-  bp /= normalization;
   return bp;
 }
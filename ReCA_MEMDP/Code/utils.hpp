@@ -13,6 +13,9 @@
 ** -------------------------------------------------------------------------*/
 
 #include <random>
+#include <atomic>
+#include <mutex>
+#include <chrono>
 #include <math.h>
 #include <vector>
 #include <string>
@@ -23,7 +26,9 @@
 #include <AIToolbox/POMDP/Policies/Policy.hpp>
 #include <AIToolbox/POMDP/Algorithms/POMCP.hpp>
 #include "AIToolBox/PAMCP.hpp"
+#include "AIToolBox/BlockPolicy.hpp"
 #include "model.hpp"
+#include "quantilesketch.hpp"
 
 
 
@@ -33,23 +38,41 @@
  */
 std::string current_time_str();
 
+/*! \brief Returns the time elapsed since the given time point.
+ *
+ * \return elapsed time in milliseconds.
+ */
+double elapsed_ms(std::chrono::steady_clock::time_point start);
+
 /*! \brief
-  Statistics class to compute mean and standard deviation (across sequences) of the evaluation measures for each cluster.
+  Statistics class to compute mean, standard deviation and quantiles (across sequences) of the evaluation measures for each cluster.
+  Moments are accumulated with Welford's algorithm, and two instances can be merged (Chan et al.), e.g. across threads.
 */
 class Stats {
 private:
-  double* acc_mean;
-  double* acc_var;
-  double* lengths;
-  int size;
+  struct Moments {
+    double n = 0, mean = 0, m2 = 0;
+    void add(double v);
+    void merge(const Moments &other);
+  };
+  std::vector<Moments> moments;          /*!< Count, mean and sum of squared deviations per cluster */
+  std::vector<QuantileSketch> sketches;  /*!< Distribution of the values per cluster */
+
+  /*! \brief Returns the moments of the given cluster, or of all clusters if cluster < 0.
+   */
+  Moments get_moments(int cluster) const;
 
 public:
-  Stats(int s);
-  ~Stats();
+  Stats(int s = 0);
   void update(int cluster, double v);
-  double get_mean(int cluster);
-  double get_var(int cluster);
-  double get_std(int cluster);
+  void merge(const Stats &other);
+  double get_count(int cluster) const;
+  double get_mean(int cluster) const;
+  double get_var(int cluster) const;
+  double get_std(int cluster) const;
+  /*! \brief Returns the q-quantile (e.g. 0.95) of the given cluster, or of all clusters if cluster < 0.
+   */
+  double get_quantile(int cluster, double q) const;
 };
 
 /*! \brief Returns a sequence of sessions and corresponding user
@@ -129,6 +152,9 @@ std::pair<AIToolbox::POMDP::Belief, size_t> make_initial_prediction(const Model&
 // POMDP policy
 std::pair<AIToolbox::POMDP::Belief, size_t> make_initial_prediction(const Model& model, AIToolbox::POMDP::Policy &policy, int horizon, std::vector<double> &action_scores);
 
+// POMDP policy by observation blocks
+std::pair<AIToolbox::POMDP::Belief, size_t> make_initial_prediction(const Model& model, AIToolbox::POMDP::BlockPolicy &policy, int horizon, std::vector<double> &action_scores);
+
 // POMCP
 template<typename M>
 std::pair<AIToolbox::POMDP::Belief, size_t> make_initial_prediction(const Model& model, AIToolbox::POMDP::POMCP<M> &pomcp, int horizon, std::vector<double> &action_scores) {
@@ -152,9 +178,8 @@ std::pair<AIToolbox::POMDP::Belief, size_t> make_initial_prediction(const Model&
   env_belief.fill(1.0 / model.getE());
   size_t prediction = pamcp.sampleAction(env_belief, init_observation, horizon, true);
 
-  auto & graph_ = pamcp.getGraph();
   for (size_t a = 0; a < model.getA(); a++) {
-    action_scores.at(a) = graph_.children[a].V;
+    action_scores.at(a) = pamcp.getRootAction(a).V;
   }
 
   return std::make_pair(env_belief, prediction);
@@ -179,6 +204,9 @@ std::pair<bool, size_t> make_prediction(const Model& model, AIToolbox::MDP::Poli
 // POMDP policy
 std::pair<bool, size_t> make_prediction(const Model& model, AIToolbox::POMDP::Policy &policy, AIToolbox::POMDP::Belief &b, size_t o, size_t a, int horizon, std::vector<double> &action_scores);
 
+// POMDP policy by observation blocks
+std::pair<bool, size_t> make_prediction(const Model& model, AIToolbox::POMDP::BlockPolicy &policy, AIToolbox::POMDP::Belief &b, size_t o, size_t a, int horizon, std::vector<double> &action_scores);
+
 // POMCP
 template<typename M>
 std::pair<bool, size_t> make_prediction(const Model& model, AIToolbox::POMDP::POMCP<M> &pomcp, AIToolbox::POMDP::Belief &b, size_t o, size_t a, int horizon, std::vector<double> &action_scores) {
@@ -194,9 +222,8 @@ std::pair<bool, size_t> make_prediction(const Model& model, AIToolbox::POMDP::PO
 template<typename M>
 std::pair<bool, size_t> make_prediction(const Model& model, AIToolbox::POMDP::PAMCP<M> &pamcp, AIToolbox::POMDP::Belief &b, size_t o, size_t a, int horizon, std::vector<double> &action_scores) {
   size_t prediction = pamcp.sampleAction(a, o, horizon);
-  auto & graph_ = pamcp.getGraph();
   for (size_t action = 0; action < model.getA(); action++) {
-    action_scores.at(action) = graph_.children[action].V;
+    action_scores.at(action) = pamcp.getRootAction(action).V;
   }
   return std::make_pair(true, prediction);
 }
@@ -218,10 +245,13 @@ std::pair<double, double> identification_score(const Model& model, AIToolbox::MD
 // POMDP policy
 std::pair<double, double> identification_score(const Model& model, AIToolbox::POMDP::Policy policy, AIToolbox::POMDP::Belief b, size_t o, int cluster);
 
+// POMDP policy by observation blocks
+std::pair<double, double> identification_score(const Model& model, const AIToolbox::POMDP::BlockPolicy &policy, const AIToolbox::POMDP::Belief &b, size_t o, int cluster);
+
 // POMCP
 template<typename M>
-std::pair<double, double> identification_score(const Model& model, AIToolbox::POMDP::POMCP<M> pomcp, AIToolbox::POMDP::Belief b, size_t o, int cluster) {
-  std::vector<size_t> sampleBelief = pomcp.getGraph().belief;
+std::pair<double, double> identification_score(const Model& model, const AIToolbox::POMDP::POMCP<M> &pomcp, AIToolbox::POMDP::Belief b, size_t o, int cluster) {
+  const std::vector<size_t> &sampleBelief = pomcp.getGraph().belief;
   std::vector<int> scores(model.getE());
   for (auto it = begin(sampleBelief); it != end(sampleBelief); ++it) {
     scores.at(model.get_env(*it))++;
@@ -239,35 +269,102 @@ std::pair<double, double> identification_score(const Model& model, AIToolbox::PO
 
 // PAMCP
 template<typename M>
-std::pair<double, double> identification_score(const Model& model, AIToolbox::POMDP::PAMCP<M> pamcp, AIToolbox::POMDP::Belief b, size_t o, int cluster) {
-  std::vector<double> scores = pamcp.getEnvBelief();
-  /*
-    std::vector<double> scores(model.getE());
-    AIToolbox::POMDP::Belief eb = pamcp.getGraph().envbelief;
-    for (int i = 0; i < model.getE(); i++) {
-    scores.at(i) = eb(i);
-    }*/
-  double accuracy = ((std::max_element(scores.begin(), scores.end()) - scores.begin() == cluster) ? 1.0 : 0.0);
+std::pair<double, double> identification_score(const Model& model, const AIToolbox::POMDP::PAMCP<M> &pamcp, AIToolbox::POMDP::Belief b, size_t o, int cluster) {
+  // Only the support of the belief is visited: environments outside of it score 0
+  AIToolbox::POMDP::SparseEnvBelief scores = pamcp.getSparseEnvBelief();
+  const double* probs = scores.probs();
+  size_t best = std::max_element(probs, probs + scores.size()) - probs;
+  double accuracy = ((scores.size() ? (int)scores.envs()[best] : 0) == cluster ? 1.0 : 0.0);
+  double value = scores[cluster];
   int rank = 0.;
-  double value = scores.at(cluster);
-  for (auto it = begin(scores); it != end(scores); ++it) {
-    if ( *it >= value) {
-      rank += 1;
+  if (value > 0) {
+    for (size_t i = 0; i < scores.size(); i++) {
+      if (probs[i] >= value) {
+	rank += 1;
+      }
     }
+  } else {
+    rank = model.getE();
   }
   return std::make_pair(accuracy, 1.0 / rank);
 }
 
+/*! \brief Reseeds the random engines of a solver, when it has any.
+ *
+ * \param solver the solver to reseed.
+ * \param seed the new seed.
+ */
+// Solvers with random engines (PAMCP, POMCP) expose setSeed
+template<typename M>
+auto seed_solver(M &solver, unsigned seed) -> decltype(solver.setSeed(seed), void()) {
+  solver.setSeed(seed);
+}
+
+// Deterministic solvers (e.g. BlockPolicy) have nothing to reseed
+template<typename M, typename... Ignored>
+void seed_solver(M &, unsigned, Ignored...) {}
+
+/*! \brief Runs independent evaluation sessions, sharded across threads.
+ *
+ * Each thread works on its own copy of the solver and picks the next
+ * pending session when done with the previous one. Session i draws its
+ * randomness from an engine seeded with the i-th of a sequence of seeds
+ * drawn up front: the solver is reseeded from it, and the model samples of
+ * the session use another engine derived from it (see
+ * Model::ScopedGenerator). Results thus do not depend on the number
+ * of threads nor on the schedule, unless the solver keeps state across
+ * sessions (e.g. PAMCP with a past-aware tree) or is itself not
+ * deterministic for a given seed (e.g. tree-parallel PAMCP).
+ *
+ * \param n_sessions number of sessions to run.
+ * \param solver the solver to be evaluated.
+ * \param threads number of threads to use, including the calling one.
+ * \param session function (session index, solver) -> R evaluating one session.
+ *
+ * \return the results of the sessions, in session order.
+ */
+template<typename R, typename M, typename F>
+std::vector<R> run_sessions(size_t n_sessions, const M& solver, size_t threads, F session) {
+  std::vector<R> results(n_sessions);
+  std::vector<unsigned> seeds(n_sessions);
+  std::default_random_engine seeder(Model::next_seed());
+  for (size_t i = 0; i < n_sessions; i++) {
+    seeds[i] = seeder();
+  }
+
+  threads = std::max<size_t>(1, std::min(threads, n_sessions));
+  std::vector<M> solvers(threads, solver);
+  std::atomic<size_t> next(0), done(0);
+  std::mutex progress;
+  std::vector<AIToolbox::Impl::ThreadPool::Task> tasks;
+  for (size_t w = 0; w < threads; w++) {
+    tasks.emplace_back([&, w]() {
+	for (size_t i = next++; i < n_sessions; i = next++) {
+	  std::default_random_engine generator(seeds[i]);
+	  seed_solver(solvers[w], generator());
+	  std::default_random_engine model_generator(generator());
+	  Model::ScopedGenerator scope(model_generator);
+	  results[i] = session(i, solvers[w]);
+	  // Progress goes to clog, as cerr may be silenced
+	  std::lock_guard<std::mutex> lock(progress);
+	  std::clog << "\r     User " << ++done << "/" << n_sessions << std::string(15, ' ') << std::flush;
+	}
+      });
+  }
+  AIToolbox::Impl::ThreadPool pool(threads);
+  pool.run(tasks);
+  return results;
+}
+
 /*! \brief Evaluates a given solver using external test sequences (sequence of (observation, action)) stored in a file.
  *
  * \param sfile full path to the base_name.test file.
  * \param model underlying MEMDP model.
  * \param solver the solver to be evaluated.
- * \param policy AIToolbox POMDP::policy.
- * \param discount discount factor in the POMDP model.
  * \param horizon planning horizon for action sampling.
- * \param rewards stored reward values.
  * \param verbose if true, increases the verbosity. Defaults to false.
+ * \param supervised if true, predictions are made knowing the ground-truth previous action. Defaults to true.
+ * \param threads number of sessions evaluated in parallel. Defaults to 1.
  */
 template<typename M>
 void evaluate_from_file(std::string sfile,
@@ -275,81 +372,93 @@ void evaluate_from_file(std::string sfile,
 			M solver,
 			unsigned int horizon,
 			bool verbose=false,
-			bool supervised=true) {
-  // Aux variables
-  size_t observation = 0, action, prediction;
-  int user = 0, cluster, session_length, chorizon;
-  double cdiscount, accuracy, precision, total_reward, discounted_reward, identity, identity_precision;
+			bool supervised=true,
+			size_t threads=1) {
+  struct Result {
+    int cluster;
+    double accuracy, precision, total_reward, discounted_reward, identity, identity_precision;
+    Stats latency;
+  };
 
   // Initialize arrays
-  AIToolbox::POMDP::Belief belief;
-  std::vector< double > action_scores(model.getA(), 0);
   Stats accuracy_s(model.getE());
   Stats precision_s(model.getE());
   Stats total_reward_s(model.getE());
   Stats discounted_reward_s(model.getE());
   Stats identification_s(model.getE());
   Stats identification_precision_s(model.getE());
-  bool has_prec;
+  Stats session_length_s(model.getE());
+  Stats latency_s(model.getE());
 
   // Load test sessions
-  double total_length = 0.;
   std::vector<std::pair<int, std::vector<std::pair<size_t, size_t> > > > aux = load_test_sessions(sfile);
   for (auto it = begin(aux); it != end(aux); ++it) {
-    // Identity
-    user++;
-    cluster = std::get<0>(*it);
-    session_length = std::get<1>(*it).size();
-    total_length += session_length;
-    assert(("Empty test user session", session_length > 0));
-    std::cerr << "\r     User " << user << "/" << aux.size() << std::flush;
-
-    // Reset
-    cdiscount = 1.;
-    chorizon = horizon;
-    accuracy = 0, precision = 0, total_reward = 0, discounted_reward = 0, identity = 0, identity_precision = 0;
-    std::vector< double > action_scores(model.getA(), 0);
-
-    // Make initial guess
-    std::tie(belief, prediction) = make_initial_prediction(model, solver, chorizon, action_scores);
-    if (!verbose) {std::cerr.setstate(std::ios_base::failbit);}
-    for (auto it2 = begin(std::get<1>(*it)); it2 != end(std::get<1>(*it)); ++it2) {
-      // Update
-      if (!model.isInitial(std::get<0>(*it2))) {
-	double r = (model.mdp_enabled() ? model.getExpectedReward(observation, prediction, std::get<0>(*it2)) : model.getExpectedReward(cluster * model.getO() + observation, prediction, cluster * model.getO() + std::get<0>(*it2)));
-	total_reward += r;
-	discounted_reward += cdiscount * r;
-      }
-      cdiscount *= model.getDiscount();
-      chorizon = ((chorizon > 1) ? chorizon - 1 : 1 );
+    assert(("Empty test user session", std::get<1>(*it).size() > 0));
+  }
 
-      // Predict
-      observation  = std::get<0>(*it2);
-      if (!model.isInitial(observation)) {
-	std::tie(has_prec, prediction) = make_prediction(model, solver, belief, observation, (supervised ? action : prediction), chorizon, action_scores);
+  // Evaluate
+  if (!verbose) {std::cerr.setstate(std::ios_base::failbit);}
+  std::vector<Result> sessions = run_sessions<Result>(aux.size(), solver, threads, [&](size_t user, M &solver) {
+      // Reset
+      size_t observation = 0, action = 0, prediction;
+      int cluster = std::get<0>(aux[user]);
+      int chorizon = horizon;
+      double cdiscount = 1.;
+      bool has_prec = false;
+      Result res {cluster, 0., 0., 0., 0., 0., 0., Stats(model.getE())};
+      AIToolbox::POMDP::Belief belief;
+      std::vector< double > action_scores(model.getA(), 0);
+
+      // Make initial guess
+      auto start = std::chrono::steady_clock::now();
+      std::tie(belief, prediction) = make_initial_prediction(model, solver, chorizon, action_scores);
+      res.latency.update(cluster, elapsed_ms(start));
+      for (auto it2 = begin(std::get<1>(aux[user])); it2 != end(std::get<1>(aux[user])); ++it2) {
+	// Update
+	if (!model.isInitial(std::get<0>(*it2))) {
+	  double r = (model.mdp_enabled() ? model.getExpectedReward(observation, prediction, std::get<0>(*it2)) : model.getExpectedReward(cluster * model.getO() + observation, prediction, cluster * model.getO() + std::get<0>(*it2)));
+	  res.total_reward += r;
+	  res.discounted_reward += cdiscount * r;
+	}
+	cdiscount *= model.getDiscount();
+	chorizon = ((chorizon > 1) ? chorizon - 1 : 1 );
+
+	// Predict
+	observation  = std::get<0>(*it2);
+	if (!model.isInitial(observation)) {
+	  start = std::chrono::steady_clock::now();
+	  std::tie(has_prec, prediction) = make_prediction(model, solver, belief, observation, (supervised ? action : prediction), chorizon, action_scores);
+	  res.latency.update(cluster, elapsed_ms(start));
+	}
+
+	// Evaluate
+	action = std::get<1>(*it2);
+	res.accuracy += accuracy_score(prediction, action);
+	res.precision += has_prec ? avprecision_score(action_scores, action) : -1.;
+	auto id = identification_score(model, solver, belief, observation, cluster);
+	res.identity += std::get<0>(id);
+	res.identity_precision += std::get<1>(id);
       }
-
-      // Evaluate
-      action = std::get<1>(*it2);
-      accuracy += accuracy_score(prediction, action);
-      precision += has_prec ? avprecision_score(action_scores, action) : -1.;
-      auto aux = identification_score(model, solver, belief, observation, cluster);
-      identity += std::get<0>(aux);
-      identity_precision += std::get<1>(aux);
-    }
-
-    // Update scores
-    if (!verbose) {std::cerr.clear();}
-    accuracy_s.update(cluster, accuracy / session_length);
-    precision_s.update(cluster, precision / session_length);
-    total_reward_s.update(cluster, total_reward / session_length);
-    discounted_reward_s.update(cluster, discounted_reward);
-    identification_s.update(cluster, identity / session_length);
-    identification_precision_s.update(cluster, identity_precision / session_length);
+      return res;
+    });
+  if (!verbose) {std::cerr.clear();}
+
+  // Update scores, in session order
+  for (size_t user = 0; user < sessions.size(); user++) {
+    const Result &res = sessions[user];
+    double session_length = std::get<1>(aux[user]).size();
+    accuracy_s.update(res.cluster, res.accuracy / session_length);
+    precision_s.update(res.cluster, res.precision / session_length);
+    total_reward_s.update(res.cluster, res.total_reward / session_length);
+    discounted_reward_s.update(res.cluster, res.discounted_reward);
+    identification_s.update(res.cluster, res.identity / session_length);
+    identification_precision_s.update(res.cluster, res.identity_precision / session_length);
+    session_length_s.update(res.cluster, session_length);
+    latency_s.merge(res.latency);
   }
 
   // Only output relevant metrics
-  bool has_identity = (identity >= 0);
+  bool has_identity = (!sessions.empty() && sessions.back().identity >= 0);
   bool has_total_reward = (model.getDiscount() < 1);
 
   // Output
@@ -364,22 +473,23 @@ void evaluate_from_file(std::string sfile,
     titles.push_back("idac"); titles.push_back("idpr");
     results.push_back(identification_s); results.push_back(identification_precision_s);
   }
+  titles.push_back("avglng"); results.push_back(session_length_s);
+  titles.push_back("latms"); results.push_back(latency_s);
   print_evaluation_result(model.getE(), results, titles, verbose);
-  std::cout << "\n      > avglng: " << (float)total_length / (float)user;
-  std::cout << "\n      > avg mcp makeparticles calls: " << (float)model.get_bottleneck_calls() / (float)user;
+  std::cout << "\n      > avg mcp makeparticles calls: " << (float)model.get_bottleneck_calls() / (float)aux.size();
   std::cout << "\n\n";
 }
 
 /*! \brief Evaluates a given solver on on-the-fly generated test sequences.
  *
- * \param sfile full path to the base_name.test file.
+ * \param n_sessions number of sessions to generate, rounded down to a multiple of the number of environments.
  * \param model underlying MEMDP model.
  * \param solver the solver to be evaluated.
- * \param policy AIToolbox POMDP::policy.
- * \param discount discount factor in the POMDP model.
  * \param horizon planning horizon for action sampling.
- * \param rewards stored reward values.
  * \param verbose if true, increases the verbosity. Defaults to false.
+ * \param supervised if true, predictions are made knowing the true previous action. Defaults to false.
+ * \param session_length_max maximum number of steps of a session. Defaults to 400.
+ * \param threads number of sessions evaluated in parallel. Defaults to 1.
  */
 template<typename M>
 void evaluate_interactive(int n_sessions,
@@ -388,16 +498,17 @@ void evaluate_interactive(int n_sessions,
 			  unsigned int horizon,
 			  bool verbose=false,
 			  bool supervised=false, //true only works if full policy is computed (i.e. pbvi)
-			  int session_length_max=400) {
-  // Aux variables
-  size_t observation = 0, prev_observation, action, prediction;
-  size_t state, prev_state;
-  int cluster, chorizon;
-  double r, session_length, total_reward, identity, identity_precision;
+			  int session_length_max=400,
+			  size_t threads=1) {
+  struct Result {
+    int cluster;
+    size_t state;
+    double session_length, total_reward, identity, identity_precision;
+    std::string path;
+    Stats latency;
+  };
 
   // Initialize arrays
-  AIToolbox::POMDP::Belief belief;
-  std::vector< double > action_scores(model.getA(), 0);
   int n_failures = 0;
   Stats session_length_s(model.getE());
   Stats success_s(model.getE());
@@ -405,65 +516,69 @@ void evaluate_interactive(int n_sessions,
   Stats goal_reward_s(model.getE());
   Stats identification_s(model.getE());
   Stats identification_precision_s(model.getE());
- 
+  Stats latency_s(model.getE());
+
   // Generate test sessions
-  int subgroup_size = n_sessions / (int)(model.getE());
   n_sessions = n_sessions - n_sessions % (int)(model.getE());
-  for (int user = 0; user < n_sessions; user++) {
-
-    //Each environment is chosen equal number of times
-    //Starting with the first environment, 
-    //all evaluations for an environment are run before moving to the next environment  
-    // cluster = user / subgroup_size;
-    cluster = user%(int)(model.getE());
-    std::cerr << "\r     User " << user + 1 << "/" << n_sessions << std::string(15, ' ');
-
-    // Reset
-    chorizon = horizon;
-    session_length = 0, total_reward = 0, identity = 0, identity_precision = 0;
-    std::vector< double > action_scores(model.getA(), 0);
-
-    // Make initial guess
-    state = cluster * model.getO() + 0;
-    std::tie(belief, prediction) = make_initial_prediction(model, solver, chorizon, action_scores);
-    
+  if (!verbose) {std::cerr.setstate(std::ios_base::failbit);}
+  std::vector<Result> sessions = run_sessions<Result>(n_sessions, solver, threads, [&](size_t user, M &solver) {
+      //Each environment is chosen equal number of times
+      // Reset
+      size_t observation, prediction, prev_state;
+      int cluster = user % model.getE();
+      int chorizon = horizon;
+      Result res {cluster, cluster * model.getO() + 0, 0., 0., 0., 0., "", Stats(model.getE())};
+      AIToolbox::POMDP::Belief belief;
+      std::vector< double > action_scores(model.getA(), 0);
+      std::ostringstream path;
+      double r;
+
+      // Make initial guess
+      auto start = std::chrono::steady_clock::now();
+      std::tie(belief, prediction) = make_initial_prediction(model, solver, chorizon, action_scores);
+      res.latency.update(cluster, elapsed_ms(start));
+      path << model.state_to_string(res.state) << " ";
+
+      while(!model.isTerminal(res.state) && res.session_length < session_length_max) {
+	// Sample next state
+	prev_state = res.state;
+	std::tie(res.state, observation, r) = model.sampleSOR(res.state, prediction);
+
+	// Update
+	res.total_reward += r;
+	chorizon = ((chorizon > 1) ? chorizon - 1 : 1 );
+	// Predict
+	start = std::chrono::steady_clock::now();
+	prediction = std::get<1>(make_prediction(model, solver, belief, observation, (supervised ? model.is_connected(prev_state, res.state) : prediction), chorizon, action_scores));
+	res.latency.update(cluster, elapsed_ms(start));
+	path << model.state_to_string(res.state) << " ";
+
+	// Evaluate
+	res.session_length++;
+	auto id = identification_score(model, solver, belief, observation, cluster);
+	res.identity += std::get<0>(id);
+	res.identity_precision += std::get<1>(id);
+      }
+      res.path = path.str();
+      return res;
+    });
+  if (!verbose) {std::cerr.clear();}
 
+  // Update scores, in session order
+  for (int user = 0; user < n_sessions; user++) {
+    const Result &res = sessions[user];
+    int cluster = res.cluster;
     std::cout<<std::endl<<std::endl<<"EVALUATION NUMBER "<<(user+1)<<" STARTED";
-    std::cout<<std::endl<<"Environment Chosen :"<<model.get_env(state)<<" ";
-    std::cout<<"Path followed: "<<model.state_to_string(state)<<" ";//<<prediction<<" ";
-
-    // std::cout<<std::endl<<"eNVIRONMENT NO "<<model.getTransitionProbability(model.state_to_id(5,2,0),2,model.state_to_id(4,3,0))<<std::endl;
-    // std::cout<<std::endl<<" "<<model.getTransitionProbability(24,2,20)<<std::endl;
-    
-    if (!verbose) {std::cerr.setstate(std::ios_base::failbit);}
-    while(!model.isTerminal(state) && session_length < session_length_max) {
-      // Sample next state
-      prev_state = state;
-      std::tie(state, observation, r) = model.sampleSOR(state, prediction);
-      
-      // Update
-      total_reward += r;
-      chorizon = ((chorizon > 1) ? chorizon - 1 : 1 );
-      // Predict
-      prediction = std::get<1>(make_prediction(model, solver, belief, observation, (supervised ? model.is_connected(prev_state, state) : prediction), chorizon, action_scores));
-
-      std::cout<<model.state_to_string(state)<<" ";//<<prediction<<" "; 
-
-      // Evaluate
-      session_length++;
-      auto aux = identification_score(model, solver, belief, observation, cluster);
-      identity += std::get<0>(aux);
-      identity_precision += std::get<1>(aux);
-    }
+    std::cout<<std::endl<<"Environment Chosen :"<<cluster<<" ";
+    std::cout<<"Path followed: "<<res.path;
+    std::cout<<std::endl<<"Eval "<<(user+1)<<" Done"<<std::endl;
+    latency_s.merge(res.latency);
 
-    std::cout<<std::endl<<"Eval "<<(user+1)<<" Done"<<std::endl; 
-    // Update scores
-    if (!verbose) {std::cerr.clear();}
     // identity score can always be computed
-    identification_s.update(cluster, identity / session_length);
-    identification_precision_s.update(cluster, identity_precision / session_length);
+    identification_s.update(cluster, res.identity / res.session_length);
+    identification_precision_s.update(cluster, res.identity_precision / res.session_length);
     // Not reaching anything
-    if (!model.isTerminal(state)) {
+    if (!model.isTerminal(res.state)) {
       if (verbose) {
 	std::cerr << " run " << user + 1 << " ignored: did not reach final state.";
       }
@@ -473,20 +588,20 @@ void evaluate_interactive(int n_sessions,
     }
 
     // id score
-    total_reward_s.update(cluster, total_reward / session_length);
+    total_reward_s.update(cluster, res.total_reward / res.session_length);
     // If Trap, do not count the rest
-    if (model.get_rep(state) != 1) {
+    if (model.get_rep(res.state) != 1) {
       success_s.update(cluster, 0.);
       continue;
     }
     // Normal execution, i.e. goal state
-    session_length_s.update(cluster, session_length);
+    session_length_s.update(cluster, res.session_length);
     success_s.update(cluster, 1.); // Goal in robot maze
-    goal_reward_s.update(cluster, total_reward / session_length);
+    goal_reward_s.update(cluster, res.total_reward / res.session_length);
   }
 
   // Only output relevant metrics
-  bool has_identity = (identity >= 0);
+  bool has_identity = (!sessions.empty() && sessions.back().identity >= 0);
 
   // Output
   std::cout << "\n\n";
@@ -496,6 +611,7 @@ void evaluate_interactive(int n_sessions,
     titles.push_back("idac"); titles.push_back("idpr");
     results.push_back(identification_s); results.push_back(identification_precision_s);
   }
+  titles.push_back("latms"); results.push_back(latency_s);
   print_evaluation_result(model.getE(), results, titles, verbose);
   std::cout << "\n      > " << n_failures << " / " << n_sessions << " reach failures\n";
   std::cout << "\n\n";